@@ -49,7 +49,23 @@ void ImageHistogramDist (Histogram_t *outHistogram,
                      uint16_t   value);
 size_t OtsuThreshold (const Histogram_t *inHistogram);
 
+void HistogramSums (Histogram_t *histogram);
+
+/* H/S/I and distance to ref histograms of a RGB image, in one pass over
+   one pixel out of step in each direction */
+int ImageHistogramHsi (Histogram_t *outH,	/* 360 bins */
+                       Histogram_t *outS,	/* 100 bins */
+                       Histogram_t *outI,	/* 100 bins */
+                       Histogram_t *outDistH,	/* 360 bins */
+                       Histogram_t *outDistS,	/* 100 bins */
+                       Histogram_t *outDistI,	/* 100 bins */
+                       const vlImage *inImg,
+                       const vlHSI_carl_tol_t *ref,
+                       int step);
+
 void cal_threshold(vlImage *pic, vlHSI_carl_tol_t *para );
+int cal_threshold_step(vlImage *pic, vlHSI_carl_tol_t *para, int step);
+int cal_threshold_pyramid(vlPyramid *pyramid, vlHSI_carl_tol_t *para, int level);
 
 
 #endif
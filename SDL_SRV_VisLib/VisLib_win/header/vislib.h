@@ -87,7 +87,7 @@ typedef unsigned short int vlPixel;/* 16-bit */
 #define VL_PIXEL_MAXVAL 65535
 
 /* different image formats */
-typedef enum { NONE, RGB, HSI, NRG, GRAY, BINARY,H,S,I} vlImageFormat;////////////
+typedef enum { NONE, RGB, HSI, NRG, GRAY, BINARY,H,S,I, YUV} vlImageFormat;////////////
 
 /* image pixel size (# of basic pixels per image pixel)*/
 #define VL_NONE_PIXEL	1
@@ -96,6 +96,7 @@ typedef enum { NONE, RGB, HSI, NRG, GRAY, BINARY,H,S,I} vlImageFormat;//////////
 #define VL_NRG_PIXEL    2
 #define VL_GRAY_PIXEL   1
 #define VL_BINARY_PIXEL 1
+#define VL_YUV_PIXEL    3
 
 /* image data size */
 #define VL_NONE_SIZE(width, height)   (VL_NONE_PIXEL)
@@ -104,6 +105,7 @@ typedef enum { NONE, RGB, HSI, NRG, GRAY, BINARY,H,S,I} vlImageFormat;//////////
 #define VL_NRG_SIZE(width, height)    (VL_NRG_PIXEL*width*height*sizeof(vlPixel))
 #define VL_GRAY_SIZE(width, height)   (VL_GRAY_PIXEL*width*height*sizeof(vlPixel))
 #define VL_BINARY_SIZE(width, height) (VL_BINARY_PIXEL*width*height*sizeof(vlPixel))
+#define VL_YUV_SIZE(width, height)    (VL_YUV_PIXEL*width*height*sizeof(vlPixel))
 
 
 #define CLAMP(val, low, high) ((val<low) ? low : ((val>high) ? high : val))
@@ -221,6 +223,19 @@ typedef void (*VL_SIGHND)(int signalNum, ...);
 #include "vlMorph.h"
 #include "vlUtility.h"
 #include "vlBlob.h"
+#include "vlThread.h"
+#include "vlLabel.h"
+#include "vlPacked.h"
+#include "vlRle.h"
+#include "vlColorTable.h"
+#include "vlSegment.h"
+#include "vlStream.h"
+#include "vlTrack.h"
+#include "vlImage8.h"
+#include "vlYuv.h"
+#include "vlIntegral.h"
+#include "vlPyramid.h"
+#include "vlTile.h"
 
 #include "a_hsi_carl.h"
 #include  "myhist.h"
@@ -26,10 +26,28 @@ typedef struct
 	int topleft;	/*column 2 of blobs contains number of topleft pixel*/
 	int xcentroid;     /*column 3 of blobs contains X coordinate of centroid*/
 	int ycentroid;     /*column 4 of blobs contains Y coordinate of centroid*/
+
+	/*the following are accumulated by the labeler (vlBlobAddRun), so the
+	  label image need not be scanned again. Like the centroid, x is the
+	  row and y the column of the image*/
+	int xmin, xmax;		/*bounding box rows (inclusive)*/
+	int ymin, ymax;		/*bounding box columns (inclusive)*/
+	double m00, m10, m01;	/*raw moments, m10=sum(row) m01=sum(column)*/
+	double m11, m20, m02;
+	float orientation;	/*principal axis angle to the row axis [rad]*/
 }blob;
 
 void vlPutSquared (vlImage* pic,int x, int y, int width, int height);
 void centroid (vlImage* pic, int nobject, blob *blobs);
+
+/*moment accumulation: add the run [y1,y2) of row x, merge two partial blobs,
+  then derive centroid and orientation from the moments*/
+void vlBlobAddRun (blob *b, int x, int y1, int y2, int width);
+void vlBlobMerge (blob *dest, const blob *src);
+void vlBlobMoments (blob *b);
+/*move a blob labeled in an image of width fromWidth by dx rows and dy
+  columns into an image of width toWidth*/
+void vlBlobTranslate (blob *b, int dx, int dy, int fromWidth, int toWidth);
 void clearBorders (vlImage* pic);
 
 
@@ -0,0 +1,38 @@
+/** vlColorTable.h
+ ** ABSTRACT: precompiled RGB color class table for vlBinary thresholds
+ **
+ * vlBinary converts every pixel to HSI and compares it with the six bounds
+ * of a vlHSI_carl_tol_t. A color table does this once for every quantized
+ * RGB color and keeps one membership bit per color, so thresholding a
+ * pixel is a single lookup. With 8 bits per channel (2 MB) the result is
+ * exactly the one of vlBinary; with 6 (32 KB) or 5 bits (4 KB) every
+ * quantization cell takes the class of its center color.
+ *
+ * vlColorTableSet only rebuilds the table when the thresholds change, so
+ * keep one table per tracking loop and set it every frame.
+ **/
+
+#ifndef __COLORTABLE_H__
+#define __COLORTABLE_H__
+
+#include "vislib.h"
+
+typedef struct {
+  int bits;			/* per channel: 5, 6 or 8 */
+  int built;			/* TRUE once member matches para */
+  vlHSI_carl_tol_t para;	/* thresholds the table was built for */
+  unsigned char *member;	/* bit set where the color is in the box */
+} vlColorTable;
+
+vlColorTable *vlColorTableCreate (int bits);
+void vlColorTableDestroy (vlColorTable *table);
+
+/* build the table for para, unless it already is */
+int vlColorTableSet (vlColorTable *table, vlHSI_carl_tol_t *para);
+
+/* same output as vlBinary/vlBinaryRow: 255 out of the box, 0 inside */
+int vlBinaryTable (vlImage *src, vlColorTable *table, vlImage *dest);
+void vlBinaryTableRow (const vlPixel *src, const vlColorTable *table, int n,
+		       vlPixel *dest);
+
+#endif /* __COLORTABLE_H__ */
@@ -25,13 +25,16 @@
 
 #include "vislib.h"
 
-/* general 2D kernel convolution */
+/* general 2D kernel convolution of RGB or GRAY images, results clipped to
+   the pixel range; separable kernels are run as two 1D passes */
 int vlConvolve (vlImage *src, vlMask *mask, vlWindow *window, vlImage *dest);
 
-/* fast separable 2D averaging window smoothing filter  */
+/* fast 2D averaging window smoothing filter (box filter) of RGB or GRAY
+   images, in constant time per pixel whatever size */
 int vlSmooth (vlImage *src, int size, vlWindow *window, vlImage *dest);
 
-/* slow, non-linear (moving windows like) filter */
+/* non-linear median filter of RGB or GRAY images: sorting networks for
+   3x3 and 5x5, constant time histograms for other sizes of 8-bit values */
 int vlSmoothMedian (vlImage *src, int size, vlWindow *window, vlImage *dest);
 
 #endif /* __CONVOLUTION_H__ */
@@ -0,0 +1,41 @@
+/** vlCpu.h
+ ** ABSTRACT: run time detection of the SIMD instruction sets
+ **
+ * The SSE2, SSSE3 and AVX2 kernels are always compiled on x86, whatever the
+ * compiler flags, and picked at run time from vlCpuFeatures. Kernels must
+ * give exactly the output of the plain C code, so vlCpuDisable can force
+ * the C fallback (e.g. to compare or time both).
+ **/
+
+#ifndef __CPU_H__
+#define __CPU_H__
+
+#include "vislib.h"
+
+/* x86 targets, where the intrinsics are available */
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define VL_X86
+#endif
+
+/* functions using SSSE3 or AVX2 intrinsics (gcc needs them enabled per
+   function) */
+#if defined(VL_X86) && defined(__GNUC__)
+#define VL_TARGET_SSSE3 __attribute__ ((target ("ssse3")))
+#define VL_TARGET_AVX2 __attribute__ ((target ("avx2")))
+#else
+#define VL_TARGET_SSSE3
+#define VL_TARGET_AVX2
+#endif
+
+/* feature bits */
+#define VL_CPU_SSE2	0x1
+#define VL_CPU_AVX2	0x2
+#define VL_CPU_SSSE3	0x4
+
+/* features of the processor (and OS), less the disabled ones */
+int vlCpuFeatures (void);
+
+/* stop using the given features, 0 enables all of them again */
+void vlCpuDisable (int features);
+
+#endif /* __CPU_H__ */
@@ -27,6 +27,8 @@ int vlRgbFilter (vlImage *src, vlObject *object, vlWindow *window,
 		 vlImage *dest);
 int vlNrgFilter (vlImage *src, vlObject *object, vlWindow *window, 
 		 vlImage *dest);
+int vlNrgFilterRgb (vlImage *src, vlObject *object, vlWindow *window,
+		    vlImage *dest);
 int vlHsiFilter (vlImage *src, vlObject *object, vlWindow *window,
 		 vlImage *dest);
 
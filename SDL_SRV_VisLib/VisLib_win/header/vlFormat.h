@@ -30,8 +30,10 @@ int vlRgb2B (vlImage *src, vlWindow *window, vlImage *dest);
 int vlRgb2Gray (vlImage *src, vlWindow *window, vlImage *dest);
 int vlRgb2Binary (vlImage *src, int threshold, vlWindow *window, vlImage *dest);
 int vlRgb2Hsi (vlImage *src, vlWindow *window, vlImage *dest);
+void vlRgb2HsiRow (const vlPixel *src, vlPixel *dest, int n);
 
 int vlRgb2Nrg (vlImage *src, vlWindow *window, vlImage *dest);
+void vlRgb2NrgRow (const vlPixel *src, vlPixel *dest, int n);
 
 int vlNrg2Gray (vlImage *src, vlWindow *window, vlImage *dest);
 
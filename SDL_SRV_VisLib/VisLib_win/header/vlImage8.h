@@ -0,0 +1,106 @@
+/** vlImage8.h
+ ** ABSTRACT: 8-bit images and views over external 8-bit buffers
+ **
+ * Camera data, and all the formats but HSI, fit in 8 bits: RGB, NRG and
+ * GRAY values are 0-255 and BINARY ones 0 or 255. A vlImage8 holds them
+ * with one byte per value instead of a 16-bit vlPixel, which halves the
+ * memory traffic of every stage working on them. HSI uses the whole
+ * vlPixel range and stays a 16-bit vlImage (see vlRgb82Hsi).
+ *
+ * A vlImage8 may also be a view (vlImage8Wrap) over memory it does not
+ * own, such as the pixels of a SDL surface or the rows of a decoded JPEG:
+ * rows are stride bytes apart, pixels step bytes apart, and RGB pixels
+ * may be stored in BGR order. Every operator reads its sources through
+ * that layout, and writes into a dest view in place when the view
+ * already has the format and size of the result (vlImage8Init); any
+ * other dest gets a buffer of its own. So frames are processed where
+ * the display or the decoder put them, without copies.
+ *
+ * Every operator here gives the values of its vlImage counterpart, with
+ * the same window and border handling.
+ **/
+
+#ifndef __IMAGE8_H__
+#define __IMAGE8_H__
+
+#include "vislib.h"
+#include "vlLabel.h"
+#include "vlColorTable.h"
+
+/* basic 8-bit pixel */
+typedef unsigned char vlPixel8;
+#define VL_PIXEL8_MAXVAL 255
+
+/* memory order of the channels of RGB pixels */
+typedef enum { VL_ORDER_RGB, VL_ORDER_BGR } vlChannelOrder;
+
+/* 8-bit image, or view over external memory */
+typedef struct {
+  vlImageFormat format;		/* RGB, NRG, GRAY, BINARY or YUV */
+  int width;			/* # of columns */
+  int height;			/* # of rows */
+  vlPixel8 *pixel;		/* first value of the first row */
+  int stride;			/* bytes from a row to the next */
+  int step;			/* bytes from a pixel to the next */
+  vlChannelOrder order;		/* RGB images only */
+  int owner;			/* FALSE for views, pixel is not freed */
+} vlImage8;
+
+/* row j, and offset of the red (blue) value within a RGB pixel */
+#define VL_IMAGE8_ROW(image, j) ((image)->pixel + (j)*(image)->stride)
+#define VL_IMAGE8_RED(image) (((image)->order == VL_ORDER_BGR) ? 2 : 0)
+#define VL_IMAGE8_BLUE(image) (((image)->order == VL_ORDER_BGR) ? 0 : 2)
+
+/* create/destroy */
+vlImage8 *vlImage8Create (vlImageFormat format, int width, int height);
+void vlImage8Destroy (vlImage8 *image);
+int vlImage8Init (vlImage8 *image, vlImageFormat format, int width,
+		  int height);
+int vlImage8Copy (vlImage8 *src, vlImage8 *dest);
+
+/* make image a view over pixel (e.g. a locked SDL surface: stride is its
+   pitch, step its BytesPerPixel, order VL_ORDER_BGR on little endian) */
+int vlImage8Wrap (vlImage8 *image, vlImageFormat format, int width,
+		  int height, void *pixel, int stride, int step,
+		  vlChannelOrder order);
+
+/* conversions from/to vlImages (values above 255 are clamped) */
+int vlImage2Image8 (vlImage *src, vlImage8 *dest);
+int vlImage82Image (vlImage8 *src, vlImage *dest);
+
+/* format conversions (see vlFormat.h) */
+int vlRgb82Gray8 (vlImage8 *src, vlWindow *window, vlImage8 *dest);
+int vlRgb82Nrg8 (vlImage8 *src, vlWindow *window, vlImage8 *dest);
+int vlGray82Binary8 (vlImage8 *src, int threshold, vlWindow *window,
+		     vlImage8 *dest);
+int vlBinary82Rgb8 (vlImage8 *src, vlWindow *window, vlImage8 *dest);
+int vlRgb82Hsi (vlImage8 *src, vlWindow *window, vlImage *dest);
+
+/* thresholding and filters (see vlBinary, vlBinaryTable and vlFilter.h) */
+int vlBinary8 (vlImage8 *src, vlHSI_carl_tol_t *para, vlImage8 *dest);
+int vlBinaryTable8 (vlImage8 *src, vlColorTable *table, vlImage8 *dest);
+int vlRgbFilter8 (vlImage8 *src, vlObject *object, vlWindow *window,
+		  vlImage8 *dest);
+int vlNrgFilter8 (vlImage8 *src, vlObject *object, vlWindow *window,
+		  vlImage8 *dest);
+
+/* binary morphology (see vlMorph.h), dest may be src */
+int vlBinary8Erode (vlImage8 *src, int size, vlWindow *window,
+		    vlImage8 *dest);
+int vlBinary8Dilate (vlImage8 *src, int size, vlWindow *window,
+		     vlImage8 *dest);
+int vlBinary8Open (vlImage8 *src, int size, int num, vlWindow *window,
+		   vlMorphScratch *scratch);
+int vlBinary8Close (vlImage8 *src, int size, int num, vlWindow *window,
+		    vlMorphScratch *scratch);
+
+/* labeling of the 0 pixels of a BINARY image (see vlLabel.h) */
+int vlLabelBlobs8 (vlLabeler *labeler, vlImage8 *pic);
+int vlFindLargestBlobs8 (vlLabeler *labeler, vlImage8 *pic, int k,
+			 int minArea, blob *out);
+
+/* PPM files, as vlImageSave/vlImageLoad */
+int vlImage8Save (vlImage8 *image, char *filename);
+int vlImage8Load (vlImage8 *image, char *filename);
+
+#endif /* __IMAGE8_H__ */
@@ -0,0 +1,73 @@
+/** vlIntegral.h
+ ** ABSTRACT: integral images (summed-area tables) and local thresholding
+ **
+ * As IntegralImage of embedcv, entry (x, y) of the table is the sum of the
+ * pixels above and left of (x, y), so the sum over any box is four lookups
+ * whatever its size. The table has one more row and column than the image,
+ * of zeros, so boxes touching the borders need no special case, and keeps
+ * every channel of the image (e.g. R, G and B) interleaved as the pixels.
+ *
+ * Sums are unsigned int and wrap around on large images; a box sum is
+ * still exact as long as the box itself sums below 2^32, which holds for
+ * any box of 8-bit values up to 4096x4096.
+ *
+ * The table belongs to the caller and is reused from a frame to the
+ * other, so computing it allocates nothing once it is large enough. It
+ * also keeps the picture (every pixel is the sum over its own box): the
+ * vlIntegral operators work from the table alone, so one table computed
+ * per frame serves all the operators needing local sums of that frame.
+ **/
+
+#ifndef __INTEGRAL_H__
+#define __INTEGRAL_H__
+
+#include "vislib.h"
+
+typedef unsigned int vlIntegralSum;
+
+typedef struct {
+  vlImageFormat format;		/* of the image */
+  int width;			/* of the image; the table is one more */
+  int height;
+  int channels;			/* values per pixel */
+  int size;			/* # of allocated sums */
+  vlIntegralSum *sum;		/* (height+1) rows of (width+1)*channels */
+} vlIntegral;
+
+/* sum of channel c above and left of (x, y), x in [0,width] */
+#define VL_INTEGRAL_AT(ii, x, y, c) \
+  ((ii)->sum[((y)*((ii)->width+1) + (x))*(ii)->channels + (c)])
+
+/* sum of channel c over the box [x1,x2) x [y1,y2) */
+#define VL_INTEGRAL_BOX(ii, x1, y1, x2, y2, c) \
+  (VL_INTEGRAL_AT (ii, x2, y2, c) - VL_INTEGRAL_AT (ii, x1, y2, c) - \
+   VL_INTEGRAL_AT (ii, x2, y1, c) + VL_INTEGRAL_AT (ii, x1, y1, c))
+
+vlIntegral *vlIntegralCreate (void);
+void vlIntegralDestroy (vlIntegral *ii);
+
+/* table of all the channels of src, whatever its format */
+int vlIntegralCompute (vlIntegral *ii, vlImage *src);
+
+/* GRAY table of the means (R+G+B)/3 of the pixels of a RGB src */
+int vlIntegralComputeMean (vlIntegral *ii, vlImage *src);
+
+/* box filter of the picture: mean of the size x size square [s1,s2), as
+   vlSmooth, for any size and format */
+int vlIntegralSmooth (vlIntegral *ii, int size, vlWindow *window,
+		      vlImage *dest);
+
+/* 255 where the pixel of a GRAY picture (or the mean of a RGB one) is
+   above the mean of the size x size box around it (clipped to the image)
+   plus offset, 0 elsewhere */
+int vlIntegralBinaryAdaptive (vlIntegral *ii, int size, int offset,
+			      vlWindow *window, vlImage *dest);
+
+/* the same from a GRAY (RGB) src, ii holding its table (or NULL for a
+   temporary one) */
+int vlGray2BinaryAdaptive (vlImage *src, int size, int offset,
+			   vlIntegral *ii, vlWindow *window, vlImage *dest);
+int vlRgb2BinaryAdaptive (vlImage *src, int size, int offset,
+			  vlIntegral *ii, vlWindow *window, vlImage *dest);
+
+#endif /* __INTEGRAL_H__ */
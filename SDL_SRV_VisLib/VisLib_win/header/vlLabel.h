@@ -0,0 +1,114 @@
+/** vlLabel.h
+ ** ABSTRACT: run-length connected component labeling (union-find)
+ **
+ * The labeler works on horizontal runs of foreground pixels instead of
+ * single pixels: pass 1 extracts the runs of each row and unifies them with
+ * the 8-connected runs of the row above, pass 2 resolves the label
+ * equivalences and numbers the blobs 1..n in raster order of their
+ * topleft pixel (the same numbering vlFindAllBlobs always produced).
+ * Foreground pixels are the ones equal to 0, as returned by vlBinary.
+ *
+ * A labeler keeps its buffers between calls, so create one per tracking
+ * loop and reuse it for every frame.
+ **/
+
+#ifndef __LABEL_H__
+#define __LABEL_H__
+
+#include "vislib.h"
+#include "vlBlob.h"
+#include "vlThread.h"
+
+/* horizontal run of foreground pixels, columns [x1,x2) of row y */
+typedef struct {
+  int y;
+  int x1, x2;
+  int label;			/* provisional label, blob id after finish */
+} vlRun;
+
+/* labeling context */
+typedef struct {
+  int width, height;
+
+  /* runs of the current frame, in raster order */
+  vlRun *runs;
+  int numRuns, maxRuns;
+
+  /* runs of the previous/current row: [prevStart,prevEnd) [rowStart,numRuns) */
+  int row;
+  int prevStart, prevEnd, rowStart;
+  int upper;			/* first run of previous row not yet passed */
+
+  /* provisional labels: union-find forest and final ids */
+  int *parent;
+  int numLabels, maxLabels;
+  int *ids;
+  int maxIds;
+
+  /* resulting blobs, ids 1..numBlobs (entry 0 unused) */
+  blob *blobs;
+  int numBlobs, maxBlobs;
+
+  /* streaming mode (vlFindLargestBlobs): only two rows of runs are kept,
+     statistics are accumulated per provisional label and the k largest
+     complete blobs are kept in out[0..numOut) */
+  int stream;
+  blob *acc;
+  int maxAcc;
+  int *last;			/* last row reached by each label */
+  int maxLast;
+  int k, minArea;
+  blob *out;
+  int numOut;
+} vlLabeler;
+
+vlLabeler *vlLabelerCreate (void);
+void vlLabelerDestroy (vlLabeler *labeler);
+
+/* low-level interface: feed runs in raster order, then resolve */
+int vlLabelerStart (vlLabeler *labeler, int width, int height);
+int vlLabelerStartLargest (vlLabeler *labeler, int width, int height, int k,
+			   int minArea, blob *out);
+int vlLabelerAddRun (vlLabeler *labeler, int y, int x1, int x2);
+int vlLabelerScanRow (vlLabeler *labeler, int y, const vlPixel *row);
+int vlLabelerFinish (vlLabeler *labeler);
+int vlLabelerPaint (vlLabeler *labeler, vlImage *pic);
+
+/* label a whole image, optionally writing blob ids into its pixels */
+int vlLabelBlobs (vlLabeler *labeler, vlImage *pic, int paint);
+
+/* k largest blobs of at least minArea pixels, pic is left untouched */
+int vlFindLargestBlobs (vlLabeler *labeler, vlImage *pic, int k, int minArea,
+			blob *out);
+
+/* parallel labeling: the image is cut in horizontal bands, each labeled
+   by its own labeler on its own thread, then the blobs touching across
+   band borders are merged. The result is the one of vlLabelBlobs */
+typedef struct {
+  int numBands;
+  vlLabeler *bands[VL_MAX_THREADS];
+  int first[VL_MAX_THREADS+1];	/* first row of each band */
+  int base[VL_MAX_THREADS+1];	/* index of band blob 0 in parent/ids */
+
+  /* union-find over all band blobs, and their final ids */
+  int *parent;
+  int maxParent;
+  int *ids;
+  int maxIds;
+
+  /* resulting blobs, ids 1..numBlobs (entry 0 unused) */
+  blob *blobs;
+  int numBlobs, maxBlobs;
+
+  /* current job */
+  vlImage *pic;
+  int status[VL_MAX_THREADS];
+} vlParallelLabeler;
+
+/* bands <= 0 uses one band per processor */
+vlParallelLabeler *vlParallelLabelerCreate (int bands);
+void vlParallelLabelerDestroy (vlParallelLabeler *labeler);
+int vlLabelBlobsParallel (vlParallelLabeler *labeler, vlImage *pic,
+			  int paint);
+
+#endif /* __LABEL_H__ */
@@ -24,6 +24,13 @@
 
 #include "vislib.h"
 
+/* scratch space of the allocation-free binary open/close: create one per
+   processing loop, it grows to the largest need and is kept between calls */
+typedef struct {
+  int *buffer;
+  int size;			/* # of values */
+} vlMorphScratch;
+
 /* morphological RGB operators */
 int vlRgbErode (vlImage *src, int size, vlWindow *window, vlImage *dest);
 int vlRgbDilate (vlImage *src, int size, vlWindow *window, vlImage *dest);
@@ -34,6 +41,12 @@ int vlBinaryErode (vlImage *src, int size, vlWindow *window, vlImage *dest);
 int vlBinaryDilate (vlImage *src, int size, vlWindow *window, vlImage *dest);
 int vlBinaryOpen(vlImage *src,int size,int t,vlWindow *window);
 int vlBinaryClose(vlImage *src,int size,int t,vlWindow *window);
+vlMorphScratch *vlMorphScratchCreate (void);
+void vlMorphScratchDestroy (vlMorphScratch *scratch);
+int vlBinaryOpenScratch(vlImage *src,int size,int num,vlWindow *window,
+			vlMorphScratch *scratch);
+int vlBinaryCloseScratch(vlImage *src,int size,int num,vlWindow *window,
+			 vlMorphScratch *scratch);
 //int vlDealBinPic(vlImage *src,vlHSI_carl_tol_t *para,vlImage *dest);
 
 #endif /* __MORPH_H__ */
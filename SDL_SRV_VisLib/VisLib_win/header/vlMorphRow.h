@@ -0,0 +1,116 @@
+/** vlMorphRow.h
+ ** ABSTRACT: row code of the morphological operators, shared by the
+ **           vlImage (morph.cpp) and vlImage8 (image8.cpp) versions
+ **
+ * Internal to the library, not included by vislib.h. The operators are
+ * written once for any pixel type T and read their image through a row
+ * stride and a pixel step (in pixels), so that the same code runs on the
+ * vlPixel rows of a vlImage (stride width, step 1) and on the bytes of a
+ * vlImage8 or of a view of a camera buffer.
+ **/
+
+#ifndef __MORPH_ROW_H__
+#define __MORPH_ROW_H__
+
+#include "vislib.h"
+
+/* make sure scratch holds at least size values (morph.cpp) */
+int _vlMorphScratchReserve (vlMorphScratch *scratch, int size);
+
+
+/* van Herk/Gil-Werman running min (max if max is TRUE) along a line of
+   n pixels: out[i] = min/max of in[i..i+k-1] for i in [0,n-k]. The line
+   is cut in blocks of k pixels, g holds the running extremum from the
+   start of each block and h the one from its end, so that every window
+   is the combination of one h and one g: 3 comparisons per pixel
+   whatever k. g and h are n pixel scratch buffers */
+template <class T> void
+_vlRunningExtremum (const T *in, int inStride, int n, int k, int max,
+		    T *out, int outStride, T *g, T *h)
+{
+  int i, b, e;
+  T p;
+
+  for (b=0; b<n; b+=k) {
+    e = VL_MIN(b+k,n);
+    g[b] = in[b*inStride];
+    for (i=b+1; i<e; i++) {
+      p = in[i*inStride];
+      g[i] = ((p > g[i-1]) == max) ? p : g[i-1];
+    }
+    h[e-1] = in[(e-1)*inStride];
+    for (i=e-2; i>=b; i--) {
+      p = in[i*inStride];
+      h[i] = ((p > h[i+1]) == max) ? p : h[i+1];
+    }
+  }
+
+  for (i=0; i<=n-k; i++) {
+    out[i*outStride] = ((h[i] > g[i+k-1]) == max) ? h[i] : g[i+k-1];
+  }
+}
+
+
+/* binary erosion clears the size x size square [s1,s2) around every clear
+   pixel of the source area, dilation sets it around every set pixel:
+   pixel x is reached if a source pixel lies in [x-s2+1,x-s1] along both
+   axes. The rows are scanned once, remembering the last source column
+   seen along the row and the last row that reached each column, so the
+   cost does not depend on size. A row is only written once the source
+   rows below it have been read, so the operation is done in place. Row y
+   of the width x height image is at pixel + y*stride, column x at x*step */
+template <class T> int
+_vlBinaryMorphRows (T *pixel, int stride, int step, int width, int height,
+		    int size, vlWindow *window, int dilate,
+		    vlMorphScratch *scratch)
+{
+  int i,j,r;
+  int x1,x2,y1,y2;
+  int s1,s2;
+  int cols,seen;
+  T value;
+  T *row;
+  int *last;
+
+  s2 = size/2;
+  s1 = -(size-s2);
+  x1 = VL_MAX(window->x-s1,-s1);
+  x2 = VL_MIN(window->x+window->width,width-s2);
+  y1 = VL_MAX(window->y-s1,-s1);
+  y2 = VL_MIN(window->y+window->height,height-s2);
+  if ((x1 >= x2) || (y1 >= y2)) {
+    return (0);			/* nothing to do */
+  }
+
+  /* reached columns are [x1+s1,x2+s2-1): last[i] is the last source row
+     (relative to y1) that reached column x1+s1+i */
+  cols = x2-x1+size-1;
+  if (0 > _vlMorphScratchReserve (scratch, cols)) {
+    return (-1);		/* failure */
+  }
+  last = scratch->buffer;
+  for(i=0;i<cols;i++) last[i] = -size;
+  value = dilate ? 255 : 0;
+
+  /* source row y1+r, then reached row y1+s1+r */
+  for(r=0;r<y2-y1+size-1;r++) {
+    if (r < y2-y1) {
+      row = pixel + (y1+r)*stride;
+      seen = x1-size;
+      for(i=0;i<cols;i++){
+	j = x1+i;
+	if ((j < x2) && ((row[j*step] != 0) == dilate)) seen = j;
+	if (seen > j-size) last[i] = r;
+      }
+    }
+
+    row = pixel + (y1+s1+r)*stride + (x1+s1)*step;
+    for(i=0;i<cols;i++){
+      if (last[i] > r-size) row[i*step] = value;
+    }
+  }
+
+  return (0);			/* success */
+}
+
+#endif /* __MORPH_ROW_H__ */
@@ -36,7 +36,7 @@ int vlMatchShape (vlImage *image, vlObject *object, vlWindow *window);
  * object properties update 
  */
 int vlObjectColorUpdate (vlImage *nrgImage, vlImage *binImage, 
-			 vlObject *object);
+			 vlObject *object);	/* or RGB for a NRG object */
 int vlObjectShapeUpdate (vlImage *image, vlImage *binImage, vlWindow *window,
 			 vlObject *object);
 int vlObjectMotionUpdate (vlObject *object);
@@ -72,6 +72,8 @@ int vlObjectExtractRgb (vlImage *pic, vlPoint *point,
 int getobjectcolorhsi (vlHSI_carl_tol_t *objectcolor);
 
 int vlBinary(vlImage *src, vlHSI_carl_tol_t *para,vlImage * dest);
+void vlBinaryRow(const vlPixel *src, vlHSI_carl_tol_t *para, int n,
+		 vlPixel *hsi, vlPixel *dest);
 
 
 #endif /* __OBJECT_H__ */
@@ -0,0 +1,65 @@
+/** vlPacked.h
+ ** ABSTRACT: bit-packed binary images and word-parallel morphology
+ **
+ * A packed image stores one bit per pixel, 64 pixels per word, rows padded
+ * to whole words. Bit x%64 of word x/64 is set where the equivalent BINARY
+ * vlImage pixel is non zero (255), so every operator here gives exactly
+ * the result of its BINARY counterpart; padding bits are always 0.
+ **/
+
+#ifndef __PACKED_H__
+#define __PACKED_H__
+
+#include "vislib.h"
+
+#ifdef _MSC_VER
+typedef unsigned __int64 vlWord;
+#else
+typedef unsigned long long vlWord;
+#endif
+
+#define VL_WORD_BITS 64
+#define VL_PACKED_WORDS(width) (((width) + VL_WORD_BITS - 1) / VL_WORD_BITS)
+
+/* packed binary image */
+typedef struct {
+  int width;			/* # of columns */
+  int height;			/* # of rows */
+  int words;			/* # of words per row */
+  vlWord *bits;			/* height*words words */
+  vlWord *scratch;		/* rows of the operators, grown on demand */
+  int scratchSize;		/* # of allocated scratch words */
+} vlPackedImage;
+
+/* create/destroy */
+vlPackedImage *vlPackedCreate (int width, int height);
+void vlPackedDestroy (vlPackedImage *image);
+int vlPackedInit (vlPackedImage *image, int width, int height);
+int vlPackedCopy (vlPackedImage *src, vlPackedImage *dest);
+
+/* conversions from/to BINARY vlImages */
+int vlBinary2Packed (vlImage *src, vlPackedImage *dest);
+int vlPacked2Binary (vlPackedImage *src, vlImage *dest);
+
+/* packed equivalents of the binary image producers */
+int vlBinaryPacked (vlImage *src, vlHSI_carl_tol_t *para, vlPackedImage *dest);
+int vlRgbFilterPacked (vlImage *src, vlObject *object, vlWindow *window,
+		       vlPackedImage *dest);
+int vlHsiFilterPacked (vlImage *src, vlObject *object, vlWindow *window,
+		       vlPackedImage *dest);
+int vlGray2BinaryPacked (vlImage *src, int threshold, vlWindow *window,
+			 vlPackedImage *dest);
+
+/* morphology (same support and borders as vlBinaryErode/Dilate),
+   dest may be src */
+int vlPackedErode (vlPackedImage *src, int size, vlWindow *window,
+		   vlPackedImage *dest);
+int vlPackedDilate (vlPackedImage *src, int size, vlWindow *window,
+		    vlPackedImage *dest);
+int vlPackedOpen (vlPackedImage *src, int size, int num, vlWindow *window);
+int vlPackedClose (vlPackedImage *src, int size, int num, vlWindow *window);
+
+/* number of set pixels within window (popcount) */
+int vlPackedCount (vlPackedImage *src, vlWindow *window);
+
+#endif /* __PACKED_H__ */
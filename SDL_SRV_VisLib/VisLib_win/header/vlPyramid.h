@@ -0,0 +1,65 @@
+/** vlPyramid.h
+ ** ABSTRACT: 2x binned image pyramids for coarse to fine searches
+ **
+ * Level k of a pyramid is the picture binned k times: every pixel of level
+ * k is the rounded mean of a 2x2 block of level k-1, channel by channel (a
+ * last odd row or column is dropped), so levels are 1/2, 1/4 and 1/8 of
+ * the picture in each direction. Unlike vlScale, which picks one pixel out
+ * of every block, every pixel of the picture counts: a blob smaller than a
+ * block still shows at the coarse levels. Levels are built in one pass
+ * over the picture, each row of a level as soon as the two rows of the
+ * level above it are done, while they are still in cache.
+ *
+ * Level 0 is the picture itself (not copied). The other levels belong to
+ * the pyramid, which is kept from a frame to the other: they are only
+ * allocated again when the size or format of the picture changes.
+ *
+ * A search on level k covers 4^k times fewer pixels; its result, times
+ * 2^k, is then refined at level 0 within 2^k pixels (vlPyramidWindow).
+ * vlMatchShapePyramid does it for vlMatchShape, vlFindLargestBlobsPyramid
+ * for vlFindLargestBlobs and cal_threshold_pyramid (myhist.h) calibrates
+ * on a level. The levels are plain images of the format of the picture,
+ * so the other operators take them as they are.
+ **/
+
+#ifndef __PYRAMID_H__
+#define __PYRAMID_H__
+
+#include "vislib.h"
+#include "vlLabel.h"
+
+/* the picture and 3 binned levels, 1/2, 1/4 and 1/8 */
+#define VL_PYRAMID_LEVELS 4
+
+typedef struct {
+  int levels;			/* # of levels, the picture included */
+  vlImage *level[VL_PYRAMID_LEVELS];	/* level 0 is the picture */
+
+  /* blocks of a level kept for the labeling at level 0 */
+  unsigned char *mask;
+  int maskSize;
+} vlPyramid;
+
+/* levels <= 0 means VL_PYRAMID_LEVELS */
+vlPyramid *vlPyramidCreate (int levels);
+void vlPyramidDestroy (vlPyramid *pyramid);
+
+/* bin src (any format) into the levels of pyramid */
+int vlPyramidBuild (vlPyramid *pyramid, vlImage *src);
+
+/* window of level 0 (fine) covering window of level (coarse), plus margin
+   pixels of level 0 around it, clipped to the picture */
+int vlPyramidWindow (vlPyramid *pyramid, int level, vlWindow *coarse,
+		     int margin, vlWindow *fine);
+
+/* vlMatchShape of the BINARY picture of pyramid, searched at level first
+   and refined at level 0 around the best match */
+int vlMatchShapePyramid (vlPyramid *pyramid, int level, vlObject *object,
+			 vlWindow *window);
+
+/* vlFindLargestBlobs of the BINARY picture of pyramid, only labeling at
+   level 0 the blocks of level that may hold blobs of minArea pixels */
+int vlFindLargestBlobsPyramid (vlLabeler *labeler, vlPyramid *pyramid,
+			       int level, int k, int minArea, blob *out);
+
+#endif /* __PYRAMID_H__ */
@@ -0,0 +1,86 @@
+/** vlRle.h
+ ** ABSTRACT: run-length encoded binary images
+ **
+ * A RLE image stores, for every row, the sorted list of spans [x1,x2) of
+ * set pixels; a pixel is set where the equivalent BINARY vlImage pixel is
+ * non zero (255). Spans of a row never touch or overlap, so an image has
+ * exactly one encoding. Memory and work scale with the number of spans,
+ * that is with the boundary of the mask, not with the frame size.
+ *
+ * Every operator here gives exactly the result of its BINARY counterpart.
+ * The labeling functions, like vlLabelBlobs, label the clear pixels: they
+ * walk the gaps between the spans.
+ **/
+
+#ifndef __RLE_H__
+#define __RLE_H__
+
+#include "vislib.h"
+#include "vlLabel.h"
+
+/* set pixels [x1,x2) of a row */
+typedef struct {
+  int x1, x2;
+} vlSpan;
+
+/* RLE binary image */
+typedef struct {
+  int width;			/* # of columns */
+  int height;			/* # of rows */
+  int *rows;			/* row j is spans[rows[j]..rows[j+1]) */
+  int maxRows;
+  vlSpan *spans;
+  int numSpans, maxSpans;
+} vlRleImage;
+
+/* scratch space of the allocation-free RLE open/close, as vlMorphScratch:
+   create one per processing loop, it only grows */
+typedef struct {
+  vlRleImage spread;		/* widened source rows */
+  vlRleImage acc;		/* union of the widened rows around a row */
+  vlRleImage out;		/* result, then the former buffers of dest */
+  int *head;			/* 2*size span cursors */
+  int size;
+} vlRleScratch;
+
+/* create/destroy */
+vlRleImage *vlRleCreate (int width, int height);
+void vlRleDestroy (vlRleImage *image);
+int vlRleInit (vlRleImage *image, int width, int height);
+int vlRleCopy (vlRleImage *src, vlRleImage *dest);
+
+/* conversions from/to BINARY vlImages */
+int vlBinary2Rle (vlImage *src, vlRleImage *dest);
+int vlRle2Binary (vlRleImage *src, vlImage *dest);
+
+/* RLE equivalents of the binary image producers, no dense mask is built */
+int vlBinaryRle (vlImage *src, vlHSI_carl_tol_t *para, vlRleImage *dest);
+int vlRgbFilterRle (vlImage *src, vlObject *object, vlWindow *window,
+		    vlRleImage *dest);
+int vlNrgFilterRle (vlImage *src, vlObject *object, vlWindow *window,
+		    vlRleImage *dest);
+int vlHsiFilterRle (vlImage *src, vlObject *object, vlWindow *window,
+		    vlRleImage *dest);
+
+/* morphology (same support and borders as vlBinaryErode/Dilate),
+   dest may be src */
+int vlRleErode (vlRleImage *src, int size, vlWindow *window,
+		vlRleImage *dest);
+int vlRleDilate (vlRleImage *src, int size, vlWindow *window,
+		 vlRleImage *dest);
+int vlRleOpen (vlRleImage *src, int size, int num, vlWindow *window);
+int vlRleClose (vlRleImage *src, int size, int num, vlWindow *window);
+vlRleScratch *vlRleScratchCreate (void);
+void vlRleScratchDestroy (vlRleScratch *scratch);
+int vlRleOpenScratch (vlRleImage *src, int size, int num, vlWindow *window,
+		      vlRleScratch *scratch);
+int vlRleCloseScratch (vlRleImage *src, int size, int num, vlWindow *window,
+		       vlRleScratch *scratch);
+
+/* labeling of the clear pixels, as vlLabelBlobs (no paint) and
+   vlFindLargestBlobs */
+int vlRleLabelBlobs (vlLabeler *labeler, vlRleImage *src);
+int vlRleLargestBlobs (vlLabeler *labeler, vlRleImage *src, int k,
+		       int minArea, blob *out);
+
+#endif /* __RLE_H__ */
@@ -0,0 +1,65 @@
+/** vlSegment.h
+ ** ABSTRACT: one pass multi-class color segmentation
+ **
+ * Up to VL_MAX_CLASSES vlHSI_carl_tol_t boxes are compiled into three
+ * per-channel tables, as in CMVision: entry v of the H table has bit c set
+ * when v is within the hue range of class c, and so on for S and I. The
+ * class mask of a pixel is then H[h] & S[s] & I[i], whatever the number of
+ * classes. Class c holds exactly the pixels vlBinary sets to 0 for the
+ * thresholds of class c.
+ *
+ * Runs of each class go to the labeler of that class, so one pass over a
+ * frame gives the blobs of all the classes.
+ **/
+
+#ifndef __SEGMENT_H__
+#define __SEGMENT_H__
+
+#include "vislib.h"
+#include "vlLabel.h"
+
+/* bits of a class mask */
+#define VL_MAX_CLASSES 32
+
+typedef unsigned int vlClassMask;
+
+typedef struct {
+  int numClasses;
+  vlHSI_carl_tol_t para[VL_MAX_CLASSES];
+
+  /* per-channel class masks, VL_PIXEL_MAXVAL+1 entries each */
+  vlClassMask *h, *s, *i;
+
+  /* blobs of class c are left in labelers[c] */
+  vlLabeler *labelers[VL_MAX_CLASSES];
+
+  /* row buffers */
+  int width;
+  vlPixel *hsi;
+  vlClassMask *mask;
+  int start[VL_MAX_CLASSES];	/* first column of the open run */
+} vlSegmenter;
+
+vlSegmenter *vlSegmenterCreate (void);
+void vlSegmenterDestroy (vlSegmenter *seg);
+
+/* add a class, its index is returned (or -1) */
+int vlSegmenterAddClass (vlSegmenter *seg, vlHSI_carl_tol_t *para);
+/* same, from a parameter file written by save_sample_hsi_carl_params */
+int vlSegmenterLoadClass (vlSegmenter *seg, const char *file);
+int vlSegmenterClear (vlSegmenter *seg);
+
+/* class masks of n consecutive RGB pixels */
+void vlSegmentRow (vlSegmenter *seg, const vlPixel *src, int n,
+		   vlClassMask *mask);
+
+/* label the blobs of every class of src (RGB): class c has
+   seg->labelers[c]->numBlobs blobs in seg->labelers[c]->blobs[1..n] */
+int vlSegmentBlobs (vlSegmenter *seg, vlImage *src);
+
+/* k largest blobs of at least minArea pixels of every class, class c in
+   out[c*k..c*k+found[c]) (see vlFindLargestBlobs) */
+int vlSegmentLargestBlobs (vlSegmenter *seg, vlImage *src, int k, int minArea,
+			   blob *out, int *found);
+
+#endif /* __SEGMENT_H__ */
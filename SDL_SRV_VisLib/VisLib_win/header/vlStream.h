@@ -0,0 +1,69 @@
+/** vlStream.h
+ ** ABSTRACT: row streaming threshold -> open -> close -> label pipeline
+ **
+ * The stream does what vlBinary, vlBinaryOpen, vlBinaryClose (whole frame
+ * window) and the labeler do in sequence, but one RGB row at a time: each
+ * erosion/dilation only keeps the few rows its structuring element can
+ * still modify, and every finished row goes straight into the labeler.
+ * No full size HSI or BINARY image is ever built, and the blobs are
+ * exactly those of the staged pipeline.
+ *
+ * A stream keeps its buffers between frames, so create one per tracking
+ * loop and reuse it for every frame.
+ **/
+
+#ifndef __STREAM_H__
+#define __STREAM_H__
+
+#include "vislib.h"
+#include "vlLabel.h"
+
+/* one streaming erosion/dilation over the whole frame */
+typedef struct {
+  int dilate;
+  int s1, s2;			/* support [s1,s2) */
+  int x1, x2, y1, y2;		/* source area */
+  int depth;			/* # of rows held, 1-s1 */
+  vlPixel *ring;		/* depth rows, row y in slot y%depth */
+  int *last;			/* last source row reaching each column */
+} vlStreamMorph;
+
+/* pipeline context */
+typedef struct {
+  int width, height;
+  int size, num;
+
+  vlHSI_carl_tol_t para;		/* vlBinary thresholds */
+
+  vlPixel *hsi;			/* one HSI row */
+  vlPixel *binary;		/* one BINARY row */
+
+  /* num erosions, 2*num dilations, num erosions */
+  vlStreamMorph *stages;
+  int numStages;
+
+  vlLabeler *labeler;
+  int row;			/* next input row */
+} vlStream;
+
+vlStream *vlStreamCreate (void);
+void vlStreamDestroy (vlStream *stream);
+
+/* row interface: the labeler must have been started for the same frame
+   (vlLabelerStart or vlLabelerStartLargest), vlStreamFinish returns what
+   vlLabelerFinish returns */
+int vlStreamStart (vlStream *stream, int width, int height,
+		   vlHSI_carl_tol_t *para, int size, int num,
+		   vlLabeler *labeler);
+int vlStreamRow (vlStream *stream, const vlPixel *rgb);
+int vlStreamFinish (vlStream *stream);
+
+/* whole frame: vlBinary, open and close size x size num times, then
+   vlLabelBlobs (no paint) or vlFindLargestBlobs */
+int vlStreamLabelBlobs (vlStream *stream, vlImage *src, vlHSI_carl_tol_t *para,
+			int size, int num, vlLabeler *labeler);
+int vlStreamLargestBlobs (vlStream *stream, vlImage *src,
+			  vlHSI_carl_tol_t *para, int size, int num,
+			  vlLabeler *labeler, int k, int minArea, blob *out);
+
+#endif /* __STREAM_H__ */
@@ -0,0 +1,24 @@
+/** vlThread.h
+ ** ABSTRACT: minimal fork/join helper for the parallel operators
+ **
+ * vlThreadRun calls fn(arg, i) for every i in [0,n), each on its own
+ * thread (i=0 runs on the calling thread), and returns once all of them
+ * are done. Win32 threads are used on Windows, POSIX threads elsewhere.
+ **/
+
+#ifndef __THREAD_H__
+#define __THREAD_H__
+
+#include "vislib.h"
+
+/* upper bound of n */
+#define VL_MAX_THREADS 16
+
+typedef void (*vlThreadFunc) (void *arg, int index);
+
+int vlThreadRun (int n, vlThreadFunc fn, void *arg);
+
+/* number of processors, at least 1 and at most VL_MAX_THREADS */
+int vlThreadCount (void);
+
+#endif /* __THREAD_H__ */
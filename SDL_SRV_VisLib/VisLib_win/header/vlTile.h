@@ -0,0 +1,87 @@
+/** vlTile.h
+ ** ABSTRACT: multi-threaded execution of the window operators by bands
+ **
+ * vlTileRun cuts the rows of a window in horizontal bands and runs an
+ * unchanged operator (vlSmooth, vlRgbFilter, ...) on every band, each on
+ * its own thread. A band is a view of the rows of src it needs, with no
+ * copy: its own rows and halo rows above and below, as many as the reach
+ * of the operator (e.g. size for a size x size square). The operator sees
+ * them as a picture whose window is the part of window within them, so
+ * the halo rows are filtered as well (as separable operators need) but
+ * are thrown away: only the own rows of every band go to dest, which is
+ * then what the operator gives on the whole window. Bands only cover the
+ * rows of window: the rows above and below it are copied from src for
+ * the operators that copy src out of window (vlSmooth, ...), and left
+ * alone for the others (vlRgbFilter, ...), as the operator would.
+ *
+ * An operator fits if it writes a dest of the size of its src and gives
+ * pixels that depend on the src pixels within halo rows only. Bands write
+ * their own images, stitched into dest once all of them are done. The
+ * bands and their images are in the vlTiler, kept from a frame to the
+ * other; several tilers may run at once.
+ *
+ * Banding has a cost of its own: threads are started on every call, the
+ * bands are copied into dest, and 2*halo rows are computed twice at every
+ * boundary between bands. It pays for operators of more than about a
+ * millisecond per frame (smoothing, median, morphology, convolution of a
+ * VGA picture) whose bands are many times taller than 2*halo; a cheap
+ * per pixel operator such as vlRgbFilter gains little, and a large halo
+ * on a small window may even run slower than a single thread.
+ **/
+
+#ifndef __TILE_H__
+#define __TILE_H__
+
+#include "vislib.h"
+#include "vlThread.h"
+
+/* bands have at least this many rows of window, so small windows run on
+   fewer threads */
+#define VL_TILE_MIN_ROWS 16
+
+/* an operator on a band: window is within src, the view of the band */
+typedef int (*vlTileFunc) (vlImage *src, vlWindow *window, vlImage *dest,
+			   void *arg);
+
+typedef struct {
+  int numBands;
+  vlImage *band[VL_MAX_THREADS];	/* dest of each band */
+
+  /* current run */
+  vlTileFunc fn;
+  void *arg;
+  vlImage *src;
+  vlWindow *window;
+  int halo;
+  int first[VL_MAX_THREADS+1];	/* first own row of each band */
+  int status[VL_MAX_THREADS];
+} vlTiler;
+
+/* bands <= 0 uses one band per processor */
+vlTiler *vlTilerCreate (int bands);
+void vlTilerDestroy (vlTiler *tiler);
+
+/* fn(src, window, dest, arg) by bands, halo being the reach of fn in rows
+   and copy TRUE if fn copies the pixels of src out of window to dest */
+int vlTileRun (vlTiler *tiler, vlTileFunc fn, void *arg, int halo, int copy,
+	       vlImage *src, vlWindow *window, vlImage *dest);
+
+/* the operators, as their single-threaded version */
+int vlTileConvolve (vlTiler *tiler, vlImage *src, vlMask *mask,
+		    vlWindow *window, vlImage *dest);
+int vlTileSmooth (vlTiler *tiler, vlImage *src, int size, vlWindow *window,
+		  vlImage *dest);
+int vlTileSmoothMedian (vlTiler *tiler, vlImage *src, int size,
+			vlWindow *window, vlImage *dest);
+int vlTileRgbErode (vlTiler *tiler, vlImage *src, int size, vlWindow *window,
+		    vlImage *dest);
+int vlTileRgbDilate (vlTiler *tiler, vlImage *src, int size,
+		     vlWindow *window, vlImage *dest);
+int vlTileRgbFilter (vlTiler *tiler, vlImage *src, vlObject *object,
+		     vlWindow *window, vlImage *dest);
+int vlTileHsiFilter (vlTiler *tiler, vlImage *src, vlObject *object,
+		     vlWindow *window, vlImage *dest);
+int vlTileRgb2Hsi (vlTiler *tiler, vlImage *src, vlWindow *window,
+		   vlImage *dest);
+
+#endif /* __TILE_H__ */
@@ -0,0 +1,59 @@
+/** vlTrack.h
+ ** ABSTRACT: predictive region of interest tracking
+ **
+ * Once an object has been found, the next frame is only thresholded,
+ * opened/closed and labeled inside a window around the position
+ * vlObjectMotionUpdate predicts for it, grown by the object's velocity
+ * and by margin pixels per consecutive miss. After maxMisses misses in a
+ * row (the nofound counter of the robot loop) the whole frame is searched
+ * again until the object is reacquired.
+ *
+ * The window is thresholded and opened/closed with a halo of 4*size*num
+ * pixels per side (clipped to the frame) around it, as far as the
+ * erosions and dilations reach, so every pixel of the window gets the
+ * value the full frame pipeline gives it. Only the window is labeled: a
+ * blob lying in the window is found as the full frame pipeline finds it,
+ * a blob crossing its border is cut to the part within it. margin is then
+ * only for the motion expected before the velocity is known.
+ **/
+
+#ifndef __TRACK_H__
+#define __TRACK_H__
+
+#include "vislib.h"
+#include "vlLabel.h"
+
+#define VL_TRACK_MAX_MISSES_DEFAULT 5
+
+typedef struct {
+  vlObject *object;		/* position, velocity and prediction */
+  int misses;			/* consecutive frames without the object */
+  int maxMisses;		/* full frame search after that many misses */
+  int margin;			/* window growth, pixels per side */
+  int minArea;			/* smallest blob taken for the object */
+
+  vlWindow window;		/* last window searched, frame coordinates */
+  vlWindow region;		/* window and its halo, frame coordinates */
+
+  vlImage roi;			/* BINARY image of the region, then of the
+				   window */
+  int roiSize;			/* # of pixels allocated in roi */
+  vlPixel *hsi;			/* one HSI row */
+  int hsiSize;
+
+  vlMorphScratch *scratch;
+  vlLabeler *labeler;
+} vlTracker;
+
+vlTracker *vlTrackerCreate (int maxMisses, int margin, int minArea);
+void vlTrackerDestroy (vlTracker *tracker);
+
+/* forget the object: the next vlTrack searches the whole frame */
+int vlTrackerReset (vlTracker *tracker);
+
+/* find the object in src (RGB): vlBinary, open and close size x size num
+   times and keep the largest blob, in frame coordinates */
+int vlTrack (vlTracker *tracker, vlImage *src, vlHSI_carl_tol_t *para,
+	     int size, int num, blob *found);
+
+#endif /* __TRACK_H__ */
@@ -0,0 +1,59 @@
+/** vlYuv.h
+ ** ABSTRACT: YCbCr (YUV) images and their thresholding
+ **
+ * The SRV-1 sends JPEG frames, which are YCbCr inside. libjpeg decodes
+ * them straight to YCbCr when out_color_space is JCS_YCbCr, and a view
+ * over the decoded rows is a YUV vlImage8: Y, Cb then Cr, 0-255 each,
+ * as JFIF defines them. Such a frame is thresholded where it is, with
+ * no conversion to RGB or HSI:
+ *
+ *  - against a vlYuvRange, the inclusive Y/U/V bounds of a color bin of
+ *    the robot's own vision (YUVRange in surveyor.h, U is Cb and V is Cr),
+ *    so that host and robot classify the same pixels;
+ *  - against a CbCr segmentation map, VL_CBCR_MAP_SIZE bytes indexed by
+ *    the packed CbCr value of the pixel as SegmentMapCbCr of embedcv
+ *    fills them (Cb is the first byte of the packed value). Y is ignored.
+ *
+ * As vlBinary does, the pixels of the color are set to 0 and the others
+ * to 255, ready for the labeler.
+ **/
+
+#ifndef __YUV_H__
+#define __YUV_H__
+
+#include "vislib.h"
+#include "vlImage8.h"
+
+/* fixed point of the JFIF conversions, as in libjpeg (jccolor/jdcolor) */
+#define VL_YUV_SCALEBITS 16
+#define VL_YUV_HALF (1 << (VL_YUV_SCALEBITS-1))
+#define VL_YUV_FIX(x) ((int) ((x) * (1 << VL_YUV_SCALEBITS) + 0.5))
+#define VL_YUV_CBCR_OFFSET (128 << VL_YUV_SCALEBITS)
+
+/* # of entries of a CbCr segmentation map */
+#define VL_CBCR_MAP_SIZE 65536
+
+/* inclusive bounds of a color bin */
+typedef struct {
+  vlPixel8 y_min, y_max;
+  vlPixel8 u_min, u_max;
+  vlPixel8 v_min, v_max;
+} vlYuvRange;
+
+/* set range from the packed (from<<8 | to) values of YUVRange(Y, U, V) */
+int vlYuvRangeSet (vlYuvRange *range, int y, int u, int v);
+
+/* add the U/V box of range to a CbCr map (Y is dropped), as
+   SegmentMapCbCr adds a circle: the map is not cleared first */
+int vlCbCrMapRange (unsigned char *map, vlYuvRange *range,
+		    unsigned char value);
+
+/* thresholding of a YUV picture into a BINARY one */
+int vlBinaryYuv8 (vlImage8 *src, vlYuvRange *range, vlImage8 *dest);
+int vlBinaryCbCr8 (vlImage8 *src, const unsigned char *map, vlImage8 *dest);
+
+/* JFIF conversions, with the fixed point arithmetic of libjpeg */
+int vlRgb82Yuv8 (vlImage8 *src, vlWindow *window, vlImage8 *dest);
+int vlYuv82Rgb8 (vlImage8 *src, vlWindow *window, vlImage8 *dest);
+
+#endif /* __YUV_H__ */
@@ -1,35 +1,69 @@
+/** yuv2rgb.h
+ ** ABSTRACT: conversion of raw YUV video frames to 8-bit RGB
+ **
+ * A vlYuvFrame describes a raw frame, whatever its size and chroma layout:
+ * planar 4:2:0 (I420) or 4:2:2, or packed 4:2:2 (YUYV, or UYVY as the
+ * SRV-1 camera sends it). vlYuvConvert writes it into a RGB vlImage8, so
+ * into a view with its own stride and channel order (e.g. a locked SDL
+ * surface) as well. The arithmetic is the JFIF one of vlYuv82Rgb8; the
+ * SSSE3 kernel gives exactly the values of the C code.
+ *
+ * All the state is in the vlYuvConverter: its row buffers, and the number
+ * of bands of rows converted by as many threads. Frames of several
+ * cameras can be converted at once, each with its own converter.
+ **/
+
 #ifndef __YUV2RGB_H
 #define __YUV2RGB_H
 
 #include "vislib.h"
+#include "vlImage8.h"
+#include "vlThread.h"
 
-#define limit(x) ( (x > 255) ? 255 : ( (x < 0) ? 0 : x ) )
+/* chroma layouts of the raw frames */
+typedef enum {
+  VL_YUV_I420,			/* planar 4:2:0, U and V at half width/height */
+  VL_YUV_422P,			/* planar 4:2:2, U and V at half width */
+  VL_YUV_YUYV,			/* packed 4:2:2, Y0 U Y1 V */
+  VL_YUV_UYVY			/* packed 4:2:2, U Y0 V Y1 */
+} vlYuvLayout;
 
-#define CLIP        320
-#define RED_NULL    128
-#define BLUE_NULL   128
-#define LUN_MUL     256
-#define RED_MUL     512
-#define BLUE_MUL    512
+/* raw frame. Strides are in bytes; packed frames only use y and yStride */
+typedef struct {
+  vlYuvLayout layout;
+  int width, height;
+  const unsigned char *y, *u, *v;
+  int yStride, uStride, vStride;
+} vlYuvFrame;
 
-#define GREEN1_MUL  (-RED_MUL/2)
-#define GREEN2_MUL  (-BLUE_MUL/6)
-#define RED_ADD     (-RED_NULL  * RED_MUL)
-#define BLUE_ADD    (-BLUE_NULL * BLUE_MUL)
-#define GREEN1_ADD  (-RED_ADD/2)
-#define GREEN2_ADD  (-BLUE_ADD/6)
+/* per-converter state, nothing is shared between converters. The frame
+   is cut in numBands horizontal bands converted in parallel */
+typedef struct {
+  int numBands;
+  int width;			/* row buffers hold this many pixels */
+  unsigned char *rows[VL_MAX_THREADS];	/* Y, U, V of a packed row */
 
+  /* current conversion */
+  vlYuvFrame *frame;
+  vlImage8 *dest;
+  int simd;
+  int first[VL_MAX_THREADS+1];	/* first row of each band */
+} vlYuvConverter;
 
+/* describe a contiguous frame at data (planes one after the other) */
+int vlYuvFrameSet (vlYuvFrame *frame, vlYuvLayout layout, int width,
+		   int height, const void *data);
 
-#define Gray(val)               ng_yuv_gray[val]
-#define Red(gray,red)           ng_clip[ CLIP + gray + ng_yuv_red[red] ]
-#define Green(gray,red,blue)    ng_clip[ CLIP + gray + ng_yuv_g1[red] + \
-                                                      ng_yuv_g2[blue] ]
-#define Blue(gray,blue)         ng_clip[ CLIP + gray + ng_yuv_blue[blue] ]
+/* bands <= 0 uses one band per processor */
+vlYuvConverter *vlYuvConverterCreate (int bands);
+void vlYuvConverterDestroy (vlYuvConverter *conv);
 
+/* convert frame into dest (RGB, in place if a view of the frame size) */
+int vlYuvConvert (vlYuvConverter *conv, vlYuvFrame *frame, vlImage8 *dest);
 
+/* former interface: a WIDTH x HEIGHT (global.h) I420 frame to a RGB
+   vlPixel array. yuv2rgb_init is not needed any more */
 void yuv2rgb_init(void);
 void yuv2rgb(unsigned char*, vlPixel*);
 
 #endif
-
@@ -1,4 +1,6 @@
 #include <stdio.h>
+#include <string.h>
+#include <math.h>
 #include "vislib.h"
 #include "global.h"
 #include "a_hsi_carl.h"
@@ -50,12 +52,12 @@ void centroid (vlImage* pic, int nobject, blob *blobs)
 	baricx=0;
 	weight=0;
 
-	for (i=ROW_FROM_INDEX(blobs[nobject].topleft); i<HEIGHT;i++)
+	for (i=blobs[nobject].topleft/pic->width; i<pic->height;i++)
 	{
 		find=FALSE;
-		for (j=0;j<WIDTH;j++)
+		for (j=0;j<pic->width;j++)
 		{
-			if (pic->pixel[INDEX_FROM_RC(i,j)]==nobject)/*blob id(1-255)*/
+			if (pic->pixel[i*pic->width+j]==nobject)/*blob id*/
 			{
 				find=TRUE;
 				baricx+=i;
@@ -80,6 +82,113 @@ void centroid (vlImage* pic, int nobject, blob *blobs)
 
 }
 
+/* *********************************************************************************************************
+* Moments of a blob, accumulated run by run while labeling. The sums over a
+* run of columns y1..y2-1 have closed forms, so the cost is per run, not per
+* pixel.
+*/
+
+/* sum of k*k for k=0..n */
+#define SUM_SQUARES(n) ((double)(n)*((n)+1)*(2*(n)+1)/6.0)
+
+void vlBlobAddRun (blob *b, int x, int y1, int y2, int width)
+{
+	double n=y2-y1;
+	double sumy=n*(y1+y2-1)/2.0;
+	int index=x*width+y1;
+
+	if (b->m00==0)
+	{
+		b->topleft=index;
+		b->xmin=b->xmax=x;
+		b->ymin=y1;
+		b->ymax=y2-1;
+	}
+	else
+	{
+		if (index<b->topleft) b->topleft=index;
+		if (x<b->xmin) b->xmin=x;
+		if (x>b->xmax) b->xmax=x;
+		if (y1<b->ymin) b->ymin=y1;
+		if (y2-1>b->ymax) b->ymax=y2-1;
+	}
+
+	b->area+=y2-y1;
+	b->m00+=n;
+	b->m10+=n*x;
+	b->m01+=sumy;
+	b->m11+=sumy*x;
+	b->m20+=n*x*x;
+	b->m02+=SUM_SQUARES(y2-1)-SUM_SQUARES(y1-1);
+}
+
+void vlBlobMerge (blob *dest, const blob *src)
+{
+	if (src->m00==0)
+		return;
+
+	if (dest->m00==0)
+	{
+		*dest=*src;
+		return;
+	}
+
+	if (src->topleft<dest->topleft) dest->topleft=src->topleft;
+	if (src->xmin<dest->xmin) dest->xmin=src->xmin;
+	if (src->xmax>dest->xmax) dest->xmax=src->xmax;
+	if (src->ymin<dest->ymin) dest->ymin=src->ymin;
+	if (src->ymax>dest->ymax) dest->ymax=src->ymax;
+
+	dest->area+=src->area;
+	dest->m00+=src->m00;
+	dest->m10+=src->m10;
+	dest->m01+=src->m01;
+	dest->m11+=src->m11;
+	dest->m20+=src->m20;
+	dest->m02+=src->m02;
+}
+
+void vlBlobTranslate (blob *b, int dx, int dy, int fromWidth, int toWidth)
+{
+	double m10=b->m10, m01=b->m01;
+
+	if (b->m00==0)
+		return;
+
+	b->topleft=(b->topleft/fromWidth+dx)*toWidth+b->topleft%fromWidth+dy;
+	b->xmin+=dx;
+	b->xmax+=dx;
+	b->ymin+=dy;
+	b->ymax+=dy;
+
+	/*moments of (x+dx, y+dy)*/
+	b->m10+=dx*b->m00;
+	b->m01+=dy*b->m00;
+	b->m11+=dy*m10+dx*m01+(double)dx*dy*b->m00;
+	b->m20+=2.0*dx*m10+(double)dx*dx*b->m00;
+	b->m02+=2.0*dy*m01+(double)dy*dy*b->m00;
+
+	vlBlobMoments (b);
+}
+
+void vlBlobMoments (blob *b)
+{
+	double mu20, mu02, mu11;
+
+	if (b->m00==0)
+		return;
+
+	/*same integer truncation as centroid()*/
+	b->xcentroid=(int)(b->m10/b->m00);
+	b->ycentroid=(int)(b->m01/b->m00);
+
+	/*central moments give the principal axis*/
+	mu20=b->m20-b->m10*b->m10/b->m00;
+	mu02=b->m02-b->m01*b->m01/b->m00;
+	mu11=b->m11-b->m10*b->m01/b->m00;
+	b->orientation=(float)(0.5*atan2(2.0*mu11, mu20-mu02));
+}
+
 /* *********************************************************************************************************
 * Clears the image borders, to eliminate need for border checking in vlFindBlob
 */
@@ -129,82 +238,39 @@ void vlFindBlob (vlImage* pic, int n, int i, int j,blob *blobs)
 }
 
 
-static void vlFindBlobStack(vlImage *pic, int n, int index, blob *blobs)
-{    
-	sqstack s;
-	int w=pic->width;
-	int h=pic->height;
-	int lastIndex=w*h-1;
-	int i,j;
+/* *********************************************************************************************************
+* labels all blobs into the caller's fixed table (ids 1..BLOB_MAX_NUM-1).
+* Uses the run-length labeler of label.cpp; callers that must not lose
+* cluttered frames should keep a vlLabeler and call vlLabelBlobs directly.
+*/
 
-	initstack(&s);
+int vlFindAllBlobs(vlImage *pic, blob *blobs)
+{
+	int blobnumber;
+	vlLabeler *labeler;
 
-    push(&s, index);
-	while(pop(&s,&index))
-    {
-		i=index/w;
-		j=index%w;
-		
-		if(pic->pixel[index]==0)
-		{
-			pic->pixel[index]=n;
-			blobs[n].area++; 
-		
-			if(i>0)
-			{
-				push(&s, index-w);
-				if(j<w-1)
-					push(&s, index-w+1);
-				if(j>0)
-					push(&s, index-w-1);
-			}
-			if(i<h-1)
-			{
-				push(&s, index+w);
-				if(j<w-1)
-					push(&s, index+w+1);
-				if(j>0)
-					push(&s, index+w-1);
-			}
-			if(j-1>=0)
-				push(&s, index-1);
-			if(j+1<=w-1)
-				push(&s, index+1);
-		}
+	if (!pic) {
+		VL_ERROR ("FindAllBlobs error: NULL image\n");
+		return (-1);		/* failure */
 	}
-	destroystack(&s);
-}
 
-int vlFindAllBlobs(vlImage *pic, blob *blobs)
-{
-	int i,  blobnumber;
-	
-	  if (!pic) {
-	    VL_ERROR ("FindAllBlobs error: NULL image\n");
-	    return (-1);		/* failure */
-	  }
-	  
-
-	long totalPixels=(pic->width)*(pic->height);
-
-	pic->format=GRAY;
-	blobnumber=1;
-	totalPixels=pic->width*pic->height;
-       for (i=0;i<totalPixels;i++)
-	{ 
-	          if (pic->pixel[i]==0) 
-		   {	
-			     blobs[blobnumber].topleft=i;
-			     vlFindBlobStack (pic, blobnumber, i, blobs);
-			     blobnumber++;
-			     if (blobnumber>BLOB_MAX_NUM)
-			      {
-					VL_ERROR("Blob error: Too many blobs!\n");
-					return (-1);
-			       }
-		   }
-        }
-	return blobnumber-1;
+	if (NULL == (labeler = vlLabelerCreate ())) {
+		return (-1);		/* failure */
+	}
+
+	blobnumber=vlLabelBlobs(labeler, pic, TRUE);
+	if (blobnumber>=BLOB_MAX_NUM)
+	{
+		VL_ERROR("Blob error: Too many blobs!\n");
+		blobnumber=-1;
+	}
+	else if (blobnumber>0)
+	{
+		memcpy(blobs+1, labeler->blobs+1, blobnumber*sizeof(blob));
+	}
+
+	vlLabelerDestroy(labeler);
+	return blobnumber;
 }	
 
 int vlGetMaxAreaBlob(int numberBlobs, blob *blobs)
@@ -0,0 +1,191 @@
+/*****************************************************************************
+ *
+ * FILE:     colortable.cpp
+ *
+ * ABSTRACT: precompiled RGB color class table. Thresholding a frame costs
+ *           one table lookup per pixel instead of a RGB to HSI conversion
+ *           and six comparisons.
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vislib.h"
+#include "vlColorTable.h"
+
+
+vlColorTable *
+vlColorTableCreate (int bits)
+{
+  vlColorTable *table;
+
+  if ((bits != 5) && (bits != 6) && (bits != 8)) {
+    VL_ERROR ("vlColorTableCreate: error: bits must be 5, 6 or 8\n");
+    return (NULL);
+  }
+
+  if (NULL == (table = (vlColorTable *) calloc (1, sizeof(vlColorTable)))) {
+    VL_ERROR ("vlColorTableCreate: malloc failed\n");
+    return (NULL);
+  }
+
+  /* one bit per color, 2^(3*bits) colors */
+  table->member = (unsigned char *) malloc (((size_t) 1 << (3*bits)) / 8);
+  if (!table->member) {
+    VL_ERROR ("vlColorTableCreate: malloc failed\n");
+    VL_FREE (table);
+    return (NULL);
+  }
+  table->bits = bits;
+  table->built = FALSE;
+
+  return (table);
+}
+
+
+void
+vlColorTableDestroy (vlColorTable *table)
+{
+  if (table) {
+    VL_FREE (table->member);
+    VL_FREE (table);
+  }
+}
+
+
+/******************************************************************************
+ *
+ * vlColorTableSet --
+ *	classify every quantized RGB color with the vlBinary thresholds of
+ *      para. Colors are thresholded a row of blue values at a time with
+ *      vlBinaryRow, so the table agrees with vlBinary bit for bit.
+ *
+ * RETURNS:
+ *   On success, 0 is returned. Otherwise, -1.
+ *
+ *****************************************************************************/
+int
+vlColorTableSet (vlColorTable *table, vlHSI_carl_tol_t *para)
+{
+  int r, g, b, n, shift, half, index;
+  vlPixel *rgb, *hsi, *bin;
+
+  if ((!table) || (!para)) {
+    VL_ERROR ("vlColorTableSet: error: one of the parameters is NULL\n");
+    return (-1);		/* failure */
+  }
+
+  /* up to date */
+  if ((table->built) &&
+      (table->para.h == para->h) && (table->para.h_tol == para->h_tol) &&
+      (table->para.s == para->s) && (table->para.s_tol == para->s_tol) &&
+      (table->para.i == para->i) && (table->para.i_tol == para->i_tol)) {
+    return (0);
+  }
+
+  n = 1 << table->bits;
+  shift = 8 - table->bits;
+  half = shift ? 1 << (shift-1) : 0;	/* cell center */
+
+  /* a row of colors, its HSI values and its BINARY values */
+  rgb = (vlPixel *) malloc (VL_RGB_SIZE (n, 1) + VL_HSI_SIZE (n, 1) +
+			    VL_BINARY_SIZE (n, 1));
+  if (!rgb) {
+    VL_ERROR ("vlColorTableSet: malloc failed\n");
+    return (-1);		/* failure */
+  }
+  hsi = rgb + VL_RGB_PIXEL*n;
+  bin = hsi + VL_HSI_PIXEL*n;
+
+  memset (table->member, 0, ((size_t) 1 << (3*table->bits)) / 8);
+  for (r=0; r<n; r++) {
+    for (g=0; g<n; g++) {
+      for (b=0; b<n; b++) {
+	rgb[VL_RGB_PIXEL*b] = (vlPixel) ((r << shift) + half);
+	rgb[VL_RGB_PIXEL*b+1] = (vlPixel) ((g << shift) + half);
+	rgb[VL_RGB_PIXEL*b+2] = (vlPixel) ((b << shift) + half);
+      }
+      vlBinaryRow (rgb, para, n, hsi, bin);
+
+      /* members are the colors within the box, cleared by vlBinary */
+      index = (r*n + g)*n;
+      for (b=0; b<n; b++, index++) {
+	if (!bin[b]) {
+	  table->member[index >> 3] |= (unsigned char) (1 << (index & 7));
+	}
+      }
+    }
+  }
+
+  VL_FREE (rgb);
+
+  table->para = *para;
+  table->built = TRUE;
+
+  return (0);			/* success */
+}
+
+
+/* threshold n consecutive RGB pixels (0-255) with one lookup each */
+void
+vlBinaryTableRow (const vlPixel *src, const vlColorTable *table, int n,
+		  vlPixel *dest)
+{
+  int i, index;
+  int bits = table->bits;
+  int shift = 8 - bits;
+  const unsigned char *member = table->member;
+
+  for (i=0; i<n; i++, src+=VL_RGB_PIXEL) {
+    index = (((src[0] & 255) >> shift) << (2*bits)) |
+	    (((src[1] & 255) >> shift) << bits) |
+	    ((src[2] & 255) >> shift);
+    dest[i] = ((member[index >> 3] >> (index & 7)) & 1) ? 0 : 255;
+  }
+}
+
+
+/******************************************************************************
+ *
+ * vlBinaryTable --
+ *	vlBinary with a color table set by vlColorTableSet: 255 where the
+ *      pixel is out of the HSI box, 0 inside. No HSI image is built.
+ *
+ * RETURNS:
+ *   On success, 0 is returned. Otherwise, -1.
+ *
+ *****************************************************************************/
+int
+vlBinaryTable (vlImage *src, vlColorTable *table, vlImage *dest)
+{
+  int j;
+
+  if ((!src) || (!table) || (!dest)) {
+    VL_ERROR ("vlBinaryTable: error: one of the parameters is NULL\n");
+    return (-1);		/* failure */
+  }
+
+  if (!table->built) {
+    VL_ERROR ("vlBinaryTable: error: table not set\n");
+    return (-1);		/* failure */
+  }
+
+  if (src->format != RGB) {
+    VL_ERROR ("vlBinaryTable: src image is not RGB\n");
+    return (-1);		/* failure */
+  }
+
+  if (0 > vlImageInit (dest, BINARY, src->width, src->height)) {
+    VL_ERROR ("vlBinaryTable: error: could not initialize dest image\n");
+    return (-1);		/* failure */
+  }
+
+  for (j=0; j<src->height; j++) {
+    vlBinaryTableRow (src->pixel + VL_RGB_PIXEL*j*src->width, table,
+		      src->width, dest->pixel + j*src->width);
+  }
+
+  return (0);			/* success */
+}
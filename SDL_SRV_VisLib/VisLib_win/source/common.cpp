@@ -122,6 +122,10 @@ vlImageCreate (vlImageFormat format, int width, int height)
     size = VL_BINARY_SIZE (width, height);
     break;
 
+  case YUV:
+    size = VL_YUV_SIZE (width, height);
+    break;
+
   default:
     VL_ERROR ("vlImageCreate: unsupported image format\n");
     return (image);
@@ -178,6 +182,10 @@ vlImageInit (vlImage *image, vlImageFormat format, int width, int height)
     size = VL_BINARY_SIZE (width, height);
     break;
 
+  case YUV:
+    size = VL_YUV_SIZE (width, height);
+    break;
+
   default:
     VL_ERROR ("vlImageCreate: unsupported image format\n");
     return (-1);		/* failure */
@@ -254,6 +262,10 @@ vlImageCopy (vlImage *src, vlImage *dest)
     size = VL_BINARY_SIZE (width, height);
     break;
 
+  case YUV:
+    size = VL_YUV_SIZE (width, height);
+    break;
+
   default:
     VL_ERROR ("vlImageCopy: unsupported image format\n");
     return (-1);		/* failure */
@@ -26,13 +26,22 @@
  *****************************************************************************/
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
 #include <memory.h>		/* malloc */
 
 #include "vislib.h"
+#include "vlCpu.h"
+
+#ifdef VL_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
 
 /****************************** private functions ****************************/
-static int _vlRGBconvolution (vlImage *src, vlMask *mask, vlWindow *window,
-			       vlImage *dest);
+static int _vlConvolution (vlImage *src, vlMask *mask, vlWindow *window,
+			   vlImage *dest);
 
 
 /* filter image formats  */
@@ -47,7 +56,8 @@ vlConvolve (vlImage *src, vlMask *mask, vlWindow *window, vlImage *dest)
 
   switch(src->format){
   case RGB:
-    return (_vlRGBconvolution(src, mask, window, dest));
+  case GRAY:
+    return (_vlConvolution(src, mask, window, dest));
     break;
   default:
     printf ("vlConvolve: convolution format not implemented yet\n");
@@ -59,16 +69,302 @@ vlConvolve (vlImage *src, vlMask *mask, vlWindow *window, vlImage *dest)
 }
 
 
-/* 2D RGB image convolution */
+/* -----------------------------------------------------------
+   CONVOLUTION ENGINE
+   -----------------------------------------------------------
+ * Rows are converted to float once and the kernel is applied a whole row
+ * at a time, one tap after the other: the channels of a pixel are
+ * consecutive, so a tap is a multiply-add of two contiguous runs of
+ * floats, the same for GRAY and RGB, and the SSE2/AVX2 kernels are plain
+ * vertical loops. Taps go in the order of the former per pixel code
+ * (flipped kernel, row by row), so every output is the very same float
+ * sum, then truncated and clipped to the pixel range. Zero taps are
+ * skipped, which adds nothing.
+ *
+ * A rank-1 kernel whose taps are integers once scaled by a power of two
+ * (box, binomial, Sobel... and their halves or quarters) is run as two
+ * 1-D passes on the integer factors. When the kernel sum of absolute
+ * values times the largest pixel is below 2^24, all the float sums of
+ * both passes, and those of the 2-D path, are exact integers: the result
+ * is the same, for kw+kh instead of kw*kh taps per pixel.
+ */
+
+/* float n-vectors of the row loops */
+#define VL_CONV_VECTOR 8
+
+/* out = n pixels as floats */
+static void
+_vlConvRowFloat (const vlPixel *in, float *out, int n, int simd)
+{
+  int i = 0;
+
+#ifdef VL_X86
+  if (simd) {
+    __m128i zero = _mm_setzero_si128 ();
+
+    for (; i+VL_CONV_VECTOR<=n; i+=VL_CONV_VECTOR) {
+      __m128i p = _mm_loadu_si128 ((const __m128i *) (in+i));
+      _mm_storeu_ps (out+i, _mm_cvtepi32_ps (_mm_unpacklo_epi16 (p, zero)));
+      _mm_storeu_ps (out+i+4, _mm_cvtepi32_ps (_mm_unpackhi_epi16 (p, zero)));
+    }
+  }
+#endif
+
+  for (; i<n; i++) {
+    out[i] = (float) in[i];
+  }
+}
+
+
+#ifdef VL_X86
+VL_TARGET_AVX2 static void
+_vlConvRowTapAVX2 (float *acc, const float *in, float tap, int n, int first)
+{
+  int i;
+  __m256 t = _mm256_set1_ps (tap);
+
+  if (first) {
+    for (i=0; i+VL_CONV_VECTOR<=n; i+=VL_CONV_VECTOR) {
+      _mm256_storeu_ps (acc+i, _mm256_mul_ps (_mm256_loadu_ps (in+i), t));
+    }
+  }
+  else {
+    for (i=0; i+VL_CONV_VECTOR<=n; i+=VL_CONV_VECTOR) {
+      _mm256_storeu_ps (acc+i, _mm256_add_ps (_mm256_loadu_ps (acc+i),
+					      _mm256_mul_ps (_mm256_loadu_ps (in+i), t)));
+    }
+  }
+}
+#endif
+
+
+/* acc = in*tap for the first tap, acc += in*tap for the others. simd is
+   the vlCpu feature to use, 0 for the C code */
+static void
+_vlConvRowTap (float *acc, const float *in, float tap, int n, int first,
+	       int simd)
+{
+  int i = 0;
+
+#ifdef VL_X86
+  if (simd & VL_CPU_AVX2) {
+    _vlConvRowTapAVX2 (acc, in, tap, n, first);
+    i = n - n%VL_CONV_VECTOR;
+  }
+  else if (simd & VL_CPU_SSE2) {
+    __m128 t = _mm_set1_ps (tap);
+
+    for (; i+4<=n; i+=4) {
+      __m128 p = _mm_mul_ps (_mm_loadu_ps (in+i), t);
+      _mm_storeu_ps (acc+i, first ? p : _mm_add_ps (_mm_loadu_ps (acc+i), p));
+    }
+  }
+#endif
+
+  if (first) {
+    for (; i<n; i++) {
+      acc[i] = in[i] * tap;
+    }
+  }
+  else {
+    for (; i<n; i++) {
+      acc[i] += in[i] * tap;
+    }
+  }
+}
+
+
+/* out = n sums times scale, truncated and clipped to [0,VL_PIXEL_MAXVAL] */
+static void
+_vlConvRowPixel (const float *in, float scale, vlPixel *out, int n, int simd)
+{
+  int i = 0;
+  float v;
+
+#ifdef VL_X86
+  if (simd) {
+    __m128 s = _mm_set1_ps (scale);
+    __m128 zero = _mm_setzero_ps ();
+    __m128 max = _mm_set1_ps ((float) VL_PIXEL_MAXVAL);
+    __m128i bias = _mm_set1_epi32 (32768);
+    __m128i flip = _mm_set1_epi16 ((short) 0x8000);
+
+    for (; i+VL_CONV_VECTOR<=n; i+=VL_CONV_VECTOR) {
+      __m128 lo = _mm_min_ps (_mm_max_ps (_mm_mul_ps (_mm_loadu_ps (in+i), s), zero), max);
+      __m128 hi = _mm_min_ps (_mm_max_ps (_mm_mul_ps (_mm_loadu_ps (in+i+4), s), zero), max);
+
+      /* no unsigned 32 to 16 bit pack in SSE2: pack signed around 32768 */
+      _mm_storeu_si128 ((__m128i *) (out+i),
+			_mm_xor_si128 (_mm_packs_epi32 (_mm_sub_epi32 (_mm_cvttps_epi32 (lo), bias),
+							_mm_sub_epi32 (_mm_cvttps_epi32 (hi), bias)),
+				       flip));
+    }
+  }
+#endif
+
+  for (; i<n; i++) {
+    v = in[i] * scale;
+    out[i] = (v <= 0.0f) ? 0 :
+      (v >= (float) VL_PIXEL_MAXVAL) ? VL_PIXEL_MAXVAL : (vlPixel) v;
+  }
+}
+
+
+/* largest value of the n pixels */
+static int
+_vlConvMaxValue (const vlPixel *in, int n)
+{
+  int i;
+  vlPixel max = 0;
+
+  for (i=0; i<n; i++) {
+    max = (in[i] > max) ? in[i] : max;
+  }
+
+  return (max);
+}
+
+
+/* greatest common divisor of non-negative integers */
+static double
+_vlConvGcd (double a, double b)
+{
+  double t;
+
+  while (b > 0) {
+    t = fmod (a, b);
+    a = b;
+    b = t;
+  }
+
+  return (a);
+}
+
+
+/* split an exact rank-1 kernel (see above) into row (width taps) and col
+   (height taps) integer factors, the kernel being row*col*scale. Returns
+   FALSE when the kernel cannot be run as two exact passes on pixels up to
+   maxValue */
+static int
+_vlConvSeparate (vlMask *mask, int maxValue, float *row, float *col,
+		 float *scale)
+{
+  int x, y, shift, pr, pc;
+  int width = mask->width;
+  int height = mask->height;
+  double k, p, g, rowSum, colSum;
+  float *kernel = mask->kernel;
+
+  /* smallest power of two making all the taps integers */
+  for (shift=0; shift<=16; shift++) {
+    for (x=0; x<width*height; x++) {
+      k = ldexp ((double) kernel[x], shift);
+      if ((k != floor (k)) || (fabs (k) >= 16777216.0)) {
+	break;
+      }
+    }
+    if (x == width*height) {
+      break;
+    }
+  }
+  if (shift > 16) {
+    return (FALSE);
+  }
+
+  /* pivot: the largest tap */
+  pr = pc = 0;
+  for (y=0; y<height; y++) {
+    for (x=0; x<width; x++) {
+      if (fabs (kernel[y*width+x]) > fabs (kernel[pr*width+pc])) {
+	pr = y;
+	pc = x;
+      }
+    }
+  }
+  p = ldexp ((double) kernel[pr*width+pc], shift);
+  if (p == 0) {
+    return (FALSE);
+  }
+
+  /* rank 1: every tap is (its column at pr) * (its row at pc) / pivot */
+  for (y=0; y<height; y++) {
+    for (x=0; x<width; x++) {
+      if (ldexp ((double) kernel[y*width+x], shift) * p !=
+	  ldexp ((double) kernel[pr*width+x], shift) *
+	  ldexp ((double) kernel[y*width+pc], shift)) {
+	return (FALSE);
+      }
+    }
+  }
+
+  /* row = row pr over its gcd, col = column pc times the gcd over pivot */
+  g = 0;
+  for (x=0; x<width; x++) {
+    g = _vlConvGcd (fabs (ldexp ((double) kernel[pr*width+x], shift)), g);
+  }
+  rowSum = colSum = 0;
+  for (x=0; x<width; x++) {
+    row[x] = (float) (ldexp ((double) kernel[pr*width+x], shift) / g);
+    rowSum += fabs (row[x]);
+  }
+  for (y=0; y<height; y++) {
+    k = ldexp ((double) kernel[y*width+pc], shift) * g / p;
+    if (k != floor (k)) {
+      return (FALSE);
+    }
+    col[y] = (float) k;
+    colSum += fabs (k);
+  }
+
+  /* all the sums are exact */
+  if (rowSum * colSum * maxValue >= 16777216.0) {
+    return (FALSE);
+  }
+
+  *scale = (float) ldexp (1.0, -shift);
+  return (TRUE);
+}
+
+
+/* dest = src outside the [c1,c2) x [r1,r2) pixels computed by the
+   convolution, for n values per pixel */
+static void
+_vlConvCopyBorders (vlImage *src, vlImage *dest, int n,
+		    int c1, int c2, int r1, int r2)
+{
+  int j;
+  int rowSize = n * src->width;
+
+  if ((c1 >= c2) || (r1 >= r2)) {
+    r1 = r2 = 0;
+  }
+
+  for (j=0; j<src->height; j++) {
+    vlPixel *in = src->pixel + j*rowSize;
+    vlPixel *out = dest->pixel + j*rowSize;
+
+    if ((j < r1) || (j >= r2)) {
+      memcpy (out, in, rowSize * sizeof(vlPixel));
+    }
+    else {
+      memcpy (out, in, n * c1 * sizeof(vlPixel));
+      memcpy (out + n*c2, in + n*c2, (rowSize - n*c2) * sizeof(vlPixel));
+    }
+  }
+}
+
+
+/* 2D RGB or GRAY image convolution. Pixels of window the kernel fits in
+   around are computed, all the others are copied from src */
 static int
-_vlRGBconvolution (vlImage *src, vlMask *mask, vlWindow *window,
-		   vlImage *dest)
+_vlConvolution (vlImage *src, vlMask *mask, vlWindow *window,
+		vlImage *dest)
 {
-  int x, y, r, c, r1, r2, c1, c2, row, col;
-  int index, d_index, k_index;
-  int width, height, k_width, k_height, k_width2, k_height2;
-  float *kernel, sum_r, sum_g, sum_b;
-  vlPixel *new_data, *data;
+  int x, y, r, j, r1, r2, c1, c2;
+  int n, width, height, k_width, k_height, k_width2, k_height2;
+  int rowSize, count, first, simd, separable;
+  float *kernel, *rows, *acc, *row_taps, *col_taps;
+  float scale = 1.0f;
 
   width = src->width;
   height = src->height;
@@ -81,79 +377,132 @@ _vlRGBconvolution (vlImage *src, vlMask *mask, vlWindow *window,
       (window->x > width) ||
       (window->x < 0) ||
       (window->y > height) ||
-      (window->y < 0)) {
-    VL_ERROR ("_vlRGBconvolution: illegal window coordinates\n");
+      (window->y < 0) ||
+      (mask->width <= 0) ||
+      (mask->height <= 0)) {
+    VL_ERROR ("_vlConvolution: illegal window coordinates\n");
     return (-1);		/* failure */
   }
 
-  /* duplicate the old image so that the borders are correct */
-  if (0 > vlImageCopy (src, dest)) {
-    VL_ERROR ("_vlRGBconvolution: unable to copy original image\n");
+  if (src == dest) {
+    VL_ERROR ("_vlConvolution: dest must be another image than src\n");
     return (-1);		/* failure */
   }
 
-  r1 = window->y + (mask->height / 2);
-  r2 = window->height - (mask->height / 2);
-  c1 = window->x + (mask->width / 2);
-  c2 = window->width - (mask->width / 2);
-
-  data = src->pixel;
-  new_data = dest->pixel;
+  n = vlPixelSize (src->format);
   kernel = mask->kernel;
   k_width = mask->width;
   k_height = mask->height;
   k_width2 = k_width / 2;
   k_height2 = k_height / 2;
 
-  for (r=r1; r<r2; r++) {
-    for (c=c1; c<c2; c++) {
+  /* computed pixels, the kernel within window and the image */
+  r1 = window->y + k_height2;
+  r2 = VL_MIN (window->y + window->height, height);
+  r2 -= k_height2;
+  c1 = window->x + k_width2;
+  c2 = VL_MIN (window->x + window->width, width);
+  c2 -= k_width2;
 
-      sum_r = sum_g = sum_b = 0;
-      for (y=0; y<k_height; y++) {
-	int yk = y*k_width;
-	int ck2 = c + k_width2;
-	row = r - y + k_height2;
+  if (0 > vlImageInit (dest, src->format, width, height)) {
+    VL_ERROR ("_vlConvolution: could not initialize dest image\n");
+    return (-1);		/* failure */
+  }
+  _vlConvCopyBorders (src, dest, n, c1, c2, r1, r2);
+  if ((r1 >= r2) || (c1 >= c2)) {
+    return (0);			/* success, nothing to compute */
+  }
+
+  /* k_height float rows of the source (or of the row pass), the sums,
+     and the separable factors */
+  rowSize = n * width;
+  count = n * (c2 - c1);
+  rows = (float *) malloc ((k_height+2) * rowSize * sizeof(float) +
+			   (k_width+k_height) * sizeof(float));
+  if (!rows) {
+    VL_ERROR ("_vlConvolution: malloc failed\n");
+    return (-1);		/* failure */
+  }
+  acc = rows + k_height * rowSize;
+  row_taps = acc + 2 * rowSize;
+  col_taps = row_taps + k_width;
 
-	for (x=0; x<k_width; x++) {
-	  k_index = yk + x;
+  simd = 0;
+#ifdef VL_X86
+  simd = vlCpuFeatures () & (VL_CPU_AVX2 | VL_CPU_SSE2);
+#endif
 
-	  /* compute data indexes */
-	  col = ck2 - x;
-	  d_index = (row*width + col) * VL_RGB_PIXEL;
+  separable = (k_width > 1 || k_height > 1) &&
+    _vlConvSeparate (mask, _vlConvMaxValue (src->pixel, rowSize * height),
+		     row_taps, col_taps, &scale);
 
-	  sum_r += data[d_index]   * kernel[k_index];
-	  sum_g += data[d_index++] * kernel[k_index];
-	  sum_b += data[d_index++] * kernel[k_index];
+  /* source rows r1-(k_height-1-k_height2) up to r2+k_height2 are read */
+  for (j=r1-(k_height-1-k_height2); j<r2+k_height2; j++) {
+    float *ring = rows + (j % k_height) * rowSize;
+
+    /* row j, or its row pass, goes in the ring */
+    if (separable) {
+      _vlConvRowFloat (src->pixel + j*rowSize, acc + rowSize, rowSize, simd);
+      for (x=0, first=TRUE; x<k_width; x++) {
+	if (row_taps[x] != 0) {
+	  _vlConvRowTap (ring + n*c1, acc + rowSize + n*(c1+k_width2-x),
+			 row_taps[x], count, first, simd);
+	  first = FALSE;
 	}
       }
+    }
+    else {
+      _vlConvRowFloat (src->pixel + j*rowSize, ring, rowSize, simd);
+    }
+
+    /* output row r, once its last row (r+k_height2) is in */
+    r = j - k_height2;
+    if (r < r1) {
+      continue;
+    }
 
-      index = (r*width + c) * VL_RGB_PIXEL; /* current pixel */
-      new_data[index] = (vlPixel) sum_r;
-      new_data[index++] = (vlPixel) sum_g;
-      new_data[index++] = (vlPixel) sum_b;
+    first = TRUE;
+    for (y=0; y<k_height; y++) {
+      float *in = rows + ((r - y + k_height2) % k_height) * rowSize;
+
+      if (separable) {
+	if (col_taps[y] != 0) {
+	  _vlConvRowTap (acc, in + n*c1, col_taps[y], count, first, simd);
+	  first = FALSE;
+	}
+	continue;
+      }
+      for (x=0; x<k_width; x++) {
+	if (kernel[y*k_width+x] != 0) {
+	  _vlConvRowTap (acc, in + n*(c1+k_width2-x), kernel[y*k_width+x],
+			 count, first, simd);
+	  first = FALSE;
+	}
+      }
+    }
+    if (first) {
+      memset (acc, 0, count * sizeof(float));
     }
+    _vlConvRowPixel (acc, scale, dest->pixel + r*rowSize + n*c1, count, simd);
   }
 
+  VL_FREE (rows);
   return (0);			/* success */
 }
 
 
 
 /* -----------------------------------------------------------
-   FAST SMOOTHER - separable averaging window
+   FAST SMOOTHER - box filter
    ----------------------------------------------------------- */
-/* perform a fast 2D smoothing using separable averaging window */
+/* perform a fast 2D smoothing: mean of the size x size square [s1,s2),
+   from the integral image of src (see vlIntegralSmooth to share it
+   with other operators) */
 int
 vlSmooth (vlImage *src, int size, vlWindow *window, vlImage *dest)
 {
-  int i,j;
-  int index;
-  int width,height;
-  int s1,s2;
-  int x1,x2,y1,y2;
-  int r_sum,g_sum,b_sum;
-  vlPixel *input;
-  vlPixel *output;
+  vlIntegral *ii;
+  int status;
 
   /* verify parameters */
   if ((!src) || (size <= 0) || (!window) || (!dest)) {
@@ -161,117 +510,506 @@ vlSmooth (vlImage *src, int size, vlWindow *window, vlImage *dest)
     return (-1);		/* failure */
   }
   
-  /* RGB only... */
-  if(src->format != RGB){
-    VL_ERROR ("vlSmooth: error: src image is not RGB\n");
+  /* RGB and GRAY only... */
+  if((src->format != RGB) && (src->format != GRAY)){
+    VL_ERROR ("vlSmooth: error: src image is not RGB or GRAY\n");
     return (-1);		/* failure */
   }
 
-  /* extract useful data */
-  width = src->width;
-  height = src->height;
-  input = src->pixel;
+  if (NULL == (ii = vlIntegralCreate ())) {
+    return (-1);		/* failure */
+  }
+
+  status = vlIntegralCompute (ii, src);
+  if (status == 0) {
+    status = vlIntegralSmooth (ii, size, window, dest);
+  }
+
+  vlIntegralDestroy (ii);
+  return (status);
+}
+
+
+/* -----------------------------------------------------------
+   NON LINEAR SMOOTHER - median smoother
+   -----------------------------------------------------------
+ * The median of every size x size square [s1,s2) (as vlSmooth and the
+ * morphology), for each channel, picked in three ways none of which
+ * sorts the square:
+ *
+ * - 3x3 and 5x5, by networks of compare-exchanges (min/max) run on whole
+ *   rows of values at once, in SIMD lanes. The columns of a square are
+ *   sorted first, once per row for the size squares they belong to, then
+ *   a network only computing the median of size sorted columns is run.
+ *   Networks are Batcher's merge sort, with every exchange which does not
+ *   lead to the median removed (and min or max only when the other one
+ *   is not used).
+ *
+ * - other squares of 8-bit values (0-255), by the histogram of the
+ *   square, as Perreault & Hebert's constant time median: one histogram
+ *   per column, updated by one row in and one row out, and the square
+ *   histogram slid by one column in and one column out. Histograms are
+ *   16 coarse bins of 16 fine bins, fine bins of the square being only
+ *   brought up to date in the one coarse bin holding the median, so the
+ *   cost per pixel does not depend on size.
+ *
+ * - otherwise (other squares of larger values), by a selection in the
+ *   values of the square.
+ */
+
+/* compare-exchange networks: CE(a,b) puts the min of variables a and b
+   in a and the max in b, MIN(a,b) only the min, MAX(a,b) only the max.
+   SORTs sort size values, NETs find the median of size sorted columns,
+   value k of column c being variable c*size+k, into variable OUT */
+#define VL_MEDIAN_SORT3(CE, MIN, MAX) \
+  CE(0,1) CE(0,2) CE(1,2)
+
+#define VL_MEDIAN_OUT3 3
+#define VL_MEDIAN_NET3(CE, MIN, MAX) \
+  CE(0,3) CE(1,4) CE(2,5) CE(2,3) CE(1,2) CE(4,3) CE(7,8) \
+  MAX(0,6) MAX(1,7) MIN(2,8) MIN(3,6) MIN(5,7) MAX(2,3) MIN(4,5) \
+  MAX(4,3)
+
+#define VL_MEDIAN_SORT5(CE, MIN, MAX) \
+  CE(0,1) CE(2,3) CE(0,2) CE(1,3) CE(1,2) CE(0,4) CE(2,4) \
+  CE(1,2) CE(3,4)
+
+#define VL_MEDIAN_OUT5 14
+#define VL_MEDIAN_NET5(CE, MIN, MAX) \
+  CE(0,5) CE(1,6) CE(2,7) CE(3,8) CE(4,9) CE(10,15) CE(11,16) \
+  CE(12,17) CE(13,18) CE(14,19) CE(4,5) CE(14,15) CE(2,4) CE(3,6) \
+  CE(7,5) CE(12,14) CE(13,16) CE(17,15) CE(22,24) CE(1,2) CE(3,4) \
+  CE(6,7) CE(8,5) CE(11,12) CE(13,14) CE(16,17) CE(18,15) CE(21,22) \
+  CE(23,24) CE(0,10) CE(1,11) CE(2,12) CE(3,13) CE(4,14) CE(6,16) \
+  CE(7,17) CE(8,18) CE(5,15) CE(9,19) CE(5,10) CE(9,11) CE(4,5) \
+  CE(6,9) CE(7,12) CE(8,13) CE(14,10) CE(16,11) CE(2,4) CE(3,6) \
+  CE(7,5) CE(8,9) CE(12,14) CE(13,16) CE(17,10) CE(18,11) CE(22,24) \
+  CE(1,2) CE(3,4) MAX(6,7) CE(8,5) CE(9,12) CE(13,14) MIN(16,17) \
+  MAX(18,10) CE(11,15) CE(21,22) CE(23,24) MAX(0,20) MAX(1,21) MAX(2,22) \
+  MAX(3,23) MAX(4,24) MIN(10,20) MIN(11,21) MIN(15,22) MIN(19,23) MAX(5,10) \
+  MAX(9,11) MIN(12,15) MIN(13,19) MIN(14,24) MAX(7,12) MAX(8,13) MIN(14,10) \
+  MIN(16,11) MAX(12,14) MIN(13,16) MAX(13,14)
+
+#define VL_MEDIAN_VARS 25	/* of the largest network */
+
+/* the network of size (3 or 5), sort or median */
+#define VL_MEDIAN_NETWORK(size, median, CE, MIN, MAX) \
+  if (median) { \
+    if (size == 3) { VL_MEDIAN_NET3 (CE, MIN, MAX) } \
+    else { VL_MEDIAN_NET5 (CE, MIN, MAX) } \
+  } \
+  else { \
+    if (size == 3) { VL_MEDIAN_SORT3 (CE, MIN, MAX) } \
+    else { VL_MEDIAN_SORT5 (CE, MIN, MAX) } \
+  }
+
+
+/* run the sort or median network of size on values first to count of the
+   rows in; the sort stores its size variables in the rows of out, the
+   median its OUT variable in out[0] */
+static void
+_vlMedianNetworkC (const vlPixel **in, vlPixel **out, int size, int median,
+		   int first, int count)
+{
+  int i, v, vars;
+  vlPixel w[VL_MEDIAN_VARS], t;
+
+  vars = median ? size*size : size;
+  for (i=first; i<count; i++) {
+    for (v=0; v<vars; v++) {
+      w[v] = in[v][i];
+    }
+
+#define VL_CE(a, b) { t = VL_MIN (w[a], w[b]); \
+    w[b] = VL_MAX (w[a], w[b]); w[a] = t; }
+#define VL_CE_MIN(a, b) { t = VL_MIN (w[a], w[b]); w[a] = t; }
+#define VL_CE_MAX(a, b) { t = VL_MAX (w[a], w[b]); w[b] = t; }
+    VL_MEDIAN_NETWORK (size, median, VL_CE, VL_CE_MIN, VL_CE_MAX);
+#undef VL_CE
+#undef VL_CE_MIN
+#undef VL_CE_MAX
+
+    if (median) {
+      out[0][i] = w[(size == 3) ? VL_MEDIAN_OUT3 : VL_MEDIAN_OUT5];
+    }
+    else {
+      for (v=0; v<vars; v++) {
+	out[v][i] = w[v];
+      }
+    }
+  }
+}
+
+
+#ifdef VL_X86
+/* as _vlMedianNetworkC, 16 values at a time; returns the # done */
+VL_TARGET_AVX2 static int
+_vlMedianNetworkAVX2 (const vlPixel **in, vlPixel **out, int size,
+		      int median, int count)
+{
+  int i, v, vars;
+  __m256i w[VL_MEDIAN_VARS], t;
+
+  vars = median ? size*size : size;
+  for (i=0; i+16<=count; i+=16) {
+    for (v=0; v<vars; v++) {
+      w[v] = _mm256_loadu_si256 ((const __m256i *) (in[v]+i));
+    }
+
+#define VL_CE(a, b) { t = _mm256_min_epu16 (w[a], w[b]); \
+    w[b] = _mm256_max_epu16 (w[a], w[b]); w[a] = t; }
+#define VL_CE_MIN(a, b) { w[a] = _mm256_min_epu16 (w[a], w[b]); }
+#define VL_CE_MAX(a, b) { w[b] = _mm256_max_epu16 (w[a], w[b]); }
+    VL_MEDIAN_NETWORK (size, median, VL_CE, VL_CE_MIN, VL_CE_MAX);
+#undef VL_CE
+#undef VL_CE_MIN
+#undef VL_CE_MAX
+
+    if (median) {
+      _mm256_storeu_si256 ((__m256i *) (out[0]+i),
+			   w[(size == 3) ? VL_MEDIAN_OUT3 : VL_MEDIAN_OUT5]);
+    }
+    else {
+      for (v=0; v<vars; v++) {
+	_mm256_storeu_si256 ((__m256i *) (out[v]+i), w[v]);
+      }
+    }
+  }
+
+  return (i);
+}
+
+
+/* as _vlMedianNetworkC, 8 values at a time; returns the # done. SSE2
+   only compares signed 16-bit values, so values are offset by 32768 */
+static int
+_vlMedianNetworkSSE2 (const vlPixel **in, vlPixel **out, int size,
+		      int median, int count)
+{
+  int i, v, vars;
+  __m128i w[VL_MEDIAN_VARS], t;
+  __m128i flip = _mm_set1_epi16 ((short) 0x8000);
+
+  vars = median ? size*size : size;
+  for (i=0; i+8<=count; i+=8) {
+    for (v=0; v<vars; v++) {
+      w[v] = _mm_xor_si128 (_mm_loadu_si128 ((const __m128i *) (in[v]+i)),
+			    flip);
+    }
+
+#define VL_CE(a, b) { t = _mm_min_epi16 (w[a], w[b]); \
+    w[b] = _mm_max_epi16 (w[a], w[b]); w[a] = t; }
+#define VL_CE_MIN(a, b) { w[a] = _mm_min_epi16 (w[a], w[b]); }
+#define VL_CE_MAX(a, b) { w[b] = _mm_max_epi16 (w[a], w[b]); }
+    VL_MEDIAN_NETWORK (size, median, VL_CE, VL_CE_MIN, VL_CE_MAX);
+#undef VL_CE
+#undef VL_CE_MIN
+#undef VL_CE_MAX
+
+    if (median) {
+      t = w[(size == 3) ? VL_MEDIAN_OUT3 : VL_MEDIAN_OUT5];
+      _mm_storeu_si128 ((__m128i *) (out[0]+i), _mm_xor_si128 (t, flip));
+    }
+    else {
+      for (v=0; v<vars; v++) {
+	_mm_storeu_si128 ((__m128i *) (out[v]+i), _mm_xor_si128 (w[v], flip));
+      }
+    }
+  }
+
+  return (i);
+}
+#endif
+
+
+static void
+_vlMedianNetwork (const vlPixel **in, vlPixel **out, int size, int median,
+		  int count, int simd)
+{
+  int first = 0;
+
+#ifdef VL_X86
+  if (simd & VL_CPU_AVX2) {
+    first = _vlMedianNetworkAVX2 (in, out, size, median, count);
+  }
+  else if (simd & VL_CPU_SSE2) {
+    first = _vlMedianNetworkSSE2 (in, out, size, median, count);
+  }
+#endif
+
+  _vlMedianNetworkC (in, out, size, median, first, count);
+}
+
+
+/* output rows y1 to y2 by the network of size. Values i of row j are
+   those of pixels x1 to x2 */
+static int
+_vlMedianByNetwork (vlImage *src, int size, int x1, int x2, int y1, int y2,
+		    vlImage *dest)
+{
+  int c, j, k, n, s1, rowSize, count, simd;
+  const vlPixel *in[VL_MEDIAN_VARS];
+  vlPixel *out[VL_MEDIAN_VARS];
+  vlPixel *columns;
+
+  n = vlPixelSize (src->format);
+  rowSize = n * src->width;
+  s1 = -(size-size/2);
+
+  /* the size sorted values of the columns x1+s1 to x2+s2-1 */
+  count = n * (x2-x1+size-1);
+  if (!(columns = (vlPixel *) malloc (size * count * sizeof(vlPixel)))) {
+    VL_ERROR ("_vlMedianByNetwork: malloc failed\n");
+    return (-1);		/* failure */
+  }
+
+  simd = 0;
+#ifdef VL_X86
+  simd = vlCpuFeatures () & (VL_CPU_AVX2 | VL_CPU_SSE2);
+#endif
+
+  for (j=y1; j<y2; j++) {
+    for (k=0; k<size; k++) {
+      in[k] = src->pixel + (j+s1+k)*rowSize + n*(x1+s1);
+      out[k] = columns + k*count;
+    }
+    _vlMedianNetwork (in, out, size, FALSE, count, simd);
+
+    for (c=0; c<size; c++) {
+      for (k=0; k<size; k++) {
+	in[c*size+k] = columns + k*count + n*c;
+      }
+    }
+    out[0] = dest->pixel + j*rowSize + n*x1;
+    _vlMedianNetwork (in, out, size, TRUE, n*(x2-x1), simd);
+  }
+
+  VL_FREE (columns);
+  return (0);			/* success */
+}
+
+
+/* coarse and fine bins of a 8-bit value */
+#define VL_MEDIAN_BINS 256
+#define VL_MEDIAN_COARSE 16
+
+/* output rows y1 to y2 of values 0-255 from histograms, size < 256 */
+static int
+_vlMedianByHistogram (vlImage *src, int size, int x1, int x2, int y1,
+		      int y2, vlImage *dest)
+{
+  int i, j, k, b, c, n, p, q, r, s1, s2, rowSize, columns, rank, sum;
+  unsigned short *fine, *coarse, *h;
+  const unsigned short *f;
+  unsigned short kCoarse[VL_MEDIAN_COARSE];
+  unsigned short kFine[VL_MEDIAN_BINS];
+  int last[VL_MEDIAN_COARSE];
+  const vlPixel *input;
+  vlPixel *output;
+
+  n = vlPixelSize (src->format);
+  rowSize = n * src->width;
   s2 = size/2;
   s1 = -(size-s2);
-  x1 = VL_MAX(window->x-s1,-s1);
-  x2 = VL_MIN(window->x+window->width,width-s2);
-  y1 = VL_MAX(window->y-s1,-s1);
-  y2 = VL_MIN(window->y+window->height,height-s2);
+  rank = size*size/2;
 
-  /* initialize new pic */
-  if (0 > vlImageInit (dest, RGB, width, height)) {
-    VL_ERROR ("vlSmooth: error: could not initialize dest image\n");
+  /* histograms of the size rows of every channel of columns x1+s1 to
+     x2+s2-1, column p counting from x1+s1 */
+  columns = x2-x1+size-1;
+  fine = (unsigned short *) calloc (columns*n*(VL_MEDIAN_BINS+VL_MEDIAN_COARSE),
+				    sizeof(unsigned short));
+  if (!fine) {
+    VL_ERROR ("_vlMedianByHistogram: malloc failed\n");
     return (-1);		/* failure */
   }
+  coarse = fine + columns*n*VL_MEDIAN_BINS;
 
-  output = dest->pixel;
-  
-  /* copy all the image so that not filtered area is uptodate */
-  memcpy(output,input,3*width*height*sizeof(vlPixel));
-
-  /* horizontal filter */
-
-  /* for each point within filtering window */
-  for(j=y1;j<y2;j++){
-    r_sum = g_sum = b_sum = -1;
-    for(i=x1;i<x2;i++){
-      
-      /* if we are at the beginning of a line */
-      if(r_sum == -1){
-	int ii;
-	int temp_index;
-	
-	index = 3*(j*width+i);
-	r_sum = g_sum = b_sum = 0;
-	for(ii=s1;ii<s2;ii++){
-	  temp_index = index+3*ii;
-	  r_sum += input[temp_index];
-	  g_sum += input[temp_index+1];
-	  b_sum += input[temp_index+2];
-	}
-      } 
-      else {
-	index = 3*(j*width+i);
-	r_sum = r_sum + input[index+3*(s2-1)] - input[index+3*(s1-1)];
-	g_sum = g_sum + input[index+3*(s2-1)+1] - input[index+3*(s1-1)+1];
-	b_sum = b_sum + input[index+3*(s2-1)+2] - input[index+3*(s1-1)+2];
+  for (j=y1+s1; j<y2+s2-1; j++) {
+    /* row j in, row j-size out */
+    input = src->pixel + j*rowSize + n*(x1+s1);
+    for (k=0; k<columns*n; k++) {
+      fine[k*VL_MEDIAN_BINS + input[k]]++;
+      coarse[k*VL_MEDIAN_COARSE + input[k]/VL_MEDIAN_COARSE]++;
+    }
+    if (j-size >= y1+s1) {
+      input -= size*rowSize;
+      for (k=0; k<columns*n; k++) {
+	fine[k*VL_MEDIAN_BINS + input[k]]--;
+	coarse[k*VL_MEDIAN_COARSE + input[k]/VL_MEDIAN_COARSE]--;
       }
+    }
+
+    /* the histograms hold the squares of output row r */
+    r = j-s2+1;
+    if (r < y1) {
+      continue;
+    }
+    output = dest->pixel + r*rowSize;
+
+    for (c=0; c<n; c++) {
+      /* columns 0 to size-2 of the first square, none of the fine bins */
+      memset (kCoarse, 0, sizeof(kCoarse));
+      for (p=0; p<size-1; p++) {
+	h = coarse + (p*n+c)*VL_MEDIAN_COARSE;
+	for (b=0; b<VL_MEDIAN_COARSE; b++) kCoarse[b] += h[b];
+      }
+      for (k=0; k<VL_MEDIAN_COARSE; k++) last[k] = 0;
+
+      /* the square of pixel x1+p is columns p to p+size-1 */
+      for (i=x1, p=0; i<x2; i++, p++) {
+	h = coarse + ((p+size-1)*n+c)*VL_MEDIAN_COARSE;
+	if (p == 0) {
+	  for (b=0; b<VL_MEDIAN_COARSE; b++) kCoarse[b] += h[b];
+	}
+	else {
+	  f = h - size*n*VL_MEDIAN_COARSE;
+	  for (b=0; b<VL_MEDIAN_COARSE; b++) kCoarse[b] += h[b] - f[b];
+	}
 
-      /* set output */
-      output[index] = r_sum/size;
-      output[index+1] = g_sum/size;
-      output[index+2] = b_sum/size;
+	/* coarse bin k holds the median */
+	for (k=0, sum=0; sum+kCoarse[k] <= rank; k++) {
+	  sum += kCoarse[k];
+	}
+
+	/* its fine bins hold columns last[k]-size to last[k]-1, slide
+	   them to the square, or count them again if they are too old */
+	h = kFine + k*VL_MEDIAN_COARSE;
+	f = fine + c*VL_MEDIAN_BINS + k*VL_MEDIAN_COARSE;
+	if (last[k] <= p) {
+	  memset (h, 0, VL_MEDIAN_COARSE*sizeof(unsigned short));
+	  for (q=p; q<p+size; q++) {
+	    for (b=0; b<VL_MEDIAN_COARSE; b++) h[b] += f[q*n*VL_MEDIAN_BINS+b];
+	  }
+	}
+	else {
+	  for (q=last[k]; q<p+size; q++) {
+	    for (b=0; b<VL_MEDIAN_COARSE; b++) {
+	      h[b] += f[q*n*VL_MEDIAN_BINS+b] - f[(q-size)*n*VL_MEDIAN_BINS+b];
+	    }
+	  }
+	}
+	last[k] = p+size;
+
+	for (b=0; sum+h[b] <= rank; b++) {
+	  sum += h[b];
+	}
+	output[n*i+c] = k*VL_MEDIAN_COARSE + b;
+      }
     }
   }
 
+  VL_FREE (fine);
   return (0);			/* success */
 }
 
 
-/* -----------------------------------------------------------
-   NON LINEAR SMOOTHER - median smoother
-   ----------------------------------------------------------- */
+/* the k-th smallest of the n values of a (which are reordered) */
+static vlPixel
+_vlMedianSelect (vlPixel *a, int n, int k)
+{
+  int i, j, left, right;
+  vlPixel pivot, t;
+
+  left = 0;
+  right = n-1;
+  while (left < right) {
+    pivot = a[(left+right)/2];
+    i = left;
+    j = right;
+    while (i <= j) {
+      while (a[i] < pivot) i++;
+      while (a[j] > pivot) j--;
+      if (i <= j) {
+	t = a[i]; a[i] = a[j]; a[j] = t;
+	i++;
+	j--;
+      }
+    }
+    if (k <= j) right = j;
+    else if (k >= i) left = i;
+    else break;
+  }
+
+  return (a[k]);
+}
+
 
-/* this filter is quite efficient to deal with random noise,
-   and has the advantage to preserve edges,
-   even though it's computationnaly expensive ;
-   performance degrade with high noise density */
+/* output rows y1 to y2 by selecting the median of every square */
+static int
+_vlMedianBySelection (vlImage *src, int size, int x1, int x2, int y1,
+		      int y2, vlImage *dest)
+{
+  int i, j, c, n, ii, jj, s1, s2, rowSize, count;
+  vlPixel *values;
+  const vlPixel *input;
+
+  n = vlPixelSize (src->format);
+  rowSize = n * src->width;
+  s2 = size/2;
+  s1 = -(size-s2);
+
+  if (!(values = (vlPixel *) malloc (size*size * sizeof(vlPixel)))) {
+    VL_ERROR ("_vlMedianBySelection: malloc failed\n");
+    return (-1);		/* failure */
+  }
+
+  for (j=y1; j<y2; j++) {
+    for (i=x1; i<x2; i++) {
+      for (c=0; c<n; c++) {
+	count = 0;
+	for (jj=s1; jj<s2; jj++) {
+	  input = src->pixel + (j+jj)*rowSize + c;
+	  for (ii=s1; ii<s2; ii++) {
+	    values[count++] = input[n*(i+ii)];
+	  }
+	}
+	dest->pixel[j*rowSize + n*i + c] =
+	  _vlMedianSelect (values, count, count/2);
+      }
+    }
+  }
+
+  VL_FREE (values);
+  return (0);			/* success */
+}
+
+
+/******************************************************************************
+ *
+ * vlSmoothMedian --
+ *	replace every pixel of window by the median of the size x size
+ *      square [s1,s2) around it, channel by channel, for RGB and GRAY
+ *      images. This filter is quite efficient to deal with random noise,
+ *      and has the advantage to preserve edges. Pixels whose square is
+ *      not within the image are those of src.
+ *
+ * RETURNS:
+ *   On success, 0 is returned. Otherwise, -1.
+ *
+ *****************************************************************************/
 int
 vlSmoothMedian(vlImage *src,int size,vlWindow *window,vlImage *dest)
 {
-  int i,j;
-  int index;
+  int i,n,max;
   int width,height;
   int s1,s2;
   int x1,x2,y1,y2;
-  int sort_size = size*size;
-  int array_index;
-  vlPixel *input;
-  vlPixel *output;
-  vlPixel *r_array;
-  vlPixel *g_array;
-  vlPixel *b_array;
 
   /* verify parameters */
-  if ((!src) || (size <= 0) || (!window) || (!dest)) {
+  if ((!src) || (size <= 0) || (!window) || (!dest) || (src == dest)) {
     VL_ERROR ("vlSmoothMedian: error: illegal parameter\n");
     return (-1);		/* failure */
   }
 
-  /* RGB only... */
-  if(src->format != RGB){
-    VL_ERROR ("vlSmoothMedian: error: src image is not RGB\n");
+  if((src->format != RGB) && (src->format != GRAY)){
+    VL_ERROR ("vlSmoothMedian: error: src image is not RGB or GRAY\n");
     return (-1);		/* failure */
   }
 
-  r_array = (vlPixel *) malloc (sort_size * sizeof(vlPixel));
-  g_array = (vlPixel *) malloc (sort_size * sizeof(vlPixel));
-  b_array = (vlPixel *) malloc (sort_size * sizeof(vlPixel));
-
   /* extract useful data */
   width = src->width;
   height = src->height;
-  input = src->pixel;
+  n = vlPixelSize (src->format);
   s2 = size/2;
   s1 = -(size-s2);
   x1 = VL_MAX(window->x-s1,-s1);
@@ -280,62 +1018,30 @@ vlSmoothMedian(vlImage *src,int size,vlWindow *window,vlImage *dest)
   y2 = VL_MIN(window->y+window->height,height-s2);
 
   /* initialize new pic */
-  if (0 > vlImageInit (dest, RGB, width, height)) {
+  if (0 > vlImageInit (dest, src->format, width, height)) {
     VL_ERROR ("vlSmoothMedian: error: could not initialize dest image\n");
     return (-1);		/* failure */
   }
 
-  output = dest->pixel;
-  
   /* copy all the image so that not filtered area is uptodate */
-  memcpy(output,input,3*width*height*sizeof(vlPixel));
-
-  /* filter */
-  /* for each point within filtering window */
-  for(j=y1;j<y2;j++)
-    for(i=x1;i<x2;i++){
-      int ii,jj;
-      
-      /* build component arrays */
-      /* else padd the slider area around current pixel in image */
-      array_index = 0;
-      for(ii=s1;ii<s2;ii++)
-	for(jj=s1;jj<s2;jj++){
-	  int x = i + ii, y = j + jj;
-	  
-	  /* if in image
-	     if ( (x>=x1) && (x<x2) && (y>=y1) && (y<y2) ){ */
-
-	  index = 3*(y*width+x);
-	  r_array[array_index] = input[index];
-	  g_array[array_index] = input[index+1];
-	  b_array[array_index] = input[index+2];
-	  array_index++;
-	}
-      
-      /* current pixel index */
-      index = 3*(j*width+i);
-      
-      /* red component 
-	 sort array, get median element and put it in output pixel */
-      qsort(r_array, sort_size, sizeof(vlPixel), vlQsortCompare); 
-      output[index] = r_array[sort_size/2];
-
-      /* green component 
-	 sort array, get median element and put it in output pixel */
-      qsort(g_array, sort_size, sizeof(vlPixel), vlQsortCompare); 
-      output[index+1] = g_array[sort_size/2];
-
-      /* blue component 
-	 sort array, get median element and put it in output pixel */
-      qsort(b_array, sort_size, sizeof(vlPixel), vlQsortCompare); 
-      output[index+2] = b_array[sort_size/2];
-    }
-
-  VL_FREE (r_array);
-  VL_FREE (g_array);
-  VL_FREE (b_array);
+  memcpy(dest->pixel,src->pixel,n*width*height*sizeof(vlPixel));
 
-  return (0);			/* success */
-}
+  if ((x1 >= x2) || (y1 >= y2)) {
+    return (0);			/* success, nothing to filter */
+  }
+
+  if ((size == 3) || (size == 5)) {
+    return (_vlMedianByNetwork (src, size, x1, x2, y1, y2, dest));
+  }
 
+  /* histograms need 8-bit values */
+  max = 0;
+  for (i=(y1+s1)*n*width; i<(y2+s2-1)*n*width; i++) {
+    max = (src->pixel[i] > max) ? src->pixel[i] : max;
+  }
+  if ((max < VL_MEDIAN_BINS) && (size*size <= 65535)) {
+    return (_vlMedianByHistogram (src, size, x1, x2, y1, y2, dest));
+  }
+
+  return (_vlMedianBySelection (src, size, x1, x2, y1, y2, dest));
+}
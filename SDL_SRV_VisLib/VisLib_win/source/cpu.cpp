@@ -0,0 +1,123 @@
+/*****************************************************************************
+ *
+ * FILE:     cpu.cpp
+ *
+ * ABSTRACT: run time detection of the SIMD instruction sets
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+
+#include "vislib.h"
+#include "vlCpu.h"
+
+#if defined(VL_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(VL_X86) && defined(__GNUC__)
+#include <cpuid.h>
+#endif
+
+/* -1 until detected */
+static volatile int _vlCpuDetected = -1;
+static volatile int _vlCpuDisabled = 0;
+
+
+#if defined(VL_X86) && (defined(_MSC_VER) || defined(__GNUC__))
+static void
+_vlCpuId (int leaf, unsigned int reg[4])
+{
+#ifdef _MSC_VER
+  int info[4];
+
+  __cpuidex (info, leaf, 0);
+  reg[0] = info[0];
+  reg[1] = info[1];
+  reg[2] = info[2];
+  reg[3] = info[3];
+#else
+  __cpuid_count (leaf, 0, reg[0], reg[1], reg[2], reg[3]);
+#endif
+}
+
+
+/* XCR0: register states the OS saves on context switches */
+static unsigned int
+_vlCpuXcr0 (void)
+{
+#ifdef _MSC_VER
+  return ((unsigned int) _xgetbv (0));
+#else
+  unsigned int eax, edx;
+
+  __asm__ __volatile__ ("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+  return (eax);
+#endif
+}
+
+
+static int
+_vlCpuDetect (void)
+{
+  unsigned int reg[4];
+  int maxLeaf, features = 0;
+
+  _vlCpuId (0, reg);
+  maxLeaf = (int) reg[0];
+  if (maxLeaf < 1) {
+    return (0);
+  }
+
+  _vlCpuId (1, reg);
+  if (reg[3] & (1 << 26)) {
+    features |= VL_CPU_SSE2;
+  }
+  if (reg[2] & (1 << 9)) {
+    features |= VL_CPU_SSSE3;
+  }
+
+  /* AVX2 also needs the OS to save the YMM registers (OSXSAVE, AVX) */
+  if ((maxLeaf >= 7) && (reg[2] & (1 << 27)) && (reg[2] & (1 << 28)) &&
+      ((_vlCpuXcr0 () & 6) == 6)) {
+    _vlCpuId (7, reg);
+    if (reg[1] & (1 << 5)) {
+      features |= VL_CPU_AVX2;
+    }
+  }
+
+  return (features);
+}
+#else
+static int
+_vlCpuDetect (void)
+{
+  return (0);
+}
+#endif
+
+
+/******************************************************************************
+ *
+ * vlCpuFeatures --
+ *	detect (once) the SIMD instruction sets of the processor
+ *
+ * RETURNS:
+ *   The VL_CPU_* bits that are available and not disabled.
+ *
+ *****************************************************************************/
+int
+vlCpuFeatures (void)
+{
+  /* detecting twice from two threads is harmless */
+  if (_vlCpuDetected < 0) {
+    _vlCpuDetected = _vlCpuDetect ();
+  }
+
+  return (_vlCpuDetected & ~_vlCpuDisabled);
+}
+
+
+void
+vlCpuDisable (int features)
+{
+  _vlCpuDisabled = features;
+}
@@ -148,6 +148,74 @@ vlNrgFilter (vlImage *src, vlObject *object, vlWindow *window, vlImage *dest)
   return (0);			/* success */
 }
 
+/* pixels converted at a time by vlNrgFilterRgb */
+#define VL_NRG_FILTER_BLOCK 64
+
+/* filter a RGB image with NRG attributes: same output as vlRgb2Nrg then
+   vlNrgFilter, without the NRG image. Each row of the window is converted
+   a block at a time (vlRgb2NrgRow) and classified at once */
+int
+vlNrgFilterRgb (vlImage *src, vlObject *object, vlWindow *window,
+		vlImage *dest)
+{
+  int i,j,k,n;
+  int x1,x2,y1,y2;
+  int nr_min,ng_min;
+  int nr_max,ng_max;
+  int width;
+  vlPixel nrg[VL_NRG_PIXEL*VL_NRG_FILTER_BLOCK];
+  vlPixel *input;
+  vlPixel *output;
+
+  /* verify parameters */
+  if ((!src) || (!object) || (!window) || (!dest)) {
+    VL_ERROR ("vlNrgFilterRgb: error: one of the parameters is NULL\n");
+    return (-1);		/* failure */
+  }
+  
+  /* make sure we are given a RGB picture */
+  if(src->format != RGB){
+    VL_ERROR ("vlNrgFilterRgb: error: src image is not RGB\n");
+    return (-1);		/* failure */
+  }
+
+  /* initialize output picture */
+  if (0 > vlImageInit (dest, BINARY, src->width, src->height)) {
+    VL_ERROR ("vlNrgFilterRgb: error: could not initialize dest image\n");
+    return (-1);		/* failure */
+  }
+  
+  /* temp variables to optimize memory access */
+  width = src->width;
+  x1 = window->x;
+  x2 = x1 + (window->width);
+  y1 = window->y;
+  y2 = y1 + (window->height);
+  nr_min = object->nr_min; nr_max = object->nr_max;
+  ng_min = object->ng_min; ng_max = object->ng_max;
+
+  /* filter ! */
+  for (j=y1; j<y2; j++) {
+    for (i=x1; i<x2; i+=n) {
+      n = VL_MIN (VL_NRG_FILTER_BLOCK, x2-i);
+      input = src->pixel + VL_RGB_PIXEL*(j*width+i);
+      output = dest->pixel + (j*width+i);
+      vlRgb2NrgRow (input, nrg, n);
+
+      /* no branch, the pixels are not predictable */
+      for (k=0; k<n; k++) {
+	output[k] = ((nrg[VL_NRG_PIXEL*k] >= nr_min) &
+		     (nrg[VL_NRG_PIXEL*k] <= nr_max) &
+		     (nrg[VL_NRG_PIXEL*k+1] >= ng_min) &
+		     (nrg[VL_NRG_PIXEL*k+1] <= ng_max)) ? 255 : 0;
+      }
+    }
+  }
+
+  return (0);			/* success */
+}
+
+
 /* filter an image with HSI attributes */
 int
 vlHsiFilter (vlImage *src, vlObject *object, vlWindow *window, vlImage *dest)
@@ -28,6 +28,12 @@
 #include <math.h>
 
 #include "vislib.h"
+#include "vlCpu.h"
+
+#ifdef VL_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
 
 /* uncomment the following for debug messages */
 /*#define DEBUG*/
@@ -434,25 +440,11 @@ vlNrg2Gray(vlImage *src, vlWindow *window, vlImage *dest)
  *****************************************************************************/
 int 
 vlRgb2Hsi(vlImage *src, vlWindow *window, vlImage *dest)
-#ifdef USE_INT_MATH
-/* the following uses integer math */
 {
-  int i, j;
-  int r, g, b;
-  int index, width;
+  int j;
+  int width;
   int x1, x2, y1, y2;
-  vlPixel *input;
-  vlPixel *output;
-  int min, max, delta, sum;
-  int vl43 = VL_PIXEL_MAXVAL * 4 / 3;
-  int vl3 = VL_PIXEL_MAXVAL / 3;
-  int vl53 = VL_PIXEL_MAXVAL * 5 / 3;
-  int vl23 = VL_PIXEL_MAXVAL * 2 / 3;
 
-#ifdef DEBUG
-  printf ("vlRgb2Hsi: integer version\n");
-#endif
-  
   /* verify parameters */
   if ((!src) || (!window) || (!dest)) {
     VL_ERROR ("vlRgb2Hsi: error: one of the parameters is NULL\n");
@@ -477,19 +469,45 @@ vlRgb2Hsi(vlImage *src, vlWindow *window, vlImage *dest)
   x2 = x1 + (window->width);
   y1 = window->y;
   y2 = y1 + (window->height);
-  output = dest->pixel;
-  input = src->pixel;
 
   /* proceed to conversion */
   for (j=y1; j<y2; j++) {
-    for (i=x1; i<x2; i++){
+    vlRgb2HsiRow (src->pixel + VL_RGB_PIXEL * (j*width + x1),
+		  dest->pixel + VL_HSI_PIXEL * (j*width + x1), x2-x1);
+  }
+
+  return (0);			/* success */
+}
+
+
+#ifdef USE_INT_MATH
+/* the following uses integer math. It is the reference (and fallback) of
+   the SIMD kernels below */
+static void
+_vlRgb2HsiRowC(const vlPixel *input, vlPixel *output, int n)
+{
+  int i;
+  int r, g, b;
+  int index;
+  int min, max, delta, sum;
+  int vl43 = VL_PIXEL_MAXVAL * 4 / 3;
+  int vl3 = VL_PIXEL_MAXVAL / 3;
+  int vl53 = VL_PIXEL_MAXVAL * 5 / 3;
+  int vl23 = VL_PIXEL_MAXVAL * 2 / 3;
+
+#ifdef DEBUG
+  printf ("vlRgb2Hsi: integer version\n");
+#endif
+
+  /* proceed to conversion */
+  for (i=0; i<n; i++){
 
       /* From Foley & vanDam, "Computer Graphics: Principles and Practice",
        *      Addison-Wesley, 2nd edition, 1990, p. 595 (Fig 13.36)
        */
 
       /* get a point */
-      index = VL_RGB_PIXEL * (j*width + i);
+      index = VL_RGB_PIXEL * i;
 
       r = input[index++];	/* 0-255 */
       g = input[index++];	/* 0-255 */
@@ -572,64 +590,308 @@ vlRgb2Hsi(vlImage *src, vlWindow *window, vlImage *dest)
 	  output[index] = 0;
 	}
       }	/* end chromatic */
+  }
+}
+
+/* f(n), f(n+1), ... f(n+255): the entries of the constant tables below,
+   computed by the compiler, so they are ready before any thread runs */
+#define VL_TABLE4(f, n) f(n) f((n)+1) f((n)+2) f((n)+3)
+#define VL_TABLE16(f, n) \
+  VL_TABLE4 (f, n) VL_TABLE4 (f, (n)+4) VL_TABLE4 (f, (n)+8) VL_TABLE4 (f, (n)+12)
+#define VL_TABLE64(f, n) \
+  VL_TABLE16 (f, n) VL_TABLE16 (f, (n)+16) VL_TABLE16 (f, (n)+32) VL_TABLE16 (f, (n)+48)
+#define VL_TABLE256(f, n) \
+  VL_TABLE64 (f, n) VL_TABLE64 (f, (n)+64) VL_TABLE64 (f, (n)+128) VL_TABLE64 (f, (n)+192)
+
+
+#ifdef VL_X86
+/*
+ * SIMD versions of _vlRgb2HsiRowC, bit exact for RGB values 0-255.
+ *
+ * Lightness is VL_PIXEL_MAXVAL*sum/510 = (257*sum)>>1. The saturation and
+ * hue divisions, of VL_PIXEL_MAXVAL*x by d, become x times a reciprocal
+ * table entry: every quotient is at most VL_PIXEL_MAXVAL, so the float
+ * product is within 1 of the integer quotient, and one exact correction
+ * step each way (q*d and VL_PIXEL_MAXVAL*x are below 2^24, hence exact in
+ * float) gives the truncated quotient. Hue quotients are truncated toward
+ * zero on |x| and signed back, as C division does.
+ */
+
+/* VL_PIXEL_MAXVAL/d for the saturation, VL_PIXEL_MAXVAL/(6*delta) for the
+   hue, d and delta in 1-255 (entry 256 is not used) */
+#define VL_HSI_RCP_S(d) ((float) VL_PIXEL_MAXVAL / (float) (d)),
+#define VL_HSI_RCP_H(d) ((float) VL_PIXEL_MAXVAL / (float) (6*(d))),
+
+static const float _vlHsiRcpS[257] = { 0.0f, VL_TABLE256 (VL_HSI_RCP_S, 1) };
+static const float _vlHsiRcpH[257] = { 0.0f, VL_TABLE256 (VL_HSI_RCP_H, 1) };
+
+
+/* truncated VL_PIXEL_MAXVAL*x/d for 4 lanes, x >= 0 */
+static inline __m128i
+_vlHsiDivSSE2 (__m128i x, __m128i d, __m128 rcp)
+{
+  __m128 one = _mm_set1_ps (1.0f);
+  __m128 fx = _mm_cvtepi32_ps (x);
+  __m128 n = _mm_mul_ps (fx, _mm_set1_ps ((float) VL_PIXEL_MAXVAL));
+  __m128 fd = _mm_cvtepi32_ps (d);
+  __m128 q = _mm_cvtepi32_ps (_mm_cvttps_epi32 (_mm_mul_ps (fx, rcp)));
+
+  q = _mm_sub_ps (q, _mm_and_ps (_mm_cmpgt_ps (_mm_mul_ps (q, fd), n), one));
+  q = _mm_add_ps (q, _mm_and_ps (_mm_cmple_ps (_mm_mul_ps (_mm_add_ps (q, one), fd), n), one));
+
+  return (_mm_cvttps_epi32 (q));
+}
+
+
+static inline __m128i
+_vlSelectSSE2 (__m128i mask, __m128i a, __m128i b)
+{
+  return (_mm_or_si128 (_mm_and_si128 (mask, a), _mm_andnot_si128 (mask, b)));
+}
+
+
+/* 4 pixels, planar in and out */
+static void
+_vlHsi4SSE2 (const int *r, const int *g, const int *b, int *h, int *s, int *l)
+{
+  int den[4], dl[4];
+  __m128i R = _mm_loadu_si128 ((const __m128i *) r);
+  __m128i G = _mm_loadu_si128 ((const __m128i *) g);
+  __m128i B = _mm_loadu_si128 ((const __m128i *) b);
+  __m128i zero = _mm_setzero_si128 ();
+  __m128i one = _mm_set1_epi32 (1);
+  __m128i max, min, sum, delta, flat, d, rmax, gmax, x, off, sign, q;
+
+  /* values are 0-255, so the 16-bit min/max work on the 32-bit lanes */
+  max = _mm_max_epi16 (_mm_max_epi16 (R, G), B);
+  min = _mm_min_epi16 (_mm_min_epi16 (R, G), B);
+  sum = _mm_add_epi32 (max, min);
+  delta = _mm_sub_epi32 (max, min);
+  flat = _mm_cmpeq_epi32 (delta, zero);
+
+  /* lightness */
+  _mm_storeu_si128 ((__m128i *) l,
+		    _mm_srli_epi32 (_mm_add_epi32 (_mm_slli_epi32 (sum, 8), sum), 1));
+
+  /* saturation, 0 for greys since delta is 0 */
+  d = _vlSelectSSE2 (_mm_cmplt_epi32 (sum, _mm_set1_epi32 (255)), sum,
+		     _mm_sub_epi32 (_mm_set1_epi32 (510), sum));
+  d = _vlSelectSSE2 (flat, one, d);
+  _mm_storeu_si128 ((__m128i *) den, d);
+  _mm_storeu_si128 ((__m128i *) s,
+		    _vlHsiDivSSE2 (delta, d,
+				   _mm_setr_ps (_vlHsiRcpS[den[0]], _vlHsiRcpS[den[1]],
+						_vlHsiRcpS[den[2]], _vlHsiRcpS[den[3]])));
+
+  /* hue */
+  rmax = _mm_cmpeq_epi32 (R, max);
+  gmax = _mm_andnot_si128 (rmax, _mm_cmpeq_epi32 (G, max));
+  x = _vlSelectSSE2 (rmax, _mm_sub_epi32 (G, B),
+		     _vlSelectSSE2 (gmax, _mm_sub_epi32 (B, R), _mm_sub_epi32 (R, G)));
+  off = _vlSelectSSE2 (rmax,
+		       _mm_and_si128 (_mm_cmplt_epi32 (G, B), _mm_set1_epi32 (VL_PIXEL_MAXVAL)),
+		       _vlSelectSSE2 (gmax,
+				      _vlSelectSSE2 (_mm_cmplt_epi32 (_mm_slli_epi32 (delta, 1), x),
+						     _mm_set1_epi32 (VL_PIXEL_MAXVAL * 4 / 3),
+						     _mm_set1_epi32 (VL_PIXEL_MAXVAL / 3)),
+				      _vlSelectSSE2 (_mm_cmplt_epi32 (_mm_slli_epi32 (delta, 2), x),
+						     _mm_set1_epi32 (VL_PIXEL_MAXVAL * 5 / 3),
+						     _mm_set1_epi32 (VL_PIXEL_MAXVAL * 2 / 3))));
+  d = _vlSelectSSE2 (flat, one, delta);
+  _mm_storeu_si128 ((__m128i *) dl, d);
+  sign = _mm_srai_epi32 (x, 31);
+  q = _vlHsiDivSSE2 (_mm_sub_epi32 (_mm_xor_si128 (x, sign), sign),
+		     _mm_add_epi32 (_mm_slli_epi32 (d, 2), _mm_slli_epi32 (d, 1)),
+		     _mm_setr_ps (_vlHsiRcpH[dl[0]], _vlHsiRcpH[dl[1]],
+				  _vlHsiRcpH[dl[2]], _vlHsiRcpH[dl[3]]));
+  q = _mm_sub_epi32 (_mm_xor_si128 (q, sign), sign);
+  q = _mm_and_si128 (_mm_add_epi32 (q, off), _mm_set1_epi32 (VL_PIXEL_MAXVAL));
+  _mm_storeu_si128 ((__m128i *) h, _mm_andnot_si128 (flat, q));
+}
+
+
+/* truncated VL_PIXEL_MAXVAL*x/d for 8 lanes, x >= 0 */
+VL_TARGET_AVX2 static inline __m256i
+_vlHsiDivAVX2 (__m256i x, __m256i d, __m256 rcp)
+{
+  __m256 one = _mm256_set1_ps (1.0f);
+  __m256 fx = _mm256_cvtepi32_ps (x);
+  __m256 n = _mm256_mul_ps (fx, _mm256_set1_ps ((float) VL_PIXEL_MAXVAL));
+  __m256 fd = _mm256_cvtepi32_ps (d);
+  __m256 q = _mm256_cvtepi32_ps (_mm256_cvttps_epi32 (_mm256_mul_ps (fx, rcp)));
+
+  q = _mm256_sub_ps (q, _mm256_and_ps (_mm256_cmp_ps (_mm256_mul_ps (q, fd), n, _CMP_GT_OQ), one));
+  q = _mm256_add_ps (q, _mm256_and_ps (_mm256_cmp_ps (_mm256_mul_ps (_mm256_add_ps (q, one), fd), n, _CMP_LE_OQ), one));
+
+  return (_mm256_cvttps_epi32 (q));
+}
+
+
+/* 8 pixels, planar in and out */
+VL_TARGET_AVX2 static void
+_vlHsi8AVX2 (const int *r, const int *g, const int *b, int *h, int *s, int *l)
+{
+  __m256i R = _mm256_loadu_si256 ((const __m256i *) r);
+  __m256i G = _mm256_loadu_si256 ((const __m256i *) g);
+  __m256i B = _mm256_loadu_si256 ((const __m256i *) b);
+  __m256i zero = _mm256_setzero_si256 ();
+  __m256i one = _mm256_set1_epi32 (1);
+  __m256i max, min, sum, delta, flat, d, rmax, gmax, x, off, sign, q;
+
+  max = _mm256_max_epi32 (_mm256_max_epi32 (R, G), B);
+  min = _mm256_min_epi32 (_mm256_min_epi32 (R, G), B);
+  sum = _mm256_add_epi32 (max, min);
+  delta = _mm256_sub_epi32 (max, min);
+  flat = _mm256_cmpeq_epi32 (delta, zero);
+
+  /* lightness */
+  _mm256_storeu_si256 ((__m256i *) l,
+		       _mm256_srli_epi32 (_mm256_add_epi32 (_mm256_slli_epi32 (sum, 8), sum), 1));
+
+  /* saturation */
+  d = _mm256_blendv_epi8 (_mm256_sub_epi32 (_mm256_set1_epi32 (510), sum), sum,
+			  _mm256_cmpgt_epi32 (_mm256_set1_epi32 (255), sum));
+  d = _mm256_blendv_epi8 (d, one, flat);
+  _mm256_storeu_si256 ((__m256i *) s,
+		       _vlHsiDivAVX2 (delta, d, _mm256_i32gather_ps (_vlHsiRcpS, d, 4)));
+
+  /* hue */
+  rmax = _mm256_cmpeq_epi32 (R, max);
+  gmax = _mm256_andnot_si256 (rmax, _mm256_cmpeq_epi32 (G, max));
+  x = _mm256_blendv_epi8 (_mm256_blendv_epi8 (_mm256_sub_epi32 (R, G),
+					      _mm256_sub_epi32 (B, R), gmax),
+			  _mm256_sub_epi32 (G, B), rmax);
+  off = _mm256_blendv_epi8 (_mm256_blendv_epi8 (
+			      _mm256_blendv_epi8 (_mm256_set1_epi32 (VL_PIXEL_MAXVAL * 2 / 3),
+						  _mm256_set1_epi32 (VL_PIXEL_MAXVAL * 5 / 3),
+						  _mm256_cmpgt_epi32 (x, _mm256_slli_epi32 (delta, 2))),
+			      _mm256_blendv_epi8 (_mm256_set1_epi32 (VL_PIXEL_MAXVAL / 3),
+						  _mm256_set1_epi32 (VL_PIXEL_MAXVAL * 4 / 3),
+						  _mm256_cmpgt_epi32 (x, _mm256_slli_epi32 (delta, 1))),
+			      gmax),
+			    _mm256_and_si256 (_mm256_cmpgt_epi32 (B, G),
+					      _mm256_set1_epi32 (VL_PIXEL_MAXVAL)),
+			    rmax);
+  d = _mm256_blendv_epi8 (delta, one, flat);
+  sign = _mm256_srai_epi32 (x, 31);
+  q = _vlHsiDivAVX2 (_mm256_abs_epi32 (x),
+		     _mm256_add_epi32 (_mm256_slli_epi32 (d, 2), _mm256_slli_epi32 (d, 1)),
+		     _mm256_i32gather_ps (_vlHsiRcpH, d, 4));
+  q = _mm256_sub_epi32 (_mm256_xor_si256 (q, sign), sign);
+  q = _mm256_and_si256 (_mm256_add_epi32 (q, off), _mm256_set1_epi32 (VL_PIXEL_MAXVAL));
+  _mm256_storeu_si256 ((__m256i *) h, _mm256_andnot_si256 (flat, q));
+}
+
+
+/* pixels per block of the SIMD row loop */
+#define VL_HSI_BLOCK 16
+
+/* n RGB pixels with a planar kernel, 16 at a time. Blocks holding values
+   above 255 (never the case for RGB) go to the C code */
+static void
+_vlRgb2HsiRowSimd (const vlPixel *input, vlPixel *output, int n, int avx2)
+{
+  int i, k, big;
+  int r[VL_HSI_BLOCK], g[VL_HSI_BLOCK], b[VL_HSI_BLOCK];
+  int h[VL_HSI_BLOCK], s[VL_HSI_BLOCK], l[VL_HSI_BLOCK];
+  const vlPixel *in;
+  vlPixel *out;
+
+  for (i=0; i+VL_HSI_BLOCK<=n; i+=VL_HSI_BLOCK) {
+    in = input + VL_RGB_PIXEL*i;
+    out = output + VL_HSI_PIXEL*i;
+
+    big = 0;
+    for (k=0; k<VL_HSI_BLOCK; k++, in+=VL_RGB_PIXEL) {
+      r[k] = in[0];
+      g[k] = in[1];
+      b[k] = in[2];
+      big |= r[k] | g[k] | b[k];
+    }
+    if (big > 255) {
+      _vlRgb2HsiRowC (input + VL_RGB_PIXEL*i, out, VL_HSI_BLOCK);
+      continue;
+    }
+
+    if (avx2) {
+      for (k=0; k<VL_HSI_BLOCK; k+=8) {
+	_vlHsi8AVX2 (r+k, g+k, b+k, h+k, s+k, l+k);
+      }
+    }
+    else {
+      for (k=0; k<VL_HSI_BLOCK; k+=4) {
+	_vlHsi4SSE2 (r+k, g+k, b+k, h+k, s+k, l+k);
+      }
+    }
+
+    for (k=0; k<VL_HSI_BLOCK; k++, out+=VL_HSI_PIXEL) {
+      out[0] = (vlPixel) h[k];
+      out[1] = (vlPixel) s[k];
+      out[2] = (vlPixel) l[k];
     }
   }
 
-  return (0);			/* success */
+  if (i < n) {
+    _vlRgb2HsiRowC (input + VL_RGB_PIXEL*i, output + VL_HSI_PIXEL*i, n-i);
+  }
+}
+#endif /* VL_X86 */
+
+
+/******************************************************************************
+ *
+ * vlRgb2HsiRow --
+ *	convert n consecutive RGB pixels to HSI, as vlRgb2Hsi does. Lets
+ *      row based code convert without a full size HSI image. Uses the
+ *      AVX2 or SSE2 kernel when the processor has it (see vlCpuFeatures),
+ *      with the same output as the C code.
+ *
+ *****************************************************************************/
+void
+vlRgb2HsiRow(const vlPixel *input, vlPixel *output, int n)
+{
+#ifdef VL_X86
+  int features = vlCpuFeatures ();
+
+  if (features & (VL_CPU_AVX2 | VL_CPU_SSE2)) {
+    _vlRgb2HsiRowSimd (input, output, n, features & VL_CPU_AVX2);
+    return;
+  }
+#endif
+
+  _vlRgb2HsiRowC (input, output, n);
 }
 #else
+/******************************************************************************
+ *
+ * vlRgb2HsiRow --
+ *	convert n consecutive RGB pixels to HSI, as vlRgb2Hsi does. Lets
+ *      row based code convert without a full size HSI image.
+ *
+ *****************************************************************************/
+void
+vlRgb2HsiRow(const vlPixel *input, vlPixel *output, int n)
 /* the following uses floating point math */
 {
-  int i, j;
+  int i;
   float r, g, b;
-  int index, width;
-  int x1, x2, y1, y2;
+  int index;
   float hue, saturation, lightness;
-  vlPixel *input;
-  vlPixel *output;
   float min, max, delta, sum;
 
 #ifdef DEBUG
   printf ("vlRgb2Hsi: floating point version\n");
 #endif
-  
-  /* verify parameters */
-  if ((!src) || (!window) || (!dest)) {
-    VL_ERROR ("vlRgb2Hsi: error: one of the parameters is NULL\n");
-    return (-1);		/* failure */
-  }
-
-  /* make sure we have a RGB picture */
-  if (src->format != RGB) {
-    VL_ERROR ("vlRgb2Hsi: src image is not RGB\n");
-    return (-1);		/* failure */
-  }
-  
-  /* initialize the new picture */
-  if (0 > vlImageInit (dest, HSI, src->width, src->height)) {
-    VL_ERROR ("vlRgb2Hsi: error: could not initialize dest image\n");
-    return (-1);		/* failure */
-  }
-  
-  /* temporary variable to optimize memory access */
-  width = src->width;
-  x1 = window->x;
-  x2 = x1 + (window->width);
-  y1 = window->y;
-  y2 = y1 + (window->height);
-  output = dest->pixel;
-  input = src->pixel;
 
   /* proceed to conversion */
-  for (j=y1; j<y2; j++) {
-    for (i=x1; i<x2; i++){
+  for (i=0; i<n; i++){
 
       /* From Foley & vanDam, "Computer Graphics: Principles and Practice",
        *      Addison-Wesley, 2nd edition, 1990, p. 595 (Fig 13.36)
        */
 
       /* get a point */
-      index = VL_RGB_PIXEL * (j*width + i);
+      index = VL_RGB_PIXEL * i;
       r = (float) input[index] / 255.0f; /* 0-1 */
       g = (float) input[index+1] / 255.0f; /* 0-1 */
       b = (float) input[index+2] / 255.0f; /* 0-1 */
@@ -710,10 +972,7 @@ vlRgb2Hsi(vlImage *src, vlWindow *window, vlImage *dest)
       }
 #endif
 
-    }
   }
-
-  return (0);			/* success */
 }
 #endif
 
@@ -921,16 +1180,82 @@ vlGray2Binary(vlImage *src, int threshold, vlWindow *window, vlImage *dest)
 }
 
 
+/* ---------------------------------------------------------
+   normalized red/green
+   --------------------------------------------------------- */
+
+/*
+ * For RGB values 0-255 the sum is at most 765, so 255*c/sum rounded (the
+ * (vlPixel) (255.0f*c/sum + 0.5f) of vlRgb2Nrg) is taken from a table of
+ * reciprocals instead of a division: with rcp = ceil(255*2^24/sum),
+ * (c*rcp + 2^23) >> 24 is the same value for every c <= sum, and c*rcp
+ * stays below 2^32. A sum of 0 gives 0, as the float code does.
+ */
+#define VL_NRG_SCALEBITS 24
+#define VL_NRG_MAXSUM (3*255)
+
+#define VL_NRG_RCP(sum) \
+  ((unsigned int) (((255u << VL_NRG_SCALEBITS) + (sum) - 1) / (sum))),
+
+/* sums 0-768, the last 3 entries are not used */
+static const unsigned int _vlNrgRcp[3*256+1] = {
+  0,
+  VL_TABLE256 (VL_NRG_RCP, 1)
+  VL_TABLE256 (VL_NRG_RCP, 257)
+  VL_TABLE256 (VL_NRG_RCP, 513)
+};
+
+
+static void
+_vlRgb2NrgRowC (const vlPixel *input, vlPixel *output, int n)
+{
+  int i;
+  unsigned int r, g, b, rcp;
+
+  for (i=0; i<n; i++, input+=VL_RGB_PIXEL, output+=VL_NRG_PIXEL) {
+    r = input[0];
+    g = input[1];
+    b = input[2];
+
+    if ((r | g | b) > 255) {
+      /* not an 8-bit value, beyond the table */
+      output[0] = (vlPixel) (255.0f * r / (r+g+b) + 0.5f);
+      output[1] = (vlPixel) (255.0f * g / (r+g+b) + 0.5f);
+      continue;
+    }
+
+    rcp = _vlNrgRcp[r+g+b];
+    output[0] = (vlPixel) ((r*rcp + (1u << (VL_NRG_SCALEBITS-1)))
+			   >> VL_NRG_SCALEBITS);
+    output[1] = (vlPixel) ((g*rcp + (1u << (VL_NRG_SCALEBITS-1)))
+			   >> VL_NRG_SCALEBITS);
+  }
+}
+
+
+/******************************************************************************
+ *
+ * vlRgb2NrgRow --
+ *	convert n consecutive RGB pixels to normalized red/green, as
+ *      vlRgb2Nrg does, with no division: a table lookup and two multiplies
+ *      per pixel. Lets row based code, such as vlNrgFilterRgb, convert
+ *      without a full size NRG image.
+ *
+ *****************************************************************************/
+void
+vlRgb2NrgRow(const vlPixel *input, vlPixel *output, int n)
+{
+  _vlRgb2NrgRowC (input, output, n);
+}
+
+
 /* given a RGB picture, return a normalized red/green one */
 int 
 vlRgb2Nrg(vlImage *src, vlWindow *window, vlImage *dest)
 {
-  int i, j;
-  int index, width;
+  int j;
+  int width;
   int x1, x2, y1, y2;
-  int sum;
-  vlPixel *input;
-  vlPixel *output;
 
   /* verify parameters */
   if ((!src) || (!window) || (!dest)) {
@@ -956,26 +1281,11 @@ vlRgb2Nrg(vlImage *src, vlWindow *window, vlImage *dest)
   x2 = x1 + (window->width);
   y1 = window->y;
   y2 = y1 + (window->height);
-  input = src->pixel;
-  output = dest->pixel;
 
-  /* proceed to conversion */
+  /* proceed to conversion: normalized R = 255 * R / (R+G+B), and G */
   for (j=y1; j<y2; j++) {
-    for (i=x1; i<x2; i++) {
-      index = j*width + i;
-      sum = 
-	input[VL_RGB_PIXEL*index] + /* R */
-	input[VL_RGB_PIXEL*index+1] + /* G */
-	input[VL_RGB_PIXEL*index+2]; /* B */
-
-      /* normalized R = 255 * R / (R+G+B) */
-      output[VL_NRG_PIXEL*index] = (vlPixel)
-	(255.0f * input[VL_RGB_PIXEL*index] / sum + 0.5f);
-
-      /* normalized G = 255 * G / (R+G+B) */
-      output[VL_NRG_PIXEL*index+1] = (vlPixel)
-	(255.0f * input[VL_RGB_PIXEL*index+1] / sum + 0.5f);
-    }
+    vlRgb2NrgRow (src->pixel + VL_RGB_PIXEL * (j*width + x1),
+		  dest->pixel + VL_NRG_PIXEL * (j*width + x1), x2-x1);
   }
 
   return (0);			/* success */
@@ -1131,7 +1441,7 @@ vlHsi2S(vlImage *src, vlWindow *window, vlImage *dest)
   for (j=y1; j<y2; j++) {
     for (i=x1; i<x2; i++) {
       index = VL_GRAY_PIXEL * (j*width + i);
-      output[index] = input[VL_HSI_PIXEL*index]; /*S */
+      output[index] = input[VL_HSI_PIXEL*index+1]; /*S */
     }
   }
   dest->format=S;
@@ -1183,7 +1493,7 @@ vlHsi2I(vlImage *src, vlWindow *window, vlImage *dest)
   for (j=y1; j<y2; j++) {
     for (i=x1; i<x2; i++) {
       index = VL_GRAY_PIXEL * (j*width + i);
-      output[index] = input[VL_HSI_PIXEL*index]; /*I */
+      output[index] = input[VL_HSI_PIXEL*index+2]; /*I */
     }
   }
   dest->format=I;
@@ -0,0 +1,1119 @@
+/*****************************************************************************
+ *
+ * FILE:     image8.cpp
+ *
+ * ABSTRACT: 8-bit images and views. Same operators as for vlImages, on
+ *           one byte per value instead of two, read and written through
+ *           the row stride, pixel step and channel order of the image.
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "vislib.h"
+#include "vlImage8.h"
+#include "vlMorphRow.h"
+
+
+vlImage8 *
+vlImage8Create (vlImageFormat format, int width, int height)
+{
+  vlImage8 *image;
+
+  if (NULL == (image = (vlImage8 *) malloc (sizeof(vlImage8)))) {
+    VL_ERROR ("vlImage8Create: malloc failed\n");
+    return (NULL);
+  }
+  image->format = NONE;
+  image->width = image->height = 0;
+  image->pixel = NULL;
+  image->stride = image->step = 0;
+  image->order = VL_ORDER_RGB;
+  image->owner = TRUE;
+
+  if (0 > vlImage8Init (image, format, width, height)) {
+    VL_FREE (image);
+  }
+
+  return (image);
+}
+
+
+void
+vlImage8Destroy (vlImage8 *image)
+{
+  if (image) {
+    if (image->owner) {
+      VL_FREE (image->pixel);
+    }
+    VL_FREE (image);
+  }
+}
+
+
+/* # of values per pixel of the 8-bit formats, -1 for the others */
+static int
+_vlImage8PixelSize (vlImageFormat format)
+{
+  switch (format) {
+  case NONE:
+    return (VL_NONE_PIXEL);
+  case RGB:
+  case NRG:
+  case GRAY:
+  case BINARY:
+  case YUV:
+    return (vlPixelSize (format));
+  default:
+    return (-1);
+  }
+}
+
+
+/******************************************************************************
+ *
+ * vlImage8Init --
+ *	(re)initialize an existing 8-bit image. A view that already has the
+ *      format and size is kept, so that the operators write into it in
+ *      place; otherwise the image gets a packed buffer of its own (RGB
+ *      order), only reallocated if the size changes. As with vlImageInit
+ *      the pixels are not cleared.
+ *
+ * RETURNS:
+ *   On success, 0 is returned. Otherwise, -1.
+ *
+ *****************************************************************************/
+int
+vlImage8Init (vlImage8 *image, vlImageFormat format, int width, int height)
+{
+  int pixelSize, size;
+
+  if ((!image) || (width < 0) || (height < 0) ||
+      (0 > (pixelSize = _vlImage8PixelSize (format)))) {
+    VL_ERROR ("vlImage8Init: error: illegal parameter\n");
+    return (-1);		/* failure */
+  }
+
+  if (!image->owner) {
+    if ((image->format == format) && (image->width == width) &&
+	(image->height == height)) {
+      return (0);
+    }
+    /* drop the view */
+    image->pixel = NULL;
+    image->owner = TRUE;
+  }
+
+  size = pixelSize*width*height;
+  if ((!image->pixel) || (image->stride*image->height != size)) {
+    VL_FREE (image->pixel);
+    if (NULL == (image->pixel = (vlPixel8 *) malloc (VL_MAX (size, 1)))) {
+      VL_ERROR ("vlImage8Init: malloc failed\n");
+      image->stride = image->height = 0;
+      return (-1);		/* failure */
+    }
+  }
+
+  image->format = format;
+  image->width = width;
+  image->height = height;
+  image->stride = pixelSize*width;
+  image->step = pixelSize;
+  image->order = VL_ORDER_RGB;
+
+  return (0);			/* success */
+}
+
+
+/* view over pixel, see vlImage8.h */
+int
+vlImage8Wrap (vlImage8 *image, vlImageFormat format, int width, int height,
+	      void *pixel, int stride, int step, vlChannelOrder order)
+{
+  int pixelSize;
+
+  if ((!image) || (!pixel) || (width < 0) || (height < 0) ||
+      (format == NONE) || (0 > (pixelSize = _vlImage8PixelSize (format))) ||
+      (step < pixelSize) || (stride < step*width)) {
+    VL_ERROR ("vlImage8Wrap: error: illegal parameter\n");
+    return (-1);		/* failure */
+  }
+
+  if (image->owner) {
+    VL_FREE (image->pixel);
+  }
+
+  image->format = format;
+  image->width = width;
+  image->height = height;
+  image->pixel = (vlPixel8 *) pixel;
+  image->stride = stride;
+  image->step = step;
+  image->order = order;
+  image->owner = FALSE;
+
+  return (0);			/* success */
+}
+
+
+/* copy n pixels of pixelSize values between two layouts. Only RGB
+   pixels have a channel order: red at offset sRed (dRed), blue at 2-sRed */
+static void
+_vlImage8CopyRow (const vlPixel8 *src, int sStep, int sRed,
+		  vlPixel8 *dest, int dStep, int dRed, int n, int pixelSize)
+{
+  int i, c;
+
+  if ((sStep == pixelSize) && (dStep == pixelSize) && (sRed == dRed)) {
+    memcpy (dest, src, n*pixelSize);
+  }
+  else if (pixelSize == VL_RGB_PIXEL) {
+    for (i=0; i<n; i++, src+=sStep, dest+=dStep) {
+      dest[dRed] = src[sRed];
+      dest[1] = src[1];
+      dest[2-dRed] = src[2-sRed];
+    }
+  }
+  else {
+    for (i=0; i<n; i++, src+=sStep, dest+=dStep) {
+      for (c=0; c<pixelSize; c++) {
+	dest[c] = src[c];
+      }
+    }
+  }
+}
+
+
+/* copy src into dest, in place if dest is a view of the same format and
+   size (e.g. to display a result) */
+int
+vlImage8Copy (vlImage8 *src, vlImage8 *dest)
+{
+  int j;
+
+  if ((!src) || (!dest)) {
+    VL_ERROR ("vlImage8Copy: error: NULL image\n");
+    return (-1);		/* failure */
+  }
+  if (src == dest) {
+    return (0);
+  }
+
+  if (0 > vlImage8Init (dest, src->format, src->width, src->height)) {
+    return (-1);		/* failure */
+  }
+  if (src->format == NONE) {
+    return (0);
+  }
+
+  for (j=0; j<src->height; j++) {
+    _vlImage8CopyRow (VL_IMAGE8_ROW (src, j), src->step, VL_IMAGE8_RED (src),
+		      VL_IMAGE8_ROW (dest, j), dest->step, VL_IMAGE8_RED (dest),
+		      src->width, vlPixelSize (src->format));
+  }
+
+  return (0);			/* success */
+}
+
+
+/* ---------------------------------------------------------
+   conversions from/to vlImages
+   --------------------------------------------------------- */
+
+/* given a RGB, NRG, GRAY or BINARY picture, return the 8-bit one */
+int
+vlImage2Image8 (vlImage *src, vlImage8 *dest)
+{
+  int i, j, c, n, red;
+  vlPixel *input;
+  vlPixel8 *output;
+
+  if ((!src) || (!dest)) {
+    VL_ERROR ("vlImage2Image8: error: NULL image\n");
+    return (-1);		/* failure */
+  }
+
+  if ((src->format != RGB) && (src->format != NRG) &&
+      (src->format != GRAY) && (src->format != BINARY)) {
+    VL_ERROR ("vlImage2Image8: error: format does not fit in 8 bits\n");
+    return (-1);		/* failure */
+  }
+
+  if (0 > vlImage8Init (dest, src->format, src->width, src->height)) {
+    VL_ERROR ("vlImage2Image8: error: could not initialize dest image\n");
+    return (-1);		/* failure */
+  }
+
+  n = vlPixelSize (src->format);
+  red = (src->format == RGB) ? VL_IMAGE8_RED (dest) : 0;
+  input = src->pixel;
+  for (j=0; j<src->height; j++) {
+    output = VL_IMAGE8_ROW (dest, j);
+    for (i=0; i<src->width; i++, input+=n, output+=dest->step) {
+      for (c=0; c<n; c++) {
+	/* red goes to offset red, blue to 2-red */
+	output[c ? ((c == 2) ? 2-red : c) : red] =
+	  (vlPixel8) ((input[c] > VL_PIXEL8_MAXVAL) ?
+		      VL_PIXEL8_MAXVAL : input[c]);
+      }
+    }
+  }
+
+  return (0);			/* success */
+}
+
+
+/* given an 8-bit picture, return the vlImage one */
+int
+vlImage82Image (vlImage8 *src, vlImage *dest)
+{
+  int i, j, c, n, red;
+  vlPixel8 *input;
+  vlPixel *output;
+
+  if ((!src) || (!dest)) {
+    VL_ERROR ("vlImage82Image: error: NULL image\n");
+    return (-1);		/* failure */
+  }
+
+  if (0 > vlImageInit (dest, src->format, src->width, src->height)) {
+    VL_ERROR ("vlImage82Image: error: could not initialize dest image\n");
+    return (-1);		/* failure */
+  }
+
+  if (src->format == NONE) {
+    return (0);
+  }
+  n = vlPixelSize (src->format);
+  red = (src->format == RGB) ? VL_IMAGE8_RED (src) : 0;
+  output = dest->pixel;
+  for (j=0; j<src->height; j++) {
+    input = VL_IMAGE8_ROW (src, j);
+    for (i=0; i<src->width; i++, input+=src->step, output+=n) {
+      for (c=0; c<n; c++) {
+	output[c] = input[c ? ((c == 2) ? 2-red : c) : red];
+      }
+    }
+  }
+
+  return (0);			/* success */
+}
+
+
+/* ---------------------------------------------------------
+   format conversions
+   --------------------------------------------------------- */
+
+/* check src and window and initialize dest, for the window based ops */
+static int
+_vlImage8Prepare (vlImage8 *src, vlImageFormat format, vlWindow *window,
+		  vlImage8 *dest, vlImageFormat destFormat, const char *name)
+{
+  if ((!src) || (!window) || (!dest)) {
+    VL_ERROR ("%s: error: one of the parameters is NULL\n", name);
+    return (-1);		/* failure */
+  }
+
+  if (src->format != format) {
+    VL_ERROR ("%s: src image has the wrong format\n", name);
+    return (-1);		/* failure */
+  }
+
+  if (0 > vlImage8Init (dest, destFormat, src->width, src->height)) {
+    VL_ERROR ("%s: error: could not initialize dest image\n", name);
+    return (-1);		/* failure */
+  }
+
+  return (0);			/* success */
+}
+
+
+/* given a RGB picture, return a gray level one */
+int
+vlRgb82Gray8 (vlImage8 *src, vlWindow *window, vlImage8 *dest)
+{
+  int i, j, x1, x2;
+  const vlPixel8 *input;
+  vlPixel8 *output;
+
+  if (0 > _vlImage8Prepare (src, RGB, window, dest, GRAY, "vlRgb82Gray8")) {
+    return (-1);		/* failure */
+  }
+
+  x1 = window->x;
+  x2 = x1 + window->width;
+  for (j=window->y; j<window->y+window->height; j++) {
+    input = VL_IMAGE8_ROW (src, j) + x1*src->step;
+    output = VL_IMAGE8_ROW (dest, j) + x1*dest->step;
+    for (i=x1; i<x2; i++, input+=src->step, output+=dest->step) {
+      /* average RGB into graylevel */
+      *output = (vlPixel8) ((input[0] + input[1] + input[2]) / 3);
+    }
+  }
+
+  return (0);			/* success */
+}
+
+
+/* given a RGB picture, return a normalized red/green one */
+int
+vlRgb82Nrg8 (vlImage8 *src, vlWindow *window, vlImage8 *dest)
+{
+  int i, j, x1, x2, sum, red, blue;
+  const vlPixel8 *input;
+  vlPixel8 *output;
+
+  if (0 > _vlImage8Prepare (src, RGB, window, dest, NRG, "vlRgb82Nrg8")) {
+    return (-1);		/* failure */
+  }
+
+  red = VL_IMAGE8_RED (src);
+  blue = VL_IMAGE8_BLUE (src);
+  x1 = window->x;
+  x2 = x1 + window->width;
+  for (j=window->y; j<window->y+window->height; j++) {
+    input = VL_IMAGE8_ROW (src, j) + x1*src->step;
+    output = VL_IMAGE8_ROW (dest, j) + x1*dest->step;
+    for (i=x1; i<x2; i++, input+=src->step, output+=dest->step) {
+      sum = input[red] + input[1] + input[blue];
+
+      /* same rounding as vlRgb2Nrg */
+      output[0] = (vlPixel8) (vlPixel) (255.0f * input[red] / sum + 0.5f);
+      output[1] = (vlPixel8) (vlPixel) (255.0f * input[1] / sum + 0.5f);
+    }
+  }
+
+  return (0);			/* success */
+}
+
+
+/* given a gray picture, return a binary one */
+int
+vlGray82Binary8 (vlImage8 *src, int threshold, vlWindow *window,
+		 vlImage8 *dest)
+{
+  int i, j, x1, x2;
+  const vlPixel8 *input;
+  vlPixel8 *output;
+
+  if (threshold < 0) {
+    VL_ERROR ("vlGray82Binary8: error: illegal parameter\n");
+    return (-1);		/* failure */
+  }
+
+  if (0 > _vlImage8Prepare (src, GRAY, window, dest, BINARY,
+			    "vlGray82Binary8")) {
+    return (-1);		/* failure */
+  }
+
+  x1 = window->x;
+  x2 = x1 + window->width;
+  for (j=window->y; j<window->y+window->height; j++) {
+    input = VL_IMAGE8_ROW (src, j) + x1*src->step;
+    output = VL_IMAGE8_ROW (dest, j) + x1*dest->step;
+    for (i=x1; i<x2; i++, input+=src->step, output+=dest->step) {
+      *output = (*input > threshold) ? 255 : 0;
+    }
+  }
+
+  return (0);			/* success */
+}
+
+
+/* given a binary picture, return the RGB one (e.g. straight into the
+   view of a display surface) */
+int
+vlBinary82Rgb8 (vlImage8 *src, vlWindow *window, vlImage8 *dest)
+{
+  int i, j, x1, x2;
+  const vlPixel8 *input;
+  vlPixel8 *output;
+
+  if (0 > _vlImage8Prepare (src, BINARY, window, dest, RGB,
+			    "vlBinary82Rgb8")) {
+    return (-1);		/* failure */
+  }
+
+  x1 = window->x;
+  x2 = x1 + window->width;
+  for (j=window->y; j<window->y+window->height; j++) {
+    input = VL_IMAGE8_ROW (src, j) + x1*src->step;
+    output = VL_IMAGE8_ROW (dest, j) + x1*dest->step;
+    for (i=x1; i<x2; i++, input+=src->step, output+=dest->step) {
+      output[0] = output[1] = output[2] = *input;
+    }
+  }
+
+  return (0);			/* success */
+}
+
+
+/* n RGB pixels of a row to vlPixels, in RGB order */
+static void
+_vlImage8WidenRgb (const vlPixel8 *src, int step, int red, vlPixel *dest,
+		   int n)
+{
+  int i;
+
+  for (i=0; i<n; i++, src+=step, dest+=VL_RGB_PIXEL) {
+    dest[0] = src[red];
+    dest[1] = src[1];
+    dest[2] = src[2-red];
+  }
+}
+
+
+/* given a RGB picture, return the HSI one. HSI needs 16 bits so dest is
+   a vlImage, as for vlRgb2Hsi */
+int
+vlRgb82Hsi (vlImage8 *src, vlWindow *window, vlImage *dest)
+{
+  int j, x1, x2, n, width;
+  vlPixel *row;
+
+  if ((!src) || (!window) || (!dest)) {
+    VL_ERROR ("vlRgb82Hsi: error: one of the parameters is NULL\n");
+    return (-1);		/* failure */
+  }
+
+  if (src->format != RGB) {
+    VL_ERROR ("vlRgb82Hsi: src image is not RGB\n");
+    return (-1);		/* failure */
+  }
+
+  if (0 > vlImageInit (dest, HSI, src->width, src->height)) {
+    VL_ERROR ("vlRgb82Hsi: error: could not initialize dest image\n");
+    return (-1);		/* failure */
+  }
+
+  width = src->width;
+  x1 = VL_MAX (window->x, 0);
+  x2 = VL_MIN (window->x + window->width, width);
+  if (x1 >= x2) {
+    return (0);			/* nothing to do */
+  }
+
+  n = x2-x1;
+  if (!(row = (vlPixel *) malloc (VL_RGB_SIZE (n, 1)))) {
+    VL_ERROR ("vlRgb82Hsi: malloc failed\n");
+    return (-1);		/* failure */
+  }
+
+  for (j=window->y; j<window->y+window->height; j++) {
+    _vlImage8WidenRgb (VL_IMAGE8_ROW (src, j) + x1*src->step, src->step,
+		       VL_IMAGE8_RED (src), row, n);
+    vlRgb2HsiRow (row, dest->pixel + VL_HSI_PIXEL*(j*width + x1), n);
+  }
+
+  VL_FREE (row);
+
+  return (0);			/* success */
+}
+
+
+/* ---------------------------------------------------------
+   thresholding and filters
+   --------------------------------------------------------- */
+
+/* HSI thresholding of a RGB picture, as vlBinary: 255 out of the box of
+   para, 0 inside */
+int
+vlBinary8 (vlImage8 *src, vlHSI_carl_tol_t *para, vlImage8 *dest)
+{
+  int i, j, width;
+  vlPixel *row, *hsi, *bin;
+  vlPixel8 *output;
+
+  if ((!src) || (!para) || (!dest)) {
+    VL_ERROR ("vlBinary8: error: one of the parameters is NULL\n");
+    return (-1);		/* failure */
+  }
+
+  if (src->format != RGB) {
+    VL_ERROR ("vlBinary8: src image is not RGB\n");
+    return (-1);		/* failure */
+  }
+
+  if (0 > vlImage8Init (dest, BINARY, src->width, src->height)) {
+    VL_ERROR ("vlBinary8: error: could not initialize dest image\n");
+    return (-1);		/* failure */
+  }
+
+  /* a RGB, a HSI and a BINARY row */
+  width = src->width;
+  if (!(row = (vlPixel *) malloc (VL_RGB_SIZE (width, 1) +
+				  VL_HSI_SIZE (width, 1) +
+				  VL_BINARY_SIZE (width, 1)))) {
+    VL_ERROR ("vlBinary8: malloc failed\n");
+    return (-1);		/* failure */
+  }
+  hsi = row + VL_RGB_PIXEL*width;
+  bin = hsi + VL_HSI_PIXEL*width;
+
+  for (j=0; j<src->height; j++) {
+    _vlImage8WidenRgb (VL_IMAGE8_ROW (src, j), src->step, VL_IMAGE8_RED (src),
+		       row, width);
+    vlBinaryRow (row, para, width, hsi, bin);
+    output = VL_IMAGE8_ROW (dest, j);
+    for (i=0; i<width; i++, output+=dest->step) {
+      *output = (vlPixel8) bin[i];
+    }
+  }
+
+  VL_FREE (row);
+
+  return (0);			/* success */
+}
+
+
+/* vlBinaryTable on 8-bit RGB: one lookup per pixel, no conversion */
+int
+vlBinaryTable8 (vlImage8 *src, vlColorTable *table, vlImage8 *dest)
+{
+  int i, j, index, red, blue;
+  int bits, shift;
+  const unsigned char *member;
+  const vlPixel8 *input;
+  vlPixel8 *output;
+
+  if ((!src) || (!table) || (!dest)) {
+    VL_ERROR ("vlBinaryTable8: error: one of the parameters is NULL\n");
+    return (-1);		/* failure */
+  }
+
+  if (!table->built) {
+    VL_ERROR ("vlBinaryTable8: error: table not set\n");
+    return (-1);		/* failure */
+  }
+
+  if (src->format != RGB) {
+    VL_ERROR ("vlBinaryTable8: src image is not RGB\n");
+    return (-1);		/* failure */
+  }
+
+  if (0 > vlImage8Init (dest, BINARY, src->width, src->height)) {
+    VL_ERROR ("vlBinaryTable8: error: could not initialize dest image\n");
+    return (-1);		/* failure */
+  }
+
+  bits = table->bits;
+  shift = 8 - bits;
+  member = table->member;
+  red = VL_IMAGE8_RED (src);
+  blue = VL_IMAGE8_BLUE (src);
+  for (j=0; j<src->height; j++) {
+    input = VL_IMAGE8_ROW (src, j);
+    output = VL_IMAGE8_ROW (dest, j);
+    for (i=0; i<src->width; i++, input+=src->step, output+=dest->step) {
+      index = ((input[red] >> shift) << (2*bits)) |
+	      ((input[1] >> shift) << bits) |
+	      (input[blue] >> shift);
+      *output = ((member[index >> 3] >> (index & 7)) & 1) ? 0 : 255;
+    }
+  }
+
+  return (0);			/* success */
+}
+
+
+/* filter an image with RGB attributes, as vlRgbFilter */
+int
+vlRgbFilter8 (vlImage8 *src, vlObject *object, vlWindow *window,
+	      vlImage8 *dest)
+{
+  int i, j, x1, x2, red, blue;
+  const vlPixel8 *input;
+  vlPixel8 *output;
+
+  if (!object) {
+    VL_ERROR ("vlRgbFilter8: error: one of the parameters is NULL\n");
+    return (-1);		/* failure */
+  }
+
+  if (0 > _vlImage8Prepare (src, RGB, window, dest, BINARY,
+			    "vlRgbFilter8")) {
+    return (-1);		/* failure */
+  }
+
+  red = VL_IMAGE8_RED (src);
+  blue = VL_IMAGE8_BLUE (src);
+  x1 = window->x;
+  x2 = x1 + window->width;
+  for (j=window->y; j<window->y+window->height; j++) {
+    input = VL_IMAGE8_ROW (src, j) + x1*src->step;
+    output = VL_IMAGE8_ROW (dest, j) + x1*dest->step;
+    for (i=x1; i<x2; i++, input+=src->step, output+=dest->step) {
+      if ((input[red] < object->r_min) || (input[red] > object->r_max) ||
+	  (input[1] < object->g_min) || (input[1] > object->g_max) ||
+	  (input[blue] < object->b_min) || (input[blue] > object->b_max)) {
+	*output = 0;
+      }
+      else {
+	*output = 255;
+      }
+    }
+  }
+
+  return (0);			/* success */
+}
+
+
+/* filter an image with NRG attributes, as vlNrgFilter */
+int
+vlNrgFilter8 (vlImage8 *src, vlObject *object, vlWindow *window,
+	      vlImage8 *dest)
+{
+  int i, j, x1, x2;
+  const vlPixel8 *input;
+  vlPixel8 *output;
+
+  if (!object) {
+    VL_ERROR ("vlNrgFilter8: error: one of the parameters is NULL\n");
+    return (-1);		/* failure */
+  }
+
+  if (0 > _vlImage8Prepare (src, NRG, window, dest, BINARY,
+			    "vlNrgFilter8")) {
+    return (-1);		/* failure */
+  }
+
+  x1 = window->x;
+  x2 = x1 + window->width;
+  for (j=window->y; j<window->y+window->height; j++) {
+    input = VL_IMAGE8_ROW (src, j) + x1*src->step;
+    output = VL_IMAGE8_ROW (dest, j) + x1*dest->step;
+    for (i=x1; i<x2; i++, input+=src->step, output+=dest->step) {
+      if ((input[0] < object->nr_min) || (input[0] > object->nr_max) ||
+	  (input[1] < object->ng_min) || (input[1] > object->ng_max)) {
+	*output = 0;
+      }
+      else {
+	*output = 255;
+      }
+    }
+  }
+
+  return (0);			/* success */
+}
+
+
+/* ---------------------------------------------------------
+   binary morphology
+   --------------------------------------------------------- */
+
+/* in place erosion/dilation over the square [s1,s2), the single scan of
+   vlBinaryErode/vlBinaryDilate (vlMorphRow.h) on bytes */
+static int
+_vlBinary8Morph (vlImage8 *image, int size, vlWindow *window, int dilate,
+		 vlMorphScratch *scratch)
+{
+  return (_vlBinaryMorphRows (image->pixel, image->stride, image->step,
+			      image->width, image->height, size, window,
+			      dilate, scratch));
+}
+
+
+/* check the parameters of a morphological operator and copy src to dest
+   (the whole image, so that the area out of the window is uptodate) */
+static int
+_vlBinary8MorphCheck (vlImage8 *src, int size, vlWindow *window,
+		      vlImage8 *dest, const char *name)
+{
+  if ((!src) || (size <= 0) || (!window) || (!dest)) {
+    VL_ERROR ("%s: error: illegal parameter\n", name);
+    return (-1);		/* failure */
+  }
+
+  if (src->format != BINARY) {
+    VL_ERROR ("%s: error: src image is not BINARY\n", name);
+    return (-1);		/* failure */
+  }
+
+  if (0 > vlImage8Copy (src, dest)) {
+    VL_ERROR ("%s: unable to copy original image\n", name);
+    return (-1);		/* failure */
+  }
+
+  return (0);			/* success */
+}
+
+
+/* erosion/dilation of src into dest */
+static int
+_vlBinary8MorphCopy (vlImage8 *src, int size, vlWindow *window,
+		     vlImage8 *dest, int dilate, const char *name)
+{
+  vlMorphScratch scratch;
+  int status;
+
+  if (0 > _vlBinary8MorphCheck (src, size, window, dest, name)) {
+    return (-1);		/* failure */
+  }
+
+  scratch.buffer = NULL;
+  scratch.size = 0;
+  status = _vlBinary8Morph (dest, size, window, dilate, &scratch);
+  VL_FREE (scratch.buffer);
+
+  return (status);
+}
+
+int
+vlBinary8Erode (vlImage8 *src, int size, vlWindow *window, vlImage8 *dest)
+{
+  return (_vlBinary8MorphCopy (src, size, window, dest, FALSE,
+			       "vlBinary8Erode"));
+}
+
+int
+vlBinary8Dilate (vlImage8 *src, int size, vlWindow *window, vlImage8 *dest)
+{
+  return (_vlBinary8MorphCopy (src, size, window, dest, TRUE,
+			       "vlBinary8Dilate"));
+}
+
+
+/* open/close in place: num erosions followed by num dilations (the
+   reverse for close). A temporary scratch is used if scratch is NULL */
+static int
+_vlBinary8OpenClose (vlImage8 *src, int size, int num, vlWindow *window,
+		     vlMorphScratch *scratch, int close, const char *name)
+{
+  vlMorphScratch temp;
+  int i, status;
+
+  if (0 > _vlBinary8MorphCheck (src, size, window, src, name)) {
+    return (-1);		/* failure */
+  }
+
+  if (!scratch) {
+    temp.buffer = NULL;
+    temp.size = 0;
+    scratch = &temp;
+  }
+
+  status = 0;
+  for(i=0;(i<2*num)&&(status==0);i++){
+    status = _vlBinary8Morph (src, size, window, (i<num) == close, scratch);
+  }
+
+  if (scratch == &temp) {
+    VL_FREE (temp.buffer);
+  }
+
+  return (status);
+}
+
+int
+vlBinary8Open (vlImage8 *src, int size, int num, vlWindow *window,
+	       vlMorphScratch *scratch)
+{
+  return (_vlBinary8OpenClose (src, size, num, window, scratch, FALSE,
+			       "vlBinary8Open"));
+}
+
+int
+vlBinary8Close (vlImage8 *src, int size, int num, vlWindow *window,
+		vlMorphScratch *scratch)
+{
+  return (_vlBinary8OpenClose (src, size, num, window, scratch, TRUE,
+			       "vlBinary8Close"));
+}
+
+
+/* ---------------------------------------------------------
+   labeling
+   --------------------------------------------------------- */
+
+/* runs of foreground (0) pixels of every row, see vlLabelerScanRow */
+static int
+_vlImage8ScanRows (vlLabeler *labeler, vlImage8 *pic)
+{
+  int x, x1, j;
+  int width = pic->width;
+  int step = pic->step;
+  const vlPixel8 *row;
+
+  for (j=0; j<pic->height; j++) {
+    row = VL_IMAGE8_ROW (pic, j);
+    x = 0;
+    while (x < width) {
+      /* skip background */
+      while ((x < width) && (row[x*step] != 0)) {
+	x++;
+      }
+      if (x == width) {
+	break;
+      }
+
+      /* collect foreground */
+      x1 = x;
+      while ((x < width) && (row[x*step] == 0)) {
+	x++;
+      }
+      if (0 > vlLabelerAddRun (labeler, j, x1, x)) {
+	return (-1);		/* failure */
+      }
+    }
+  }
+
+  return (0);			/* success */
+}
+
+
+static int
+_vlImage8CheckBinary (vlImage8 *pic, const char *name)
+{
+  if (!pic) {
+    VL_ERROR ("%s: error: NULL image\n", name);
+    return (-1);		/* failure */
+  }
+
+  if (pic->format != BINARY) {
+    VL_ERROR ("%s: error: image is not BINARY\n", name);
+    return (-1);		/* failure */
+  }
+
+  return (0);			/* success */
+}
+
+
+/* blobs of pic in labeler->blobs[1..n], as vlLabelBlobs without paint */
+int
+vlLabelBlobs8 (vlLabeler *labeler, vlImage8 *pic)
+{
+  if ((!labeler) || (0 > _vlImage8CheckBinary (pic, "vlLabelBlobs8"))) {
+    return (-1);		/* failure */
+  }
+
+  if ((0 > vlLabelerStart (labeler, pic->width, pic->height)) ||
+      (0 > _vlImage8ScanRows (labeler, pic))) {
+    return (-1);		/* failure */
+  }
+
+  return (vlLabelerFinish (labeler));
+}
+
+
+/* k largest blobs of pic, as vlFindLargestBlobs */
+int
+vlFindLargestBlobs8 (vlLabeler *labeler, vlImage8 *pic, int k, int minArea,
+		     blob *out)
+{
+  int n;
+  vlLabeler *temp = NULL;
+
+  if ((k <= 0) || (!out) ||
+      (0 > _vlImage8CheckBinary (pic, "vlFindLargestBlobs8"))) {
+    return (-1);		/* failure */
+  }
+
+  if (!labeler) {
+    if (NULL == (labeler = temp = vlLabelerCreate ())) {
+      return (-1);		/* failure */
+    }
+  }
+
+  n = vlLabelerStartLargest (labeler, pic->width, pic->height, k, minArea,
+			     out);
+  if (n >= 0) {
+    n = _vlImage8ScanRows (labeler, pic);
+  }
+  if (n >= 0) {
+    n = vlLabelerFinish (labeler);
+  }
+
+  labeler->stream = FALSE;
+  labeler->out = NULL;
+  if (temp) {
+    vlLabelerDestroy (temp);
+  }
+
+  return (n);
+}
+
+
+/* -----------------------------------------------------------
+   FILE MANAGEMENT - ppm file format
+   ----------------------------------------------------------- */
+
+/* save image as a PPM (raw=binary) file, as vlImageSave. Packed RGB rows
+   are already in the PPM layout and are written as they are */
+int
+vlImage8Save (vlImage8 *image, char *filename)
+{
+  int i, j, width, red;
+  vlPixel8 *row, *data, *input;
+  FILE *pFp;
+
+  if (!image) {
+    VL_ERROR ("vlImage8Save: error: NULL image\n");
+    return (-1);		/* failure */
+  }
+
+  if ((image->format != RGB) && (image->format != GRAY) &&
+      (image->format != BINARY)) {
+    VL_ERROR ("vlImage8Save: error: cannot save this format\n");
+    return (-1);		/* failure */
+  }
+
+  width = image->width;
+  if (!(row = (vlPixel8 *) malloc (VL_RGB_PIXEL*width + 1))) {
+    VL_ERROR ("vlImage8Save: malloc failed\n");
+    return (-1);		/* failure */
+  }
+
+  if (NULL == (pFp = fopen (filename, "wb"))) {
+    perror ("vlImage8Save: unable to create file");
+    VL_FREE (row);
+    return (-1);		/* failure */
+  }
+
+  /* PPM header */
+  fprintf (pFp, "P6\n%d %d\n255\n", width, image->height);
+
+  red = (image->format == RGB) ? VL_IMAGE8_RED (image) : 0;
+  for (j=0; j<image->height; j++) {
+    input = VL_IMAGE8_ROW (image, j);
+    if (image->format == RGB) {
+      if ((image->step == VL_RGB_PIXEL) && (red == 0)) {
+	data = input;
+      }
+      else {
+	_vlImage8CopyRow (input, image->step, red, row, VL_RGB_PIXEL, 0,
+			  width, VL_RGB_PIXEL);
+	data = row;
+      }
+    }
+    else {
+      for (i=0; i<width; i++, input+=image->step) {
+	row[VL_RGB_PIXEL*i] = row[VL_RGB_PIXEL*i+1] = row[VL_RGB_PIXEL*i+2] =
+	  *input;
+      }
+      data = row;
+    }
+    if ((size_t) (VL_RGB_PIXEL*width) !=
+	fwrite ((void *) data, sizeof(vlPixel8), VL_RGB_PIXEL*width, pFp)) {
+      perror ("vlImage8Save: write error");
+      fclose (pFp);
+      VL_FREE (row);
+      return (-1);		/* failure */
+    }
+  }
+
+  VL_FREE (row);
+
+  if (0 > fclose (pFp)) {
+    perror ("vlImage8Save: close error");
+    return (-1);		/* failure */
+  }
+
+  return (0);			/* success */
+}
+
+
+/* load a PPM (raw=binary) image file, as vlImageLoad: GRAY and BINARY
+   images keep their format (red channel), anything else becomes RGB. A
+   view of the right format and size is filled in place */
+int
+vlImage8Load (vlImage8 *image, char *filename)
+{
+  int c, i, j;
+  int width, height, maxval;
+  char header[3];
+  vlImageFormat format;
+  vlPixel8 *row, *output;
+  FILE *pFp;
+
+  if (!image) {
+    VL_ERROR ("vlImage8Load: error: NULL image\n");
+    return (-1);		/* failure */
+  }
+
+  if (NULL == (pFp = fopen (filename, "rb"))) {
+    perror ("vlImage8Load: unable to open file");
+    return (-1);		/* failure */
+  }
+
+  /* read PPM header */
+  if ((1 != fscanf (pFp, "%2s", &header[0])) ||
+      (strcmp (header, "P6"))) {
+    VL_ERROR ("vlImage8Load: error: cannot read as P6 format PPM\n");
+    fclose (pFp);
+    return (-1);		/* failure */
+  }
+
+  /* skip comment lines */
+  while (1) {
+    do {
+      c = fgetc (pFp);
+    } while (isspace(c));
+
+    if ((c == EOF) || isdigit (c)) {
+      ungetc (c, pFp);
+      break;
+    }
+    do {
+      c = fgetc (pFp);
+    } while ((c != '\n') && (c != EOF));
+  }
+
+  if ((3 != fscanf (pFp, "%d %d %d", &width, &height, &maxval)) ||
+      (!isspace (fgetc (pFp)))) {
+    VL_ERROR ("vlImage8Load: error: cannot read as P6 format PPM\n");
+    fclose (pFp);
+    return (-1);		/* failure */
+  }
+
+  if (maxval != 255) {
+    VL_ERROR ("vlImage8Load: error: file does not have maxval=255\n");
+    fclose (pFp);
+    return (-1);		/* failure */
+  }
+
+  format = ((image->format == GRAY) || (image->format == BINARY)) ?
+    image->format : RGB;
+  if (0 > vlImage8Init (image, format, width, height)) {
+    VL_ERROR ("vlImage8Load: error: could not initialize image\n");
+    fclose (pFp);
+    return (-1);		/* failure */
+  }
+
+  if (!(row = (vlPixel8 *) malloc (VL_RGB_PIXEL*width + 1))) {
+    VL_ERROR ("vlImage8Load: malloc failed\n");
+    fclose (pFp);
+    return (-1);		/* failure */
+  }
+
+  for (j=0; j<height; j++) {
+    output = VL_IMAGE8_ROW (image, j);
+    if ((size_t) (VL_RGB_PIXEL*width) !=
+	fread ((void *) row, sizeof(vlPixel8), VL_RGB_PIXEL*width, pFp)) {
+      perror ("vlImage8Load: read error");
+      fclose (pFp);
+      VL_FREE (row);
+      return (-1);		/* failure */
+    }
+    if (format == RGB) {
+      _vlImage8CopyRow (row, VL_RGB_PIXEL, 0, output, image->step,
+			VL_IMAGE8_RED (image), width, VL_RGB_PIXEL);
+    }
+    else {
+      for (i=0; i<width; i++, output+=image->step) {
+	*output = row[VL_RGB_PIXEL*i]; /* red */
+      }
+    }
+  }
+
+  VL_FREE (row);
+
+  if (0 > fclose (pFp)) {
+    perror ("vlImage8Load: close error");
+    return (-1);		/* failure */
+  }
+
+  return (0);			/* success */
+}
@@ -0,0 +1,436 @@
+/*****************************************************************************
+ *
+ * FILE:     integral.cpp
+ *
+ * ABSTRACT: integral images (summed-area tables), after IntegralImage of
+ *           embedcv, and the operators computing local sums from them
+ *           in constant time per pixel: box filter (mean) and
+ *           thresholding against the local mean.
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vislib.h"
+#include "vlIntegral.h"
+
+
+vlIntegral *
+vlIntegralCreate (void)
+{
+  vlIntegral *ii;
+
+  if (NULL == (ii = (vlIntegral *) calloc (1, sizeof(vlIntegral)))) {
+    VL_ERROR ("vlIntegralCreate: malloc failed\n");
+    return (NULL);
+  }
+
+  return (ii);
+}
+
+
+void
+vlIntegralDestroy (vlIntegral *ii)
+{
+  if (ii) {
+    VL_FREE (ii->sum);
+    VL_FREE (ii);
+  }
+}
+
+
+/* make room in ii for the table of a width x height picture of format,
+   channels values per pixel, and clear its row 0 */
+static int
+_vlIntegralReserve (vlIntegral *ii, vlImageFormat format, int width,
+		    int height, int channels)
+{
+  int rowSize, size;
+
+  rowSize = (width+1) * channels;
+  size = rowSize * (height+1);
+  if (size > ii->size) {
+    VL_FREE (ii->sum);
+    ii->size = 0;
+    if (!(ii->sum = (vlIntegralSum *) malloc (size * sizeof(vlIntegralSum)))) {
+      VL_ERROR ("vlIntegral: malloc failed\n");
+      return (-1);		/* failure */
+    }
+    ii->size = size;
+  }
+  ii->format = format;
+  ii->width = width;
+  ii->height = height;
+  ii->channels = channels;
+
+  /* row and column 0 are the empty sums */
+  memset (ii->sum, 0, rowSize * sizeof(vlIntegralSum));
+
+  return (0);			/* success */
+}
+
+
+/******************************************************************************
+ *
+ * vlIntegralCompute --
+ *	fill ii with the integral image of src, one table entry per channel
+ *      of every pixel. The table only grows, so a reused ii allocates
+ *      nothing for frames of the same size.
+ *
+ * RETURNS:
+ *   On success, 0 is returned. Otherwise, -1.
+ *
+ *****************************************************************************/
+int
+vlIntegralCompute (vlIntegral *ii, vlImage *src)
+{
+  int j, k, channels, rowSize;
+  const vlPixel *input;
+  vlIntegralSum *row, *prev;
+
+  if ((!ii) || (!src)) {
+    VL_ERROR ("vlIntegralCompute: error: one of the parameters is NULL\n");
+    return (-1);		/* failure */
+  }
+
+  if (0 > (channels = vlPixelSize (src->format))) {
+    VL_ERROR ("vlIntegralCompute: error: unsupported image format\n");
+    return (-1);		/* failure */
+  }
+
+  if (0 > _vlIntegralReserve (ii, src->format, src->width, src->height,
+			      channels)) {
+    return (-1);		/* failure */
+  }
+
+  rowSize = (src->width+1) * channels;
+  input = src->pixel;
+  for (j=0; j<src->height; j++) {
+    prev = ii->sum + j*rowSize;
+    row = prev + rowSize;
+    for (k=0; k<channels; k++) {
+      row[k] = 0;
+    }
+
+    /* the left entry, plus the column above it, plus the pixel */
+    for (k=0; k<rowSize-channels; k++) {
+      row[k+channels] = row[k] + (prev[k+channels] - prev[k]) + input[k];
+    }
+    input += rowSize-channels;
+  }
+
+  return (0);			/* success */
+}
+
+
+/* value of channel c of pixel (x, y), the sum over its own box */
+#define VL_INTEGRAL_PIXEL(ii, x, y, c) \
+  VL_INTEGRAL_BOX (ii, x, y, (x)+1, (y)+1, c)
+
+
+/* pixels i1 to i2 of row j of the picture into dest, each value being
+   the sum over its own box */
+static void
+_vlIntegralPixels (vlIntegral *ii, int j, int i1, int i2, vlImage *dest)
+{
+  int k, n;
+  const vlIntegralSum *top;
+  const vlIntegralSum *bottom;
+  vlPixel *output;
+
+  n = ii->channels;
+  top = ii->sum + j*(ii->width+1)*n;
+  bottom = top + (ii->width+1)*n;
+  output = dest->pixel + j*ii->width*n;
+  for (k=i1*n; k<i2*n; k++) {
+    output[k] = bottom[k+n] - bottom[k] - top[k+n] + top[k];
+  }
+}
+
+
+/******************************************************************************
+ *
+ * vlIntegralSmooth --
+ *	box filter: replace every pixel of window by the mean of the size x
+ *      size square [s1,s2) around it, as vlSmooth, from the integral image
+ *      of the picture. dest gets the format of the picture; pixels whose
+ *      square is not within the image keep their value. The means are
+ *      truncated, as integer divisions, whatever size.
+ *
+ * RETURNS:
+ *   On success, 0 is returned. Otherwise, -1.
+ *
+ *****************************************************************************/
+int
+vlIntegralSmooth (vlIntegral *ii, int size, vlWindow *window, vlImage *dest)
+{
+  int j, k, n;
+  int width, height, rowSize;
+  int s1, s2;
+  int x1, x2, y1, y2;
+  double scale;
+  const vlIntegralSum *top;
+  const vlIntegralSum *bottom;
+  vlPixel *output;
+
+  /* verify parameters */
+  if ((!ii) || (!ii->sum) || (size <= 0) || (!window) || (!dest)) {
+    VL_ERROR ("vlIntegralSmooth: error: illegal parameter\n");
+    return (-1);		/* failure */
+  }
+
+  width = ii->width;
+  height = ii->height;
+  n = ii->channels;
+  rowSize = (width+1) * n;
+  if (0 > vlImageInit (dest, ii->format, width, height)) {
+    VL_ERROR ("vlIntegralSmooth: error: could not initialize dest image\n");
+    return (-1);		/* failure */
+  }
+
+  s2 = size/2;
+  s1 = -(size-s2);
+  x1 = VL_MAX(window->x-s1,-s1);
+  x2 = VL_MIN(window->x+window->width,width-s2);
+  y1 = VL_MAX(window->y-s1,-s1);
+  y2 = VL_MIN(window->y+window->height,height-s2);
+  if ((x1 >= x2) || (y1 >= y2)) {
+    x1 = x2 = y1 = y2 = 0;
+  }
+
+  /* pixels out of the squares keep their value */
+  for (j=0; j<height; j++) {
+    if ((j < y1) || (j >= y2)) {
+      _vlIntegralPixels (ii, j, 0, width, dest);
+    }
+    else {
+      _vlIntegralPixels (ii, j, 0, x1, dest);
+      _vlIntegralPixels (ii, j, x2, width, dest);
+    }
+  }
+
+  /* floor(sum/size^2) as (sum+1/2)/size^2: the 1/2 is far larger than
+     the rounding of the product, which is then never an integer */
+  scale = 1.0 / ((double) size*size);
+  for (j=y1; j<y2; j++) {
+    top = ii->sum + (j+s1)*rowSize;
+    bottom = ii->sum + (j+s2)*rowSize;
+    output = dest->pixel + j*width*n;
+    for (k=x1*n; k<x2*n; k++) {
+      output[k] = (vlPixel) (((double) (bottom[k+s2*n] - bottom[k+s1*n] -
+					top[k+s2*n] + top[k+s1*n]) + 0.5) * scale);
+    }
+  }
+
+  return (0);			/* success */
+}
+
+
+/******************************************************************************
+ *
+ * vlIntegralBinaryAdaptive --
+ *	threshold a gray picture against the local mean instead of the one
+ *      threshold of vlGray2Binary, from its integral image (that of
+ *      vlIntegralCompute or of vlIntegralComputeMean): a pixel is set
+ *      (255) when it is above the mean of the size x size box centered on
+ *      it, plus offset (which may be negative). Boxes are clipped to the
+ *      image. The cost does not depend on size.
+ *
+ * RETURNS:
+ *   On success, 0 is returned. Otherwise, -1.
+ *
+ *****************************************************************************/
+int
+vlIntegralBinaryAdaptive (vlIntegral *ii, int size, int offset,
+			  vlWindow *window, vlImage *dest)
+{
+  int i, j, d, area;
+  int width, height, half;
+  int x1, x2, y1, y2;
+  int bx1, bx2, by1, by2;
+  vlIntegralSum sum;
+  vlPixel *output;
+
+  /* verify parameters */
+  if ((!ii) || (!ii->sum) || (size <= 0) || (!window) || (!dest)) {
+    VL_ERROR ("vlIntegralBinaryAdaptive: error: illegal parameter\n");
+    return (-1);		/* failure */
+  }
+
+  if (ii->format != GRAY) {
+    VL_ERROR ("vlIntegralBinaryAdaptive: picture is not GRAY\n");
+    return (-1);		/* failure */
+  }
+
+  if (0 > vlImageInit (dest, BINARY, ii->width, ii->height)) {
+    VL_ERROR ("vlIntegralBinaryAdaptive: error: could not initialize dest image\n");
+    return (-1);		/* failure */
+  }
+
+  /* temp variables to optimize memory access */
+  width = ii->width;
+  height = ii->height;
+  half = size/2;
+  x1 = window->x;
+  x2 = x1 + (window->width);
+  y1 = window->y;
+  y2 = y1 + (window->height);
+
+  for (j=y1; j<y2; j++) {
+    by1 = j-half;
+    by2 = by1+size;
+    if (by1 < 0) by1 = 0;
+    if (by2 > height) by2 = height;
+
+    output = dest->pixel + j*width;
+    for (i=x1; i<x2; i++) {
+      bx1 = i-half;
+      bx2 = bx1+size;
+      if (bx1 < 0) bx1 = 0;
+      if (bx2 > width) bx2 = width;
+
+      /* pixel > sum/area + offset, without the division */
+      area = (bx2-bx1) * (by2-by1);
+      sum = VL_INTEGRAL_BOX (ii, bx1, by1, bx2, by2, 0);
+      d = (int) VL_INTEGRAL_PIXEL (ii, i, j, 0) - offset;
+      output[i] = ((d > 0) && ((double) d * area > sum)) ? 255 : 0;
+    }
+  }
+
+  return (0);			/* success */
+}
+
+
+/******************************************************************************
+ *
+ * vlGray2BinaryAdaptive --
+ *	vlIntegralBinaryAdaptive of src: ii keeps the integral image between
+ *      calls, or is NULL for a temporary one.
+ *
+ * RETURNS:
+ *   On success, 0 is returned. Otherwise, -1.
+ *
+ *****************************************************************************/
+int
+vlGray2BinaryAdaptive (vlImage *src, int size, int offset, vlIntegral *ii,
+		       vlWindow *window, vlImage *dest)
+{
+  vlIntegral *temp = NULL;
+  int status;
+
+  /* verify parameters */
+  if ((!src) || (size <= 0) || (!window) || (!dest)) {
+    VL_ERROR ("vlGray2BinaryAdaptive: error: illegal parameter\n");
+    return (-1);		/* failure */
+  }
+
+  if (src->format != GRAY) {
+    VL_ERROR ("vlGray2BinaryAdaptive: src image is not GRAY\n");
+    return (-1);		/* failure */
+  }
+
+  if ((!ii) && (NULL == (ii = temp = vlIntegralCreate ()))) {
+    return (-1);		/* failure */
+  }
+
+  status = vlIntegralCompute (ii, src);
+  if (status == 0) {
+    status = vlIntegralBinaryAdaptive (ii, size, offset, window, dest);
+  }
+
+  vlIntegralDestroy (temp);
+  return (status);
+}
+
+
+/******************************************************************************
+ *
+ * vlIntegralComputeMean --
+ *	fill ii with the integral image of the GRAY picture of the means
+ *      (R+G+B)/3 of the pixels of the RGB picture src, truncated as
+ *      vlRgb2Binary thresholds them, without building that picture.
+ *
+ * RETURNS:
+ *   On success, 0 is returned. Otherwise, -1.
+ *
+ *****************************************************************************/
+int
+vlIntegralComputeMean (vlIntegral *ii, vlImage *src)
+{
+  int i, j, rowSize;
+  const vlPixel *input;
+  vlIntegralSum *row, *prev;
+
+  if ((!ii) || (!src)) {
+    VL_ERROR ("vlIntegralComputeMean: error: one of the parameters is NULL\n");
+    return (-1);		/* failure */
+  }
+
+  if (src->format != RGB) {
+    VL_ERROR ("vlIntegralComputeMean: src image is not RGB\n");
+    return (-1);		/* failure */
+  }
+
+  if (0 > _vlIntegralReserve (ii, GRAY, src->width, src->height, 1)) {
+    return (-1);		/* failure */
+  }
+
+  rowSize = src->width+1;
+  input = src->pixel;
+  for (j=0; j<src->height; j++) {
+    prev = ii->sum + j*rowSize;
+    row = prev + rowSize;
+    row[0] = 0;
+    for (i=0; i<src->width; i++, input+=VL_RGB_PIXEL) {
+      row[i+1] = row[i] + (prev[i+1] - prev[i]) +
+	(input[0]+input[1]+input[2])/VL_RGB_PIXEL;
+    }
+  }
+
+  return (0);			/* success */
+}
+
+
+/******************************************************************************
+ *
+ * vlRgb2BinaryAdaptive --
+ *	vlRgb2Binary against the local mean: vlIntegralBinaryAdaptive of
+ *      the means (R+G+B)/3 of the pixels of src. ii keeps the integral
+ *      image between calls, or is NULL for a temporary one.
+ *
+ * RETURNS:
+ *   On success, 0 is returned. Otherwise, -1.
+ *
+ *****************************************************************************/
+int
+vlRgb2BinaryAdaptive (vlImage *src, int size, int offset, vlIntegral *ii,
+		      vlWindow *window, vlImage *dest)
+{
+  vlIntegral *temp = NULL;
+  int status;
+
+  /* verify parameters */
+  if ((!src) || (size <= 0) || (!window) || (!dest)) {
+    VL_ERROR ("vlRgb2BinaryAdaptive: error: illegal parameter\n");
+    return (-1);		/* failure */
+  }
+
+  if (src->format != RGB) {
+    VL_ERROR ("vlRgb2BinaryAdaptive: src image is not RGB\n");
+    return (-1);		/* failure */
+  }
+
+  if ((!ii) && (NULL == (ii = temp = vlIntegralCreate ()))) {
+    return (-1);		/* failure */
+  }
+
+  status = vlIntegralComputeMean (ii, src);
+  if (status == 0) {
+    status = vlIntegralBinaryAdaptive (ii, size, offset, window, dest);
+  }
+
+  vlIntegralDestroy (temp);
+  return (status);
+}
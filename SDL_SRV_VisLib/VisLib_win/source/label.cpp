@@ -0,0 +1,831 @@
+/*****************************************************************************
+ *
+ * FILE:     label.cpp
+ *
+ * ABSTRACT: two-pass run-length connected component labeling with
+ *           union-find label equivalence
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vislib.h"
+#include "vlLabel.h"
+
+/* initial number of runs/labels/blobs, arrays double when full */
+#define VL_LABEL_INIT_SIZE	1024
+
+/* streaming mode: last[] value of a blob already handed out */
+#define VL_LABEL_CLOSED		(-2)
+
+
+/* make sure *array holds at least need elements of elemSize bytes */
+static int
+_vlLabelerReserve (void **array, int *max, int need, int elemSize)
+{
+  int size;
+  void *tmp;
+
+  if (need <= *max) {
+    return (0);
+  }
+
+  size = (*max > 0) ? *max : VL_LABEL_INIT_SIZE;
+  while (size < need) {
+    size *= 2;
+  }
+
+  if (NULL == (tmp = realloc (*array, size * elemSize))) {
+    VL_ERROR ("vlLabeler: realloc failed\n");
+    return (-1);		/* failure */
+  }
+  *array = tmp;
+  *max = size;
+
+  return (0);			/* success */
+}
+
+
+/* root of a provisional label, with path halving */
+static int
+_vlLabelerFind (int *parent, int label)
+{
+  while (parent[label] != label) {
+    parent[label] = parent[parent[label]];
+    label = parent[label];
+  }
+  return (label);
+}
+
+
+/* merge two label trees, the smaller (older) label becomes the root.
+   In streaming mode the statistics of the absorbed tree move to the root */
+static int
+_vlLabelerUnion (vlLabeler *labeler, int a, int b)
+{
+  int tmp;
+
+  a = _vlLabelerFind (labeler->parent, a);
+  b = _vlLabelerFind (labeler->parent, b);
+  if (a == b) {
+    return (a);
+  }
+
+  if (b < a) {
+    tmp = a; a = b; b = tmp;
+  }
+  labeler->parent[b] = a;
+
+  if (labeler->stream) {
+    vlBlobMerge (labeler->acc + a, labeler->acc + b);
+  }
+  return (a);
+}
+
+
+/* TRUE if blob a ranks before blob b (larger, or as large but first) */
+static int
+_vlBlobLarger (const blob *a, const blob *b)
+{
+  return ((a->area > b->area) ||
+	  ((a->area == b->area) && (a->topleft < b->topleft)));
+}
+
+
+/* a streamed blob is complete: keep it if it is among the k largest */
+static void
+_vlLabelerClose (vlLabeler *labeler, int root)
+{
+  blob *b = labeler->acc + root;
+  blob *out = labeler->out;
+  int i;
+
+  labeler->last[root] = VL_LABEL_CLOSED;
+  labeler->numBlobs++;
+
+  /* reject small and out-ranked blobs before computing anything else */
+  if (b->area < labeler->minArea) {
+    return;
+  }
+  if (labeler->numOut < labeler->k) {
+    i = labeler->numOut++;
+  }
+  else if (_vlBlobLarger (b, out + labeler->k - 1)) {
+    i = labeler->k - 1;
+  }
+  else {
+    return;
+  }
+
+  /* insertion into out[], sorted by decreasing area */
+  while ((i > 0) && _vlBlobLarger (b, out + i - 1)) {
+    out[i] = out[i-1];
+    i--;
+  }
+  out[i] = *b;
+  vlBlobMoments (out + i);
+}
+
+
+/* streaming mode, before starting row y: close the blobs that did not
+   reach row y-1, then drop every run except those of row y-1 */
+static void
+_vlLabelerCloseRows (vlLabeler *labeler, int y)
+{
+  int i, root, keep;
+  vlRun *run;
+
+  for (i=labeler->prevStart, run=labeler->runs+i; i<labeler->numRuns;
+       i++, run++) {
+    root = _vlLabelerFind (labeler->parent, run->label);
+    if ((labeler->last[root] != VL_LABEL_CLOSED) &&
+	(labeler->last[root] < y-1)) {
+      _vlLabelerClose (labeler, root);
+    }
+  }
+
+  keep = (labeler->row == y-1) ? labeler->numRuns - labeler->rowStart : 0;
+  memmove (labeler->runs, labeler->runs + labeler->numRuns - keep,
+	   keep * sizeof(vlRun));
+  labeler->numRuns = keep;
+  labeler->rowStart = 0;
+}
+
+
+/******************************************************************************
+ *
+ * vlLabelerCreate --
+ *	create an empty labeling context
+ *
+ * RETURNS:
+ *   On success, a newly allocated labeler is returned. Otherwise NULL.
+ *   When finished, destroy using vlLabelerDestroy().
+ *
+ *****************************************************************************/
+vlLabeler *
+vlLabelerCreate (void)
+{
+  vlLabeler *labeler;
+
+  if (NULL == (labeler = (vlLabeler *) malloc (sizeof(vlLabeler)))) {
+    VL_ERROR ("vlLabelerCreate: malloc failed\n");
+    return (NULL);
+  }
+  memset (labeler, 0, sizeof(vlLabeler));
+
+  return (labeler);
+}
+
+
+void
+vlLabelerDestroy (vlLabeler *labeler)
+{
+  if (labeler) {
+    VL_FREE (labeler->runs);
+    VL_FREE (labeler->parent);
+    VL_FREE (labeler->ids);
+    VL_FREE (labeler->blobs);
+    VL_FREE (labeler->acc);
+    VL_FREE (labeler->last);
+    VL_FREE (labeler);
+  }
+}
+
+
+/******************************************************************************
+ *
+ * vlLabelerStart --
+ *	reset the labeler for a new frame. Buffers from previous frames
+ *      are kept.
+ *
+ * INPUTS:
+ *   labeler	labeling context
+ *   width	frame width
+ *   height	frame height
+ *
+ * RETURNS:
+ *   On success, 0 is returned. Otherwise, -1.
+ *
+ *****************************************************************************/
+int
+vlLabelerStart (vlLabeler *labeler, int width, int height)
+{
+  if ((!labeler) || (width <= 0) || (height <= 0)) {
+    VL_ERROR ("vlLabelerStart: error: illegal parameter\n");
+    return (-1);		/* failure */
+  }
+
+  labeler->width = width;
+  labeler->height = height;
+  labeler->numRuns = 0;
+  labeler->numLabels = 0;
+  labeler->numBlobs = 0;
+  labeler->row = -1;
+  labeler->prevStart = labeler->prevEnd = 0;
+  labeler->rowStart = labeler->upper = 0;
+  labeler->stream = FALSE;
+
+  return (0);			/* success */
+}
+
+
+/******************************************************************************
+ *
+ * vlLabelerStartLargest --
+ *	reset the labeler for a new frame in streaming mode: only the runs
+ *      of the last two rows are kept and vlLabelerFinish returns the k
+ *      largest blobs of at least minArea pixels in out (see
+ *      vlFindLargestBlobs). No label image can be painted.
+ *
+ * RETURNS:
+ *   On success, 0 is returned. Otherwise, -1.
+ *
+ *****************************************************************************/
+int
+vlLabelerStartLargest (vlLabeler *labeler, int width, int height, int k,
+		       int minArea, blob *out)
+{
+  if ((k <= 0) || (!out)) {
+    VL_ERROR ("vlLabelerStartLargest: error: illegal parameter\n");
+    return (-1);		/* failure */
+  }
+
+  if (0 > vlLabelerStart (labeler, width, height)) {
+    return (-1);		/* failure */
+  }
+
+  labeler->stream = TRUE;
+  labeler->k = k;
+  labeler->minArea = minArea;
+  labeler->out = out;
+  labeler->numOut = 0;
+
+  return (0);			/* success */
+}
+
+
+/******************************************************************************
+ *
+ * vlLabelerAddRun --
+ *	append the run [x1,x2) of row y. Runs must be added in raster order
+ *      (rows increasing, runs of a row from left to right, not touching).
+ *      The run is immediately unified with the 8-connected runs of row y-1.
+ *
+ * RETURNS:
+ *   On success, 0 is returned. Otherwise, -1.
+ *
+ *****************************************************************************/
+int
+vlLabelerAddRun (vlLabeler *labeler, int y, int x1, int x2)
+{
+  vlRun *run, *up;
+  int label, end;
+
+  if (y != labeler->row) {
+    if (labeler->stream) {
+      _vlLabelerCloseRows (labeler, y);
+    }
+
+    /* new row: the last row becomes the upper one only if adjacent */
+    if (y == labeler->row + 1) {
+      labeler->prevStart = labeler->rowStart;
+      labeler->prevEnd = labeler->numRuns;
+    }
+    else {
+      labeler->prevStart = labeler->prevEnd = labeler->numRuns;
+    }
+    labeler->rowStart = labeler->numRuns;
+    labeler->upper = labeler->prevStart;
+    labeler->row = y;
+  }
+
+  if ((0 > _vlLabelerReserve ((void **) &labeler->runs, &labeler->maxRuns,
+			      labeler->numRuns + 1, sizeof(vlRun))) ||
+      (0 > _vlLabelerReserve ((void **) &labeler->parent, &labeler->maxLabels,
+			      labeler->numLabels + 1, sizeof(int)))) {
+    return (-1);		/* failure */
+  }
+  if (labeler->stream &&
+      ((0 > _vlLabelerReserve ((void **) &labeler->acc, &labeler->maxAcc,
+			       labeler->numLabels + 1, sizeof(blob))) ||
+       (0 > _vlLabelerReserve ((void **) &labeler->last, &labeler->maxLast,
+			       labeler->numLabels + 1, sizeof(int))))) {
+    return (-1);		/* failure */
+  }
+
+  run = labeler->runs + labeler->numRuns++;
+  run->y = y;
+  run->x1 = x1;
+  run->x2 = x2;
+
+  /* skip upper runs ending left of x1-1, they cannot touch this run
+     (nor any run further right on this row) */
+  end = labeler->prevEnd;
+  while ((labeler->upper < end) && (labeler->runs[labeler->upper].x2 < x1)) {
+    labeler->upper++;
+  }
+
+  /* unify with every upper run starting at or left of x2 (8-connectivity) */
+  label = -1;
+  for (up = labeler->runs + labeler->upper;
+       (up < labeler->runs + end) && (up->x1 <= x2); up++) {
+    if (label < 0) {
+      label = _vlLabelerFind (labeler->parent, up->label);
+    }
+    else {
+      label = _vlLabelerUnion (labeler, label, up->label);
+    }
+  }
+
+  /* no connection: new provisional label */
+  if (label < 0) {
+    label = labeler->numLabels++;
+    labeler->parent[label] = label;
+    if (labeler->stream) {
+      memset (labeler->acc + label, 0, sizeof(blob));
+    }
+  }
+  run->label = label;
+
+  if (labeler->stream) {
+    vlBlobAddRun (labeler->acc + label, y, x1, x2, labeler->width);
+    labeler->last[label] = y;
+  }
+
+  return (0);			/* success */
+}
+
+
+/* extract the runs of foreground (0) pixels in one image row */
+int
+vlLabelerScanRow (vlLabeler *labeler, int y, const vlPixel *row)
+{
+  int x, x1;
+  int width = labeler->width;
+
+  x = 0;
+  while (x < width) {
+    /* skip background */
+    while ((x < width) && (row[x] != 0)) {
+      x++;
+    }
+    if (x == width) {
+      break;
+    }
+
+    /* collect foreground */
+    x1 = x;
+    while ((x < width) && (row[x] == 0)) {
+      x++;
+    }
+    if (0 > vlLabelerAddRun (labeler, y, x1, x)) {
+      return (-1);		/* failure */
+    }
+  }
+
+  return (0);			/* success */
+}
+
+
+/******************************************************************************
+ *
+ * vlLabelerFinish --
+ *	resolve label equivalences and build the blob table. Blobs are
+ *      numbered 1..n in raster order of their topleft pixel, and each
+ *      run's label is replaced by the id of its blob. Area, bounding box,
+ *      moments, centroid and orientation of every blob are filled in.
+ *
+ * RETURNS:
+ *   The number of blobs, or -1 on failure.
+ *
+ *****************************************************************************/
+int
+vlLabelerFinish (vlLabeler *labeler)
+{
+  int i, root, id;
+  int width = labeler->width;
+  vlRun *run;
+  blob *b;
+
+  /* streaming: every remaining blob is complete */
+  if (labeler->stream) {
+    _vlLabelerCloseRows (labeler, labeler->height + 1);
+    return (labeler->numOut);
+  }
+
+  if (0 > _vlLabelerReserve ((void **) &labeler->ids, &labeler->maxIds,
+			     labeler->numLabels + 1, sizeof(int))) {
+    return (-1);		/* failure */
+  }
+  memset (labeler->ids, 0, labeler->numLabels * sizeof(int));
+
+  labeler->numBlobs = 0;
+  for (i=0, run=labeler->runs; i<labeler->numRuns; i++, run++) {
+    root = _vlLabelerFind (labeler->parent, run->label);
+    id = labeler->ids[root];
+
+    /* first run of a blob in raster order: allocate the blob */
+    if (!id) {
+      id = ++labeler->numBlobs;
+      labeler->ids[root] = id;
+      if (0 > _vlLabelerReserve ((void **) &labeler->blobs,
+				 &labeler->maxBlobs, id + 1, sizeof(blob))) {
+	return (-1);		/* failure */
+      }
+      memset (labeler->blobs + id, 0, sizeof(blob));
+    }
+
+    /* area, bounding box and moments grow run by run */
+    vlBlobAddRun (labeler->blobs + id, run->y, run->x1, run->x2, width);
+    run->label = id;
+  }
+
+  for (id=1, b=labeler->blobs+1; id<=labeler->numBlobs; id++, b++) {
+    vlBlobMoments (b);
+  }
+
+  return (labeler->numBlobs);
+}
+
+
+/* write the blob ids of all runs into pic (as vlFindAllBlobs did) */
+int
+vlLabelerPaint (vlLabeler *labeler, vlImage *pic)
+{
+  int i, x;
+  vlPixel *row;
+  vlRun *run;
+
+  if ((!pic) || (pic->width != labeler->width) ||
+      (pic->height != labeler->height)) {
+    VL_ERROR ("vlLabelerPaint: error: image does not match labeler\n");
+    return (-1);		/* failure */
+  }
+
+  if (labeler->numBlobs > VL_PIXEL_MAXVAL) {
+    VL_ERROR ("vlLabelerPaint: error: too many blobs for a vlPixel\n");
+    return (-1);		/* failure */
+  }
+
+  for (i=0, run=labeler->runs; i<labeler->numRuns; i++, run++) {
+    row = pic->pixel + run->y*pic->width;
+    for (x=run->x1; x<run->x2; x++) {
+      row[x] = (vlPixel) run->label;
+    }
+  }
+  pic->format = GRAY;
+
+  return (0);			/* success */
+}
+
+
+/******************************************************************************
+ *
+ * vlLabelBlobs --
+ *	label all 8-connected blobs of foreground (0) pixels in pic. The blob
+ *      table is left in labeler->blobs[1..n].
+ *
+ * INPUTS:
+ *   labeler	labeling context (see vlLabelerCreate)
+ *   pic	binary image
+ *   paint	if TRUE, write the blob ids into pic and set it to GRAY,
+ *		otherwise pic is not modified
+ *
+ * RETURNS:
+ *   The number of blobs, or -1 on failure.
+ *
+ *****************************************************************************/
+int
+vlLabelBlobs (vlLabeler *labeler, vlImage *pic, int paint)
+{
+  int j, n;
+
+  if ((!labeler) || (!pic)) {
+    VL_ERROR ("vlLabelBlobs: error: one of the parameters is NULL\n");
+    return (-1);		/* failure */
+  }
+
+  if (0 > vlLabelerStart (labeler, pic->width, pic->height)) {
+    return (-1);		/* failure */
+  }
+
+  for (j=0; j<pic->height; j++) {
+    if (0 > vlLabelerScanRow (labeler, j, pic->pixel + j*pic->width)) {
+      return (-1);		/* failure */
+    }
+  }
+
+  if (0 > (n = vlLabelerFinish (labeler))) {
+    return (-1);		/* failure */
+  }
+
+  if (paint && (0 > vlLabelerPaint (labeler, pic))) {
+    return (-1);		/* failure */
+  }
+
+  return (n);
+}
+
+
+/******************************************************************************
+ *
+ * vlFindLargestBlobs --
+ *	find the k largest 8-connected blobs of foreground (0) pixels
+ *      without writing a label image. The image is streamed row by row:
+ *      only the runs of the last two rows are kept, statistics are
+ *      accumulated per blob, and a blob is ranked (or rejected) as soon as
+ *      it is complete. pic is not modified.
+ *
+ * INPUTS:
+ *   labeler	labeling context, or NULL to use a temporary one
+ *   pic	binary image
+ *   k		number of blobs wanted
+ *   minArea	blobs smaller than this are ignored
+ *   out	array of k blobs, sorted by decreasing area on return (ties
+ *		in raster order, so out[0] is the vlGetMaxAreaBlob blob)
+ *
+ * RETURNS:
+ *   The number of blobs written into out (at most k), or -1 on failure.
+ *   The total number of blobs in the image is left in labeler->numBlobs.
+ *
+ *****************************************************************************/
+int
+vlFindLargestBlobs (vlLabeler *labeler, vlImage *pic, int k, int minArea,
+		    blob *out)
+{
+  int j, n;
+  vlLabeler *temp = NULL;
+
+  if ((!pic) || (k <= 0) || (!out)) {
+    VL_ERROR ("vlFindLargestBlobs: error: illegal parameter\n");
+    return (-1);		/* failure */
+  }
+
+  if (!labeler) {
+    if (NULL == (labeler = temp = vlLabelerCreate ())) {
+      return (-1);		/* failure */
+    }
+  }
+
+  n = vlLabelerStartLargest (labeler, pic->width, pic->height, k, minArea,
+			     out);
+
+  for (j=0; (n >= 0) && (j<pic->height); j++) {
+    n = vlLabelerScanRow (labeler, j, pic->pixel + j*pic->width);
+  }
+  if (n >= 0) {
+    n = vlLabelerFinish (labeler);
+  }
+
+  labeler->stream = FALSE;
+  labeler->out = NULL;
+  if (temp) {
+    vlLabelerDestroy (temp);
+  }
+
+  return (n);
+}
+
+
+
+/* -----------------------------------------------------------
+   PARALLEL LABELING
+   ----------------------------------------------------------- */
+
+/* label the rows of band index */
+static void
+_vlLabelBand (void *arg, int index)
+{
+  vlParallelLabeler *labeler = (vlParallelLabeler *) arg;
+  vlLabeler *band = labeler->bands[index];
+  vlImage *pic = labeler->pic;
+  int j, n;
+
+  n = vlLabelerStart (band, pic->width, pic->height);
+  for (j=labeler->first[index]; (n >= 0) && (j<labeler->first[index+1]); j++) {
+    n = vlLabelerScanRow (band, j, pic->pixel + j*pic->width);
+  }
+  if (n >= 0) {
+    n = vlLabelerFinish (band);
+  }
+  labeler->status[index] = n;
+}
+
+
+/* write the final blob ids of band index into the image */
+static void
+_vlPaintBand (void *arg, int index)
+{
+  vlParallelLabeler *labeler = (vlParallelLabeler *) arg;
+  vlLabeler *band = labeler->bands[index];
+  vlPixel *row, id;
+  vlRun *run;
+  int i, x;
+
+  for (i=0, run=band->runs; i<band->numRuns; i++, run++) {
+    id = (vlPixel) labeler->ids[labeler->base[index] + run->label];
+    row = labeler->pic->pixel + run->y*labeler->pic->width;
+    for (x=run->x1; x<run->x2; x++) {
+      row[x] = id;
+    }
+  }
+}
+
+
+/* unify the blobs of the last row of band k with the 8-connected blobs
+   of the first row of band k+1 (smaller index becomes the root) */
+static void
+_vlLabelMergeBorder (vlParallelLabeler *labeler, int k)
+{
+  vlLabeler *up = labeler->bands[k];
+  vlLabeler *down = labeler->bands[k+1];
+  int y = labeler->first[k+1];
+  int i, j, upper, a, b;
+
+  /* upper runs: the tail of band k on row y-1 */
+  upper = up->numRuns;
+  while ((upper > 0) && (up->runs[upper-1].y == y-1)) {
+    upper--;
+  }
+
+  /* lower runs: the head of band k+1 on row y */
+  for (j=0; (j<down->numRuns) && (down->runs[j].y == y); j++) {
+    while ((upper < up->numRuns) && (up->runs[upper].x2 < down->runs[j].x1)) {
+      upper++;
+    }
+    for (i=upper; (i<up->numRuns) && (up->runs[i].x1 <= down->runs[j].x2);
+	 i++) {
+      a = _vlLabelerFind (labeler->parent, labeler->base[k] + up->runs[i].label);
+      b = _vlLabelerFind (labeler->parent,
+			  labeler->base[k+1] + down->runs[j].label);
+      if (a < b) {
+	labeler->parent[b] = a;
+      }
+      else if (b < a) {
+	labeler->parent[a] = b;
+      }
+    }
+  }
+}
+
+
+/******************************************************************************
+ *
+ * vlParallelLabelerCreate --
+ *	create a parallel labeling context of bands bands (one per processor
+ *      if bands <= 0). Like a labeler, it keeps its buffers between frames.
+ *
+ *****************************************************************************/
+vlParallelLabeler *
+vlParallelLabelerCreate (int bands)
+{
+  vlParallelLabeler *labeler;
+  int k;
+
+  if (bands <= 0) {
+    bands = vlThreadCount ();
+  }
+  if (bands > VL_MAX_THREADS) {
+    bands = VL_MAX_THREADS;
+  }
+
+  if (NULL == (labeler = (vlParallelLabeler *)
+	       malloc (sizeof(vlParallelLabeler)))) {
+    VL_ERROR ("vlParallelLabelerCreate: malloc failed\n");
+    return (NULL);
+  }
+  memset (labeler, 0, sizeof(vlParallelLabeler));
+  labeler->numBands = bands;
+
+  for (k=0; k<bands; k++) {
+    if (NULL == (labeler->bands[k] = vlLabelerCreate ())) {
+      vlParallelLabelerDestroy (labeler);
+      return (NULL);
+    }
+  }
+
+  return (labeler);
+}
+
+
+void
+vlParallelLabelerDestroy (vlParallelLabeler *labeler)
+{
+  int k;
+
+  if (labeler) {
+    for (k=0; k<labeler->numBands; k++) {
+      vlLabelerDestroy (labeler->bands[k]);
+    }
+    VL_FREE (labeler->parent);
+    VL_FREE (labeler->ids);
+    VL_FREE (labeler->blobs);
+    VL_FREE (labeler);
+  }
+}
+
+
+/******************************************************************************
+ *
+ * vlLabelBlobsParallel --
+ *	same as vlLabelBlobs, with the bands labeled in parallel. The band
+ *      blobs are merged across band borders; as the blobs of each band are
+ *      in raster order of their topleft pixel and a merged blob starts in
+ *      its first band, numbering them band after band gives the serial
+ *      ids. The blob table is left in labeler->blobs[1..n].
+ *
+ * RETURNS:
+ *   The number of blobs, or -1 on failure.
+ *
+ *****************************************************************************/
+int
+vlLabelBlobsParallel (vlParallelLabeler *labeler, vlImage *pic, int paint)
+{
+  int i, k, n, root, id, bands;
+  vlLabeler *band;
+
+  if ((!labeler) || (!pic)) {
+    VL_ERROR ("vlLabelBlobsParallel: error: one of the parameters is NULL\n");
+    return (-1);		/* failure */
+  }
+
+  /* cut in bands of equal height, at least one row each */
+  bands = VL_MIN (labeler->numBands, pic->height);
+  if (bands < 1) {
+    bands = 1;
+  }
+  for (k=0; k<=bands; k++) {
+    labeler->first[k] = (int) ((long) pic->height * k / bands);
+  }
+
+  labeler->pic = pic;
+  if (0 > vlThreadRun (bands, _vlLabelBand, labeler)) {
+    return (-1);		/* failure */
+  }
+
+  n = 0;
+  for (k=0; k<bands; k++) {
+    if (labeler->status[k] < 0) {
+      return (-1);		/* failure */
+    }
+    labeler->base[k] = n;
+    n += labeler->status[k] + 1;
+  }
+  labeler->base[bands] = n;
+
+  if ((0 > _vlLabelerReserve ((void **) &labeler->parent,
+			      &labeler->maxParent, n, sizeof(int))) ||
+      (0 > _vlLabelerReserve ((void **) &labeler->ids, &labeler->maxIds,
+			      n, sizeof(int)))) {
+    return (-1);		/* failure */
+  }
+  for (i=0; i<n; i++) {
+    labeler->parent[i] = i;
+  }
+
+  for (k=0; k+1<bands; k++) {
+    _vlLabelMergeBorder (labeler, k);
+  }
+
+  /* number the merged blobs and add up their statistics */
+  memset (labeler->ids, 0, n * sizeof(int));
+  labeler->numBlobs = 0;
+  for (k=0; k<bands; k++) {
+    band = labeler->bands[k];
+    for (i=1; i<=band->numBlobs; i++) {
+      root = _vlLabelerFind (labeler->parent, labeler->base[k] + i);
+      id = labeler->ids[root];
+      if (!id) {
+	id = ++labeler->numBlobs;
+	labeler->ids[root] = id;
+	if (0 > _vlLabelerReserve ((void **) &labeler->blobs,
+				   &labeler->maxBlobs, id + 1, sizeof(blob))) {
+	  return (-1);		/* failure */
+	}
+	memset (labeler->blobs + id, 0, sizeof(blob));
+      }
+      vlBlobMerge (labeler->blobs + id, band->blobs + i);
+    }
+  }
+  for (id=1; id<=labeler->numBlobs; id++) {
+    vlBlobMoments (labeler->blobs + id);
+  }
+
+  if (paint) {
+    if (labeler->numBlobs > VL_PIXEL_MAXVAL) {
+      VL_ERROR ("vlLabelBlobsParallel: error: too many blobs for a vlPixel\n");
+      return (-1);		/* failure */
+    }
+    for (i=0; i<n; i++) {
+      labeler->ids[i] = labeler->ids[_vlLabelerFind (labeler->parent, i)];
+    }
+    if (0 > vlThreadRun (bands, _vlPaintBand, labeler)) {
+      return (-1);		/* failure */
+    }
+    pic->format = GRAY;
+  }
+
+  return (labeler->numBlobs);
+}
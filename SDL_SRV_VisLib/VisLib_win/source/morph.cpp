@@ -31,6 +31,7 @@
 #include <malloc.h>
 
 #include "vislib.h"
+#include "vlMorphRow.h"
 
 /* we want to take advantage of the fact that morphological filters
    using a flat, square support (i.e. Min and Max operators !!) are
@@ -48,37 +49,37 @@
    MORPHOLOGIC TOOLS - erosion, dilation
    ----------------------------------------------------------- */
 
-/* rgb erosion */
-int
-vlRgbErode(vlImage *src,int size,vlWindow *window,vlImage *dest)
+/* rgb erosion/dilation: running min/max over the size x size square
+   [s1,s2) around each pixel, first along the rows into a temp image,
+   then along its columns */
+static int
+_vlRgbMorph (vlImage *src, int size, vlWindow *window, vlImage *dest,
+	     int max, const char *name)
 {
-  int i,j;
-  int index;
+  int i,j,c;
   int width,height;
   int s1,s2;
   int x1,x2,y1,y2;
-  int r_min,g_min,b_min;
   vlPixel *input;
   vlPixel *output;
   vlPixel *temp;
-  int temp_index;
-  vlPixel new1;
+  vlPixel *g, *h;
 
   /* verify parameters */
   if ((!src) || (size <= 0) || (!window) || (!dest)) {
-    VL_ERROR ("vlRgbErode: error: illegal parameter\n");
+    VL_ERROR ("%s: error: illegal parameter\n", name);
     return (-1);		/* failure */
   }
   
   /* make sure we are given a RGB picture */
   if (src->format != RGB){
-    VL_ERROR ("vlRgbErode: error: src image is not RGB\n");
+    VL_ERROR ("%s: error: src image is not RGB\n", name);
     return (-1);		/* failure */
   }
 
   /* copy all the image so that not filtered area is uptodate */
   if (0 > vlImageCopy (src, dest)) {
-    VL_ERROR ("vlRgbErode: unable to copy original image\n");
+    VL_ERROR ("%s: unable to copy original image\n", name);
     return (-1);		/* failure */
   }
 
@@ -93,123 +94,40 @@ vlRgbErode(vlImage *src,int size,vlWindow *window,vlImage *dest)
   x2 = VL_MIN(window->x+window->width,width-s2);
   y1 = VL_MAX(window->y-s1,-s1);
   y2 = VL_MIN(window->y+window->height,height-s2);
+  if ((x1 >= x2) || (y1 >= y2)) {
+    return (0);			/* nothing to do */
+  }
 
-  /* create a temp array to store intermediary results */
-  temp = (unsigned short *)malloc(VL_RGB_SIZE(width, height));
+  /* create a temp array to store intermediary results, and the
+     scratch lines of the running min/max */
+  temp = (vlPixel *)malloc(VL_RGB_SIZE(width, height) +
+			   2*((VL_MAX(width,height))+size)*sizeof(vlPixel));
+  if (!temp) {
+    VL_ERROR ("%s: malloc failed\n", name);
+    return (-1);		/* failure */
+  }
+  g = temp + VL_RGB_PIXEL*width*height;
+  h = g + (VL_MAX(width,height)) + size;
   memcpy (temp, input, VL_RGB_SIZE(width, height));
 
-
-  /*
-   * horizontal filter 
-   */
-
-  /* for each point within filtering window */
+  /* horizontal filter: temp(j,i) = min/max of input(j,i+s1..i+s2-1) */
   for(j=y1;j<y2;j++){
-    r_min = g_min = b_min = 255;
-    for(i=x1;i<x2;i++){
-      int ii;
-
-      /* if we are at the beginning of a line */
-      if(r_min == 255){
-	
-	index = VL_RGB_PIXEL*(j*width+i);
-	for(ii=s1;ii<s2;ii++){
-	  temp_index = index+VL_RGB_PIXEL*ii;
-	  r_min = VL_MIN(input[temp_index],r_min);
-	  g_min = VL_MIN(input[temp_index+1],g_min);
-	  b_min = VL_MIN(input[temp_index+2],b_min);
-	}
-      } 
-      else {
-	index = VL_RGB_PIXEL*(j*width+i);
-	
-	/* get new red min */
-	new1 = input[index+3*(s2-1)];
-	if(new1 < r_min) r_min = new1;
-	else {   
-	  r_min = 255;
-	  for(ii=s1;ii<s2;ii++) r_min = VL_MIN(input[index+3*ii],r_min);
-	}
-	
-	/* get new green min */
-	new1 = input[index+3*(s2-1)+1];
-	if(new1 < g_min) g_min = new1;
-	else {
-	  g_min = 255;
-	  for(ii=s1;ii<s2;ii++) g_min = VL_MIN(input[index+3*ii+1],g_min);
-	}	
-
-	/* get new blue min */
-	new1 = input[index+3*(s2-1)+2];
-	if(new1 < b_min) b_min = new1;
-	else {
-	  b_min = 255;
-	  for(ii=s1;ii<s2;ii++) b_min = VL_MIN(input[index+3*ii+2],b_min);
-	}	
-      }
-      
-      /* set output */
-      temp[index] = r_min;
-      temp[index+1] = g_min;
-      temp[index+2] = b_min;
+    for(c=0;c<VL_RGB_PIXEL;c++){
+      _vlRunningExtremum (input+VL_RGB_PIXEL*(j*width+x1+s1)+c, VL_RGB_PIXEL,
+			  x2-x1+size-1, size, max,
+			  temp+VL_RGB_PIXEL*(j*width+x1)+c, VL_RGB_PIXEL, g, h);
     }
   }
-  
 
-  /* vertical filter */
-  
-  /* for each point within filtering window */
+  /* vertical filter: output(j,i) = min/max of temp(j+s1..j+s2-1,i) */
   for(i=x1;i<x2;i++){
-    r_min = g_min = b_min = 255;
-    for(j=y1;j<y2;j++){
-      int ii;
-      
-      /* if we are at the beginning of a column */ 
-      if(r_min == 255){ 
-	r_min = g_min = b_min = 255;
-	index = VL_RGB_PIXEL*(j*width+i);
-	for(ii=s1;ii<s2;ii++){
-	  temp_index = index+VL_RGB_PIXEL*width*ii;
-	  r_min = VL_MIN(temp[temp_index],r_min);
-	  g_min = VL_MIN(temp[temp_index+1],g_min);
-	  b_min = VL_MIN(temp[temp_index+2],b_min);
-	}
-	
-      } 
-      else {
-	index = VL_RGB_PIXEL*(j*width+i);
-	
-	/* get new red min */ 
-	new1 = temp[index+3*width*(s2-1)];
-	if(new1 < r_min) r_min = new1; 
-	else { 
-	  r_min = 255;
-	  for(ii=s1;ii<s2;ii++) r_min = VL_MIN(temp[index+3*width*ii],r_min);
-	}
-	
-	/* get new green min */
-	new1 = temp[index+3*width*(s2-1)+1];
-	if(new1 < g_min) g_min = new1;
-	else { 
-	  g_min = 255;
-	  for(ii=s1;ii<s2;ii++) g_min = VL_MIN(temp[index+3*width*ii+1],g_min);
-	}
-	
-	/* get new blue min */
-	new1 = temp[index+3*width*(s2-1)+2];
-	if(new1 < b_min) b_min = new1; 
-	else { 
-	  b_min = 255;
-	  for(ii=s1;ii<s2;ii++) b_min = VL_MIN(temp[index+3*width*ii+2],b_min);
-	}
-      } 
-      
-      /* set output */
-      output[index] = r_min;
-      output[index+1] = g_min;
-      output[index+2] = b_min;
+    for(c=0;c<VL_RGB_PIXEL;c++){
+      _vlRunningExtremum (temp+VL_RGB_PIXEL*((y1+s1)*width+i)+c,
+			  VL_RGB_PIXEL*width, y2-y1+size-1, size, max,
+			  output+VL_RGB_PIXEL*(y1*width+i)+c,
+			  VL_RGB_PIXEL*width, g, h);
     }
-  }  
+  }
   
   /* get rid of temporary image */
   VL_FREE(temp);
@@ -218,177 +136,23 @@ vlRgbErode(vlImage *src,int size,vlWindow *window,vlImage *dest)
 }
 
 
-/* rgb dilation */
+/* rgb erosion */
 int
-vlRgbDilate(vlImage *src,int size,vlWindow *window,vlImage *dest)
+vlRgbErode(vlImage *src,int size,vlWindow *window,vlImage *dest)
 {
-  int i,j;
-  int index;
-  int width,height;
-  int s1,s2;
-  int x1,x2,y1,y2;
-  int r_max,g_max,b_max;
-  vlPixel *input;
-  vlPixel *output;
-  vlPixel *temp;
-
-  /* verify parameters */
-  if ((!src) || (size <= 0) || (!window) || (!dest)) {
-    VL_ERROR ("vlRgbDilate: error: illegal parameter\n");
-    return (-1);		/* failure */
-  }
-
-  /* make sure we are given a RGB picture */
-  if (src->format != RGB){
-    VL_ERROR ("vlRgbDilate: error: src image is not RGB\n");
-    return (-1);		/* failure */
-  }
-
-  /* copy all the image so that not filtered area is uptodate */
-  if (0 > vlImageCopy (src, dest)) {
-    VL_ERROR ("vlRgbDilate: unable to copy original image\n");
-    return (-1);		/* failure */
-  }
-
-  /* extract useful data */
-  width = src->width;
-  height = src->height;
-  input = src->pixel;
-  output = dest->pixel;
-  s2 = size/2;
-  s1 = -(size-s2);
-  x1 = VL_MAX(window->x-s1,-s1);
-  x2 = VL_MIN(window->x+window->width,width-s2);
-  y1 = VL_MAX(window->y-s1,-s1);
-  y2 = VL_MIN(window->y+window->height,height-s2);
-
-  /* create a temp array to store intermediary results */
-  temp = (unsigned short *)malloc(VL_RGB_SIZE(width, height));
-  memcpy (temp, input, VL_RGB_SIZE(width, height));
-
-  /*
-   * horizontal filter 
-   */
-
-  /* for each point within filtering window */
-  for(j=y1;j<y2;j++){
-    r_max = g_max = b_max = -1;
-    for(i=x1;i<x2;i++){
-      int ii;
-
-      /* if we are at the beginning of a line */
-      if(r_max == -1){
-	int temp_index;
-	
-	index = VL_RGB_PIXEL*(j*width+i);
-	for(ii=s1;ii<s2;ii++){
-	  temp_index = index+VL_RGB_PIXEL*ii;
-	  r_max = VL_MAX(input[temp_index],r_max);
-	  g_max = VL_MAX(input[temp_index+1],g_max);
-	  b_max = VL_MAX(input[temp_index+2],b_max);
-	}
-      } 
-      else {
-	vlPixel new1;
-	index = VL_RGB_PIXEL*(j*width+i);
-	
-	/* get new red max */
-	new1 = input[index+3*(s2-1)];
-	if(new1 > r_max) r_max = new1;
-	else {   
-	  r_max = 0;
-	  for(ii=s1;ii<s2;ii++) r_max = VL_MAX(input[index+3*ii],r_max);
-	}
-	
-	/* get new green max */
-	new1 = input[index+3*(s2-1)+1];
-	if(new1 > g_max) g_max = new1;
-	else {
-	  g_max = 0;
-	  for(ii=s1;ii<s2;ii++) g_max = VL_MAX(input[index+3*ii+1],g_max);
-	}	
-
-	/* get new blue max */
-	new1 = input[index+3*(s2-1)+2];
-	if(new1 > b_max) b_max = new1;
-	else {
-	  b_max = 0;
-	  for(ii=s1;ii<s2;ii++) b_max = VL_MAX(input[index+3*ii+2],b_max);
-	}	
-      }
-      
-      /* set output */
-      temp[index] = r_max;
-      temp[index+1] = g_max;
-      temp[index+2] = b_max;
-    }
-  }
-  
-
-  /* vertical filter */
-  
-  /* for each point within filtering window */
-  for(i=x1;i<x2;i++){
-    r_max = g_max = b_max = 0;
-    for(j=y1;j<y2;j++){
-      int ii;
-      
-      /* if we are at the beginning of a column */ 
-      if(r_max == 255){ 
-	int temp_index;
-	r_max = g_max = b_max = 0;
-	index = VL_RGB_PIXEL*(j*width+i);
-	for(ii=s1;ii<s2;ii++){
-	  temp_index = index+VL_RGB_PIXEL*width*ii;
-	  r_max = VL_MAX(temp[temp_index],r_max);
-	  g_max = VL_MAX(temp[temp_index+1],g_max);
-	  b_max = VL_MAX(temp[temp_index+2],b_max);
-	}
-	
-      } 
-      else {
-	vlPixel new1;
-	index = VL_RGB_PIXEL*(j*width+i);
-	
-	/* get new red max */ 
-	new1 = temp[index+3*width*(s2-1)];
-	if(new1 > r_max) r_max = new1; 
-	else { 
-	  r_max = 0;
-	  for(ii=s1;ii<s2;ii++) r_max = VL_MAX(temp[index+3*width*ii],r_max);
-	}
-	
-	/* get new green max */
-	new1 = temp[index+3*width*(s2-1)+1];
-	if(new1 > g_max) g_max = new1;
-	else { 
-	  g_max = 0;
-	  for(ii=s1;ii<s2;ii++) g_max = VL_MAX(temp[index+3*width*ii+1],g_max);
-	}
-	
-	/* get new blue max */
-	new1 = temp[index+3*width*(s2-1)+2];
-	if(new1 > b_max) b_max = new1; 
-	else { 
-	  b_max = 0;
-	  for(ii=s1;ii<s2;ii++) b_max = VL_MAX(temp[index+3*width*ii+2],b_max);
-	}
-      } 
-      
-      /* set output */
-      output[index] = r_max;
-      output[index+1] = g_max;
-      output[index+2] = b_max;
-    }
-  }  
+  return (_vlRgbMorph (src, size, window, dest, FALSE, "vlRgbErode"));
+}
 
-  /* get rid of temporary image */
-  VL_FREE(temp);
 
-  return (0);			/* success */  
+/* rgb dilation */
+int
+vlRgbDilate(vlImage *src,int size,vlWindow *window,vlImage *dest)
+{
+  return (_vlRgbMorph (src, size, window, dest, TRUE, "vlRgbDilate"));
 }
 
 
+
 /* -----------------------------------------------------------
    EDGE DETECTION - based on morphological tools
    ----------------------------------------------------------- */
@@ -431,189 +195,177 @@ vlEdgeDetect(vlImage *src,int size,vlWindow *window,vlImage *dest)
    BINARY IMAGES - erode and dilate
    ----------------------------------------------------------- */
 
-int
-vlBinaryErode(vlImage *src,int size,vlWindow *window,vlImage *dest)
+vlMorphScratch *
+vlMorphScratchCreate (void)
 {
-  int i,j;
-  int x1,x2,y1,y2;
-  int s1,s2;
-  int width,height;
-  vlPixel *input;
-  vlPixel *output;
+  vlMorphScratch *scratch;
 
-  /* verify parameters */
-  if ((!src) || (size <= 0) || (!window) || (!dest)) {
-    VL_ERROR ("vlBinaryErode: error: illegal parameter\n");
-    return (-1);		/* failure */
-  }
-  
-  /* make sure we're given a BINARY image */
-  if(src->format != BINARY){
-    VL_ERROR ("vlBinaryErode: error: src image is not BINARY\n");
-    return (-1);		/* failure */
+  if (NULL == (scratch = (vlMorphScratch *) malloc (sizeof(vlMorphScratch)))) {
+    VL_ERROR ("vlMorphScratchCreate: malloc failed\n");
+    return (NULL);
   }
+  scratch->buffer = NULL;
+  scratch->size = 0;
 
-  /* copy all the image so that not filtered area is uptodate */
-  if (0 > vlImageCopy (src, dest)) {
-    VL_ERROR ("vlBinaryErode: unable to copy original image\n");
-    return (-1);		/* failure */
+  return (scratch);
+}
+
+
+void
+vlMorphScratchDestroy (vlMorphScratch *scratch)
+{
+  if (scratch) {
+    VL_FREE (scratch->buffer);
+    VL_FREE (scratch);
   }
+}
 
-  /* extract useful data */
-  width = src->width;
-  height = src->height;
-  input = src->pixel;
-  output = dest->pixel;
-  s2 = size/2;
-  s1 = -(size-s2);
-  x1 = VL_MAX(window->x-s1,-s1);
-  x2 = VL_MIN(window->x+window->width,width-s2);
-  y1 = VL_MAX(window->y-s1,-s1);
-  y2 = VL_MIN(window->y+window->height,height-s2);
 
-  for(j=y1;j<y2;j++) {
-    for(i=x1;i<x2;i++){
-      int ii,jj;
-      
-      /* if original is set, ignore what follows */
-      if(input[j*width+i] != 0)	continue;
-      
-      /* else padd the slider area around current pixel in image */
-      for(jj=s1;jj<s2;jj++){
-	int y = j + jj;
-	int index = y*width;
-	for(ii=s1;ii<s2;ii++){
-	  int x = i + ii;
-	  output[index+x] = 0;
-	}
-      }
-    }
+/* make sure scratch holds at least size values */
+int
+_vlMorphScratchReserve (vlMorphScratch *scratch, int size)
+{
+  int *buffer;
+
+  if (size <= scratch->size) {
+    return (0);
   }
-  
+  if (NULL == (buffer = (int *) realloc (scratch->buffer,
+					 size*sizeof(int)))) {
+    VL_ERROR ("_vlMorphScratchReserve: realloc failed\n");
+    return (-1);		/* failure */
+  }
+  scratch->buffer = buffer;
+  scratch->size = size;
+
   return (0);			/* success */
 }
 
-int
-vlBinaryDilate(vlImage *src,int size,vlWindow *window,vlImage *dest)
+
+/* in place erosion/dilation over the square [s1,s2) (vlMorphRow.h) */
+static int
+_vlBinaryMorph (vlImage *image, int size, vlWindow *window, int dilate,
+		vlMorphScratch *scratch)
 {
-  int i,j;
-  int x1,x2,y1,y2;
-  int s1,s2;
-  int width,height;
-  vlPixel *input;
-  vlPixel *output;
+  return (_vlBinaryMorphRows (image->pixel, image->width, 1, image->width,
+			      image->height, size, window, dilate, scratch));
+}
+
+
+/* copy src to dest and erode/dilate it there */
+static int
+_vlBinaryMorphCopy (vlImage *src, int size, vlWindow *window, vlImage *dest,
+		    int dilate, const char *name)
+{
+  vlMorphScratch scratch;
+  int status;
 
   /* verify parameters */
   if ((!src) || (size <= 0) || (!window) || (!dest)) {
-    VL_ERROR ("vlBinaryDilate: error: illegal parameter\n");
+    VL_ERROR ("%s: error: illegal parameter\n", name);
     return (-1);		/* failure */
   }
   
-  /* make sure we're given a BW image */
+  /* make sure we're given a BINARY image */
   if(src->format != BINARY){
-    VL_ERROR ("vlBinaryDilate: error: src image is not BINARY\n");
+    VL_ERROR ("%s: error: src image is not BINARY\n", name);
     return (-1);		/* failure */
   }
 
   /* copy all the image so that not filtered area is uptodate */
-  if (0 > vlImageCopy (src, dest)) {
-    VL_ERROR ("_vlBinaryDilate: unable to copy original image\n");
+  if ((src != dest) && (0 > vlImageCopy (src, dest))) {
+    VL_ERROR ("%s: unable to copy original image\n", name);
     return (-1);		/* failure */
   }
-  
-  /* temp variables to speed up conversion */
-  width = src->width;
-  height = src->height;
-  input = src->pixel;
-  output = dest->pixel;
-  s2 = size/2;
-  s1 = -(size-s2);
-  x1 = VL_MAX(window->x-s1,-s1);
-  x2 = VL_MIN(window->x+window->width,width-s2);
-  y1 = VL_MAX(window->y-s1,-s1);
-  y2 = VL_MIN(window->y+window->height,height-s2);
- 
-  for(j=y1;j<y2;j++) {
-    for(i=x1;i<x2;i++){
-      int ii,jj;
-      
-      /* if original is set, ignore what follows */
-      if(input[j*width+i] == 0)	continue;
-      
-      /* else padd the slider area around current pixel in image */
-      for(jj=s1;jj<s2;jj++){
-	int y = j + jj;
-	int index = y*width;
-	for(ii=s1;ii<s2;ii++){
-	  int x = i + ii;
-	  output[index+x] = 255;
-	}
-      }
-    }
-  }
 
-  return (0);			/* success */
+  scratch.buffer = NULL;
+  scratch.size = 0;
+  status = _vlBinaryMorph (dest, size, window, dilate, &scratch);
+  VL_FREE (scratch.buffer);
+
+  return (status);
 }
 
+int
+vlBinaryErode(vlImage *src,int size,vlWindow *window,vlImage *dest)
+{
+  return (_vlBinaryMorphCopy (src, size, window, dest, FALSE,
+			      "vlBinaryErode"));
+}
 
 int
-vlBinaryOpen(vlImage *src,int size,int num,vlWindow *window)
+vlBinaryDilate(vlImage *src,int size,vlWindow *window,vlImage *dest)
 {
-vlImage *dest1;
-int i,j;
+  return (_vlBinaryMorphCopy (src, size, window, dest, TRUE,
+			      "vlBinaryDilate"));
+}
 
-dest1 = VL_IMAGE_CREATE ();
 
-if (src->format != BINARY) {
-    VL_ERROR ("vlBinaryOpen: src image is not BINARY\n");
+/* open/close in place: num erosions followed by num dilations (the
+   reverse for close), each one written straight back into src. The only
+   memory used is scratch, which keeps its buffer between calls; a
+   temporary one is used if scratch is NULL */
+static int
+_vlBinaryOpenClose (vlImage *src, int size, int num, vlWindow *window,
+		    vlMorphScratch *scratch, int close, const char *name)
+{
+  vlMorphScratch temp;
+  int i, status;
+
+  if ((!src) || (size <= 0) || (!window)) {
+    VL_ERROR ("%s: error: illegal parameter\n", name);
     return (-1);		/* failure */
   }
-  /* initialize the new picture */
-  if (0 > vlImageInit (dest1, BINARY, src->width, src->height)) {
-    VL_ERROR ("vlRgb2Binary: error: could not initialize dest image\n");
+
+  if (src->format != BINARY) {
+    VL_ERROR ("%s: src image is not BINARY\n", name);
     return (-1);		/* failure */
   }
-for(i=0;i<num;i++){
-	vlBinaryErode(src,size,window,dest1);
-	vlImageCopy(dest1, src);
-}
-for(j=0;j<num;j++){
-	vlBinaryDilate(src,size,window,dest1);
-	vlImageCopy(dest1, src);
-}
-vlImageDestroy(dest1);
 
-return (0);
+  if (!scratch) {
+    temp.buffer = NULL;
+    temp.size = 0;
+    scratch = &temp;
+  }
+
+  status = 0;
+  for(i=0;(i<2*num)&&(status==0);i++){
+    status = _vlBinaryMorph (src, size, window, (i<num) == close, scratch);
+  }
+
+  if (scratch == &temp) {
+    VL_FREE (temp.buffer);
+  }
+
+  return (status);
 }
 
-int vlBinaryClose(vlImage *src,int size,int t,vlWindow *window)
+int
+vlBinaryOpen(vlImage *src,int size,int num,vlWindow *window)
 {
-	int i,j;
-	vlImage *dest1;
-	dest1 = VL_IMAGE_CREATE ();
-	if (src->format != BINARY) {
-		VL_ERROR ("vlBinaryOpen: src image is not BINARY\n");
-		return (-1);		/* failure */
-	  }
-	  /* initialize the new picture */
-
-	if (0 > vlImageInit (dest1, BINARY, src->width, src->height)) {
-		VL_ERROR ("vlRgb2Binary: error: could not initialize dest image\n");
-		return (-1);		/* failure */
-	  }
-	for(i=0;i<t;i++){
-		vlBinaryDilate(src,size,window,dest1);
-		vlImageCopy(dest1, src);
-	}
-	for(j=0;j<t;j++){
-		vlBinaryErode(src,size,window,dest1);
-		vlImageCopy(dest1, src);
-	}
-
-	vlImageDestroy(dest1);
-	return (0);
+  return (_vlBinaryOpenClose (src, size, num, window, NULL, FALSE,
+			      "vlBinaryOpen"));
 }
 
+int
+vlBinaryClose(vlImage *src,int size,int t,vlWindow *window)
+{
+  return (_vlBinaryOpenClose (src, size, t, window, NULL, TRUE,
+			      "vlBinaryClose"));
+}
 
+int
+vlBinaryOpenScratch(vlImage *src,int size,int num,vlWindow *window,
+		    vlMorphScratch *scratch)
+{
+  return (_vlBinaryOpenClose (src, size, num, window, scratch, FALSE,
+			      "vlBinaryOpenScratch"));
+}
 
-
+int
+vlBinaryCloseScratch(vlImage *src,int size,int num,vlWindow *window,
+		     vlMorphScratch *scratch)
+{
+  return (_vlBinaryOpenClose (src, size, num, window, scratch, TRUE,
+			      "vlBinaryCloseScratch"));
+}
@@ -6,6 +6,28 @@
 #include "global.h"
 typedef unsigned int size_t;
 
+/*
+ * Fill the cumulative and partial expectation distributions of a histogram
+ * from its bins, as OtsuThreshold() and HistogramMedian() need them
+ */
+void HistogramSums (Histogram_t *histogram)
+{
+  const size_t *ptrBins = histogram->bins;
+  size_t *ptrSumBins    = histogram->sumBins;
+  size_t *ptrMeanBins   = histogram->meanBins;
+  size_t accumSum       = 0;
+  size_t accumMean      = 0;
+
+  const size_t numBins = histogram->numberBins;
+  size_t tmp, i;
+  for (i = 0; i < numBins; i++)
+  {
+    tmp       = *ptrBins++;
+    accumSum  = *ptrSumBins++  = accumSum + tmp;
+    accumMean = *ptrMeanBins++ = accumMean + i * tmp;
+  }
+}
+
 /*
  * Compute the histogram of pixel values in an image
  *
@@ -54,20 +76,7 @@ void ImageHistogram (Histogram_t    *outHistogram,
   	}
   ////////////////////////////////////
 
-  /* cumulative and partial expectation distributions */
-  size_t *ptrSumBins  = outHistogram->sumBins;
-  size_t *ptrMeanBins = outHistogram->meanBins;
-  size_t accumSum     = 0;
-  size_t accumMean    = 0;
-
-  const size_t numBins = outHistogram->numberBins;
-  size_t tmp, i;
-  for (i = 0; i < numBins; i++)
-  {
-    tmp       = *ptrBins++;
-    accumSum  = *ptrSumBins++  = accumSum + tmp;
-    accumMean = *ptrMeanBins++ = accumMean + i * tmp;
-  }
+  HistogramSums (outHistogram);
 }
 
 
@@ -118,20 +127,7 @@ void ImageHistogramDist (Histogram_t    *outHistogram,
 		}
   	}
 ////////////////////////////////////////////////////////////
-  /* cumulative and partial expectation distributions */
-  size_t *ptrSumBins  = outHistogram->sumBins;
-  size_t *ptrMeanBins = outHistogram->meanBins;
-  size_t accumSum     = 0;
-  size_t accumMean    = 0;
-
-  const size_t numBins = outHistogram->numberBins;
-  size_t tmp, i;
-  for (i = 0; i < numBins; i++)
-  {
-    tmp       = *ptrBins++;
-    accumSum  = *ptrSumBins++  = accumSum + tmp;
-    accumMean = *ptrMeanBins++ = accumMean + i * tmp;
-  }
+  HistogramSums (outHistogram);
 }
 
 size_t OtsuThreshold (const Histogram_t *inHistogram)
@@ -154,7 +150,8 @@ size_t OtsuThreshold (const Histogram_t *inHistogram)
     p    = *ptrSumBins++;
     a    = UINTDIFF( *ptrMeanBins++, mean * p );
     
-    curr = (a * a) / (p * (numCounts - p));
+    /* no variance while one class is empty */
+    curr = (p == 0 || p == numCounts) ? 0 : (a * a) / (p * (numCounts - p));
     if (curr < last)
     {
       break;
@@ -204,54 +201,200 @@ size_t HistogramMedian (const Histogram_t *inHistogram)
 }
 
 
-void cal_threshold(vlImage *pic, vlHSI_carl_tol_t *para )
+/* bin of a H (degrees) or S/I (percent) value. VL_PIXEL_MAXVAL itself
+   falls one past the 360 or 100 bins, so it goes in the last one */
+#define HSI_BIN( CONV, V, NUMBINS ) \
+  ( (CONV(V) < (NUMBINS)) ? CONV(V) : (NUMBINS) - 1 )
+
+/*
+ * Compute the H, S and I histograms of a RGB image, and the histograms of
+ * the distances from the reference values ref->h, ref->s and ref->i to
+ * them, in one pass
+ *
+ * This gives the six histograms of ImageHistogram() and ImageHistogramDist()
+ * on the H, S and I planes of the image, without making the HSI image or
+ * its planes: every pixel is converted once (a row at a time, with
+ * vlRgb2HsiRow) and counted in all of them. Only the pixels on a grid of
+ * step pixels in both directions are taken, step 1 being the whole image;
+ * numberCounts is the number of these pixels.
+ *
+ * The bins are cleared first, so the same histograms may be used for a
+ * frame after the other. The H histograms need 360 bins, the others 100
+ * (see HHISTOGRAM, SHISTOGRAM, IHISTOGRAM).
+ *
+ * Returns 0, or -1 if the image is not RGB or memory is short.
+ */
+int ImageHistogramHsi (Histogram_t *outH,
+                       Histogram_t *outS,
+                       Histogram_t *outI,
+                       Histogram_t *outDistH,
+                       Histogram_t *outDistS,
+                       Histogram_t *outDistI,
+                       const vlImage *inImg,
+                       const vlHSI_carl_tol_t *ref,
+                       int step)
 {
+  Histogram_t *all[6] = { outH, outS, outI, outDistH, outDistS, outDistI };
+  const size_t numH = outH->numberBins;
+  const size_t numS = outS->numberBins;
+  const size_t numI = outI->numberBins;
+  const size_t numDistH = outDistH->numberBins;
+  const size_t numDistS = outDistS->numberBins;
+  const size_t numDistI = outDistI->numberBins;
+  size_t *binsH = outH->bins;
+  size_t *binsS = outS->bins;
+  size_t *binsI = outI->bins;
+  size_t *binsDistH = outDistH->bins;
+  size_t *binsDistS = outDistS->bins;
+  size_t *binsDistI = outDistI->bins;
+  const vlPixel refH = ref->h, refS = ref->s, refI = ref->i;
 
-  vlImage *dest,*desth,*dests,*desti;
-  
-  vlWindow *window;
- 
-  /*Create window*/	
-  window = vlWindowCreate (0, 0, pic->width, pic->height);
-  /* init vars */
-  dest= VL_IMAGE_CREATE (); 
-  
-  desth= VL_IMAGE_CREATE (); 
-  dests= VL_IMAGE_CREATE (); 
-  desti= VL_IMAGE_CREATE ();  
-  
+  vlPixel *rgb, *hsi;
+  const vlPixel *ptrHsi, *endHsi;
+  const vlPixel *input;
+  int x, y, k, n;
+
+  if (inImg->format != RGB || step < 1)
+  {
+    return -1;
+  }
+
+  /* one row of the gathered RGB samples, one of their HSI values */
+  n = (inImg->width + step - 1) / step;
+  rgb = (vlPixel *) malloc (2 * VL_RGB_PIXEL * (n + 1) * sizeof (vlPixel));
+  if (rgb == NULL)
+  {
+    return -1;
+  }
+  hsi = rgb + VL_RGB_PIXEL * (n + 1);
+
+  for (k = 0; k < 6; k++)
+  {
+    memset( all[k]->bins, 0, all[k]->numberBins * sizeof(size_t) );
+    all[k]->numberCounts = 0;
+  }
+
+  for (y = 0; y < inImg->height; y += step)
+  {
+    input = inImg->pixel + VL_RGB_PIXEL * y * inImg->width;
+    if (step == 1)
+    {
+      vlRgb2HsiRow( input, hsi, n );
+    }
+    else
+    {
+      for (x = 0, k = 0; x < n; x++, k += VL_RGB_PIXEL * step)
+      {
+        rgb[VL_RGB_PIXEL * x]     = input[k];
+        rgb[VL_RGB_PIXEL * x + 1] = input[k + 1];
+        rgb[VL_RGB_PIXEL * x + 2] = input[k + 2];
+      }
+      vlRgb2HsiRow( rgb, hsi, n );
+    }
+
+    ptrHsi = hsi;
+    endHsi = hsi + VL_HSI_PIXEL * n;
+    while (ptrHsi != endHsi)
+    {
+      const vlPixel h = ptrHsi[0], s = ptrHsi[1], i = ptrHsi[2];
+      const vlPixel dh = UINTDIFF( h, refH );
+      const vlPixel ds = UINTDIFF( s, refS );
+      const vlPixel di = UINTDIFF( i, refI );
+
+      binsH[ HSI_BIN( HVAL_TO_HDEG, h, numH ) ]++;
+      binsS[ HSI_BIN( SVAL_TO_SPCT, s, numS ) ]++;
+      binsI[ HSI_BIN( IVAL_TO_IPCT, i, numI ) ]++;
+      binsDistH[ HSI_BIN( HVAL_TO_HDEG, dh, numDistH ) ]++;
+      binsDistS[ HSI_BIN( SVAL_TO_SPCT, ds, numDistS ) ]++;
+      binsDistI[ HSI_BIN( IVAL_TO_IPCT, di, numDistI ) ]++;
+      ptrHsi += VL_HSI_PIXEL;
+    }
+
+    for (k = 0; k < 6; k++)
+    {
+      all[k]->numberCounts += n;
+    }
+  }
+
+  for (k = 0; k < 6; k++)
+  {
+    HistogramSums( all[k] );
+  }
+
+  free (rgb);
+  return 0;
+}
+
+
+/*
+ * Set the tolerances of para, around its reference values para->h, para->s
+ * and para->i, from the image: each one is the Otsu threshold of the
+ * distances to the reference in that channel. step is as for
+ * ImageHistogramHsi(): 1 for every pixel, more for a cheaper calibration
+ * that can run on every frame as the lighting changes.
+ *
+ * Returns 0, or -1 if the image is not RGB, is empty or memory is short.
+ */
+int cal_threshold_step(vlImage *pic, vlHSI_carl_tol_t *para, int step)
+{
   HHISTOGRAM( outHistogramh );
   SHISTOGRAM( outHistograms );
   IHISTOGRAM( outHistogrami );
- 
-  vlRgb2Hsi(pic,window,dest);
+  HHISTOGRAM( distHistogramh );
+  SHISTOGRAM( distHistograms );
+  IHISTOGRAM( distHistogrami );
 
-  vlHsi2H(dest,window,desth);
-  vlHsi2S(dest,window,dests);
-  vlHsi2I(dest,window,desti);
+  if (pic->width <= 0 || pic->height <= 0)
+  {
+    return -1;
+  }
+
+  if (0 > ImageHistogramHsi(&outHistogramh, &outHistograms, &outHistogrami,
+                            &distHistogramh, &distHistograms, &distHistogrami,
+                            pic, para, step))
+  {
+    return -1;
+  }
+
+  para->h_tol=OtsuThreshold (&distHistogramh);
+  para->s_tol=OtsuThreshold (&distHistograms);
+  para->i_tol=OtsuThreshold (&distHistogrami);
 
-  ImageHistogram(&outHistogramh,desth);
-  ImageHistogram(&outHistograms,dests);
-  ImageHistogram(&outHistogrami,desti);
-  
-  ImageHistogramDist(&outHistogramh,desth, para->h);
-  ImageHistogramDist(&outHistograms,dests, para->s);
-  ImageHistogramDist(&outHistogrami,desti, para->i);
+  return 0;
+}
 
-  para->h_tol=OtsuThreshold (&outHistogramh);
-  para->s_tol=OtsuThreshold (&outHistograms);
-  para->i_tol=OtsuThreshold (&outHistogrami);
+
+/*
+ * cal_threshold_step() on a level of pyramid, built from the RGB image to
+ * calibrate on: level k has 4^k times fewer pixels, each the mean of a
+ * block, so the calibration gets cheaper without skipping any pixel.
+ *
+ * Returns 0, or -1 if the level does not exist or cal_threshold_step()
+ * fails on it.
+ */
+int cal_threshold_pyramid(vlPyramid *pyramid, vlHSI_carl_tol_t *para, int level)
+{
+  if (!pyramid || level < 0 || level >= pyramid->levels ||
+      !pyramid->level[level])
+  {
+    return -1;
+  }
+
+  return cal_threshold_step(pyramid->level[level], para, 1);
+}
+
+
+void cal_threshold(vlImage *pic, vlHSI_carl_tol_t *para )
+{
+  if (0 > cal_threshold_step(pic, para, 1))
+  {
+    return;
+  }
 
   printf("%d\n",  para->h_tol);
   printf("%d\n",  para->s_tol);
   printf("%d\n",  para->i_tol);
 
-  vlImageDestroy(dest);
-  vlImageDestroy(desth);
-  vlImageDestroy(dests);
-  vlImageDestroy(desti);
-
   return;
 
 }
-
@@ -323,7 +323,8 @@ int vlCorrelation(vlImage *pic, vlImage *pic2){
  *	dynamically update/adapt the color boundaries of an object
  *
  * INPUTS:
- *   nrg_pic
+ *   nrg_pic	in the object format. For a NRG object, the RGB picture
+ *		will do: the object pixels are converted as they are read
  *   bin_pic
  *   object
  *
@@ -340,6 +341,8 @@ vlObjectColorUpdate (vlImage *pic, vlImage *bin_pic, vlObject *object)
   int x1, x2, y1, y2;
   vlPixel *pixel;
   vlPixel *bin_pixel;
+  vlPixel *nrg_pixel;
+  vlPixel *nrg_row = NULL;
   int *x_offset;
   int *x_length;
 
@@ -360,7 +363,8 @@ vlObjectColorUpdate (vlImage *pic, vlImage *bin_pic, vlObject *object)
     return (-1);		/* failure */
   }
 
-  if (object->format != pic->format) {
+  if ((object->format != pic->format) &&
+      ((object->format != NRG) || (pic->format != RGB))) {
     VL_ERROR ("vlObjectColorUpdate: image & object format do not match\n");
     return (-1);		/* failure */
   }
@@ -385,6 +389,15 @@ vlObjectColorUpdate (vlImage *pic, vlImage *bin_pic, vlObject *object)
 
       vlPixel nr_max_actual=0, nr_min_actual=255;
       vlPixel ng_max_actual=0, ng_min_actual=255;
+
+      /* a RGB picture is converted one object line at a time */
+      if (pic->format == RGB) {
+	nrg_row = (vlPixel *) malloc (VL_NRG_PIXEL * width * sizeof (vlPixel));
+	if (!nrg_row) {
+	  VL_ERROR ("vlObjectColorUpdate: error: not enough memory\n");
+	  return (-1);		/* failure */
+	}
+      }
   
       /* for each line */
       for (j=y1; j<y2; j++) {
@@ -394,12 +407,22 @@ vlObjectColorUpdate (vlImage *pic, vlImage *bin_pic, vlObject *object)
 	
 	/* the following is only valid for binary (one component) images */
 	bin_pixel = bin_pic->pixel + (j*width) + colStart;
+
+	/* NRG values of the line, from colStart */
+	if (nrg_row) {
+	  vlRgb2NrgRow (pixel + VL_RGB_PIXEL * (j*width+colStart), nrg_row,
+			colEnd-colStart);
+	  nrg_pixel = nrg_row;
+	}
+	else {
+	  nrg_pixel = pixel + VL_NRG_PIXEL * (j*width+colStart);
+	}
 	
 	for (i=colStart; i<colEnd; i++) {
 	  if (*bin_pixel++) {
-	    int index = VL_NRG_PIXEL * (j*width+i);
-	    int nr = pixel[index];
-	    int ng = pixel[index+1];
+	    int index = VL_NRG_PIXEL * (i-colStart);
+	    int nr = nrg_pixel[index];
+	    int ng = nrg_pixel[index+1];
 	    
 	    /* update thresholds */
 	    nr_max_actual = VL_MAX (nr, nr_max_actual);
@@ -409,6 +432,7 @@ vlObjectColorUpdate (vlImage *pic, vlImage *bin_pic, vlObject *object)
 	  }
 	}
       }
+      VL_FREE (nrg_row);
   
       /*
        * update object color boundaries
@@ -688,6 +712,7 @@ vlObjectMotionUpdate (vlObject *object)
   if (last_x[0] == -1) {
     object->next_x = last_x[2] = last_x[1] = last_x[0] = object->x;
     object->next_y = last_y[2] = last_y[1] = last_y[0] = object->y;
+    object->x_vel = object->y_vel = 0;
     return (0);			/* success */
   }
 
@@ -702,6 +727,8 @@ vlObjectMotionUpdate (vlObject *object)
   /* compute dx, dy */
   dx = last_x[0] - last_x[1];
   dy = last_y[0] - last_y[1];
+  object->x_vel = dx;		/* pixels per update */
+  object->y_vel = dy;
 
   /* finally, compute next position estimate */
   object->next_x = last_x[0] + dx/2;
@@ -1741,93 +1768,84 @@ int getobjectcolorhsi (vlHSI_carl_tol_t *objectcolor)
  }
 
 
-int
-vlBinary(vlImage *src, vlHSI_carl_tol_t *para,vlImage * dest)
+/******************************************************************************
+ *
+ * vlBinaryRow --
+ *	threshold n consecutive RGB pixels as vlBinary does: 255 where the
+ *      pixel is out of the HSI box of para, 0 inside. hsi is a scratch row
+ *      of n HSI pixels.
+ *
+ *****************************************************************************/
+void
+vlBinaryRow(const vlPixel *src, vlHSI_carl_tol_t *para, int n,
+	    vlPixel *hsi, vlPixel *dest)
 {
-  int i, j;
-  int index, width;
-  int x1, x2, y1, y2;
+  int i;
   int h_max, h_min;
   int s_max, s_min;
   int i_max, i_min;
-  vlImage *src1;
   vlPixel *input;
-  vlPixel *output;
-  vlPoint *point1;
-  vlWindow *window;
-  
-  src1 = VL_IMAGE_CREATE ();
-  point1 = vlPointCreate (0, 0);
-  point1->h=para->h;
-  point1->s=para->s;
-  point1->i=para->i;
-  
-    /* make sure we have a RGB picture */
-    if (src->format != RGB) {
-      VL_ERROR ("vlRgb2Binary: src image is not RGB\n");
-      return (-1);		/* failure */
-    }
 
-    /* initialize the new picture */
-    if (0 > vlImageInit (dest, BINARY, src->width, src->height)) {
-      VL_ERROR ("vlRgb2Binary: error: could not initialize dest image\n");
-      return (-1);		/* failure */
-    }
+  h_max = para->h+HDEG_TO_HVAL(para->h_tol);
+  h_min = para->h-HDEG_TO_HVAL(para->h_tol);
+  s_max = para->s+SPCT_TO_SVAL(para->s_tol);
+  s_min = para->s-SPCT_TO_SVAL(para->s_tol);
+  i_max = para->i+IPCT_TO_IVAL(para->i_tol);
+  i_min = para->i-IPCT_TO_IVAL(para->i_tol);
 
-    /* temp variables to optimize memory access */
-    window = vlWindowCreate (0, 0, src->width, src->height);
-    vlRgb2Hsi(src, window, src1);
+  vlRgb2HsiRow (src, hsi, n);
 
-    if (src1->format != HSI) {
-      VL_ERROR ("vlHsi2Binary: src1 image is not HSI\n");
-      return (-1);		/* failure */
+  for (i=0, input=hsi; i<n; i++, input+=VL_HSI_PIXEL) {
+    if ((input[0]>h_max) || (input[0]<h_min) ||
+	(input[1]>s_max) || (input[1]<s_min) ||
+	(input[2]>i_max) || (input[2]<i_min)) {
+      dest[i] = 255;
+    }
+    else {
+      dest[i] = 0;
     }
+  }
+}
 
-   /*printf("width %d height %d",src1->width, src1->height);*/
-   width = src1->width;
-   x1 = window->x;
-   x2 = x1 + (window->width);
-   y1 = window->y;
-   y2 = y1 + (window->height);  
-   input = src1->pixel;
-   output = dest->pixel;
-   h_max = point1->h+HDEG_TO_HVAL(para->h_tol);
-   h_min = point1->h-HDEG_TO_HVAL(para->h_tol);
-   s_max = point1->s+SPCT_TO_SVAL(para->s_tol);
-   s_min = point1->s-SPCT_TO_SVAL(para->s_tol);
-   i_max = point1->i+IPCT_TO_IVAL(para->i_tol);
-   i_min = point1->i-IPCT_TO_IVAL(para->i_tol);
-
-   /*
-   printf("\n h_max%d,  h_min %d",h_max,h_min);
-   printf("\n s_max%d,  s_min %d",s_max,s_min);
-   printf("\n i_max%d,  i_min %d",i_max,i_min);
-   */
 
-   /* proceed to conversion */
-   for (j=y1; j<y2; j++) {
-     for (i=x1; i<x2; i++) {
-       index = VL_HSI_PIXEL * (j*width + i);
-       if ((input[index]>h_max)
-	  	||(input[index]<h_min) 
-	  	||(input[index+1]>s_max)
-	  	||(input[index+1]<s_min)
-	  	||(input[index+2]>i_max)
-	  	||(input[index+2]<i_min))
-	  	{
-	          output[index/VL_HSI_PIXEL] = 255;
-             }
-       else {
-	   	output[index/VL_HSI_PIXEL] = 0;
-              }
-      }
-   }
+/* HSI thresholding of a RGB picture, a row at a time */
+int
+vlBinary(vlImage *src, vlHSI_carl_tol_t *para,vlImage * dest)
+{
+  int j;
+  int width;
+  vlPixel *hsi;
 
-   vlImageDestroy(src1);
-   vlPointDestroy(point1);
-   vlWindowDestroy(window);
-   
-   return (0);	
- }
+  if ((!src) || (!para) || (!dest)) {
+    VL_ERROR ("vlBinary: error: one of the parameters is NULL\n");
+    return (-1);		/* failure */
+  }
+
+  /* make sure we have a RGB picture */
+  if (src->format != RGB) {
+    VL_ERROR ("vlBinary: src image is not RGB\n");
+    return (-1);		/* failure */
+  }
+
+  /* initialize the new picture */
+  if (0 > vlImageInit (dest, BINARY, src->width, src->height)) {
+    VL_ERROR ("vlBinary: error: could not initialize dest image\n");
+    return (-1);		/* failure */
+  }
+
+  width = src->width;
+  if (!(hsi = (vlPixel *) malloc (VL_HSI_SIZE (width, 1)))) {
+    VL_ERROR ("vlBinary: malloc failed\n");
+    return (-1);		/* failure */
+  }
+
+  for (j=0; j<src->height; j++) {
+    vlBinaryRow (src->pixel + VL_RGB_PIXEL*j*width, para, width, hsi,
+		 dest->pixel + j*width);
+  }
 
+  VL_FREE (hsi);
+
+  return (0);			/* success */
+}
 
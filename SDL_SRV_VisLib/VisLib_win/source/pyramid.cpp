@@ -0,0 +1,748 @@
+/*****************************************************************************
+ *
+ * FILE:     pyramid.cpp
+ *
+ * ABSTRACT: 2x binned image pyramids, built in one pass over the picture,
+ *           and the coarse to fine shape search on them.
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vislib.h"
+#include "vlCpu.h"
+#include "vlPyramid.h"
+
+#ifdef VL_X86
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <immintrin.h>
+#endif
+
+
+vlPyramid *
+vlPyramidCreate (int levels)
+{
+  int k;
+  vlPyramid *pyramid;
+
+  if ((levels <= 0) || (levels > VL_PYRAMID_LEVELS)) {
+    levels = VL_PYRAMID_LEVELS;
+  }
+
+  if (NULL == (pyramid = (vlPyramid *) calloc (1, sizeof(vlPyramid)))) {
+    VL_ERROR ("vlPyramidCreate: malloc failed\n");
+    return (NULL);
+  }
+  pyramid->levels = levels;
+
+  /* level 0 is the picture, given to vlPyramidBuild */
+  for (k=1; k<levels; k++) {
+    if (NULL == (pyramid->level[k] = vlImageCreate (NONE, 0, 0))) {
+      vlPyramidDestroy (pyramid);
+      return (NULL);
+    }
+  }
+
+  return (pyramid);
+}
+
+
+void
+vlPyramidDestroy (vlPyramid *pyramid)
+{
+  int k;
+
+  if (pyramid) {
+    for (k=1; k<pyramid->levels; k++) {
+      vlImageDestroy (pyramid->level[k]);
+    }
+    VL_FREE (pyramid->mask);
+    VL_FREE (pyramid);
+  }
+}
+
+
+#ifdef VL_X86
+/* 8 rounded means of the 2x2 blocks of 16 single channel pixels of r0 and
+   r1, in 32 bit lanes: the even pixels are the low halves, the odd ones
+   the high halves */
+static inline __m128i
+_vlPyramidBinSSE2 (const vlPixel *r0, const vlPixel *r1)
+{
+  __m128i low = _mm_set1_epi32 (0xFFFF);
+  __m128i two = _mm_set1_epi32 (2);
+  __m128i bias = _mm_set1_epi32 (32768);
+  __m128i a0 = _mm_loadu_si128 ((const __m128i *) r0);
+  __m128i a1 = _mm_loadu_si128 ((const __m128i *) r1);
+  __m128i b0 = _mm_loadu_si128 ((const __m128i *) (r0+8));
+  __m128i b1 = _mm_loadu_si128 ((const __m128i *) (r1+8));
+  __m128i a, b;
+
+  a = _mm_add_epi32 (_mm_add_epi32 (_mm_and_si128 (a0, low), _mm_srli_epi32 (a0, 16)),
+		     _mm_add_epi32 (_mm_and_si128 (a1, low), _mm_srli_epi32 (a1, 16)));
+  b = _mm_add_epi32 (_mm_add_epi32 (_mm_and_si128 (b0, low), _mm_srli_epi32 (b0, 16)),
+		     _mm_add_epi32 (_mm_and_si128 (b1, low), _mm_srli_epi32 (b1, 16)));
+  a = _mm_srli_epi32 (_mm_add_epi32 (a, two), 2);
+  b = _mm_srli_epi32 (_mm_add_epi32 (b, two), 2);
+
+  /* no unsigned 32 to 16 bit pack in SSE2: pack signed around 32768 */
+  return (_mm_xor_si128 (_mm_packs_epi32 (_mm_sub_epi32 (a, bias),
+					  _mm_sub_epi32 (b, bias)),
+			 _mm_set1_epi16 ((short) 0x8000)));
+}
+
+
+/* 8 rounded means r0[k]+r0[k+3]+r1[k]+r1[k+3] of consecutive values k of
+   RGB rows, where the two pixels of a block are 3 values apart. Only the
+   k of the first pixel of a block (k%6 < 3) are means of blocks */
+static inline __m128i
+_vlPyramidBinRgbSSE2 (const vlPixel *r0, const vlPixel *r1)
+{
+  __m128i zero = _mm_setzero_si128 ();
+  __m128i two = _mm_set1_epi32 (2);
+  __m128i bias = _mm_set1_epi32 (32768);
+  __m128i a0 = _mm_loadu_si128 ((const __m128i *) r0);
+  __m128i a1 = _mm_loadu_si128 ((const __m128i *) r1);
+  __m128i b0 = _mm_loadu_si128 ((const __m128i *) (r0+3));
+  __m128i b1 = _mm_loadu_si128 ((const __m128i *) (r1+3));
+  __m128i lo, hi;
+
+  lo = _mm_add_epi32 (_mm_add_epi32 (_mm_unpacklo_epi16 (a0, zero), _mm_unpacklo_epi16 (b0, zero)),
+		      _mm_add_epi32 (_mm_unpacklo_epi16 (a1, zero), _mm_unpacklo_epi16 (b1, zero)));
+  hi = _mm_add_epi32 (_mm_add_epi32 (_mm_unpackhi_epi16 (a0, zero), _mm_unpackhi_epi16 (b0, zero)),
+		      _mm_add_epi32 (_mm_unpackhi_epi16 (a1, zero), _mm_unpackhi_epi16 (b1, zero)));
+  lo = _mm_srli_epi32 (_mm_add_epi32 (lo, two), 2);
+  hi = _mm_srli_epi32 (_mm_add_epi32 (hi, two), 2);
+
+  return (_mm_xor_si128 (_mm_packs_epi32 (_mm_sub_epi32 (lo, bias),
+					  _mm_sub_epi32 (hi, bias)),
+			 _mm_set1_epi16 ((short) 0x8000)));
+}
+
+
+/* pshufb mask moving 16 bit lanes l0-l7 of a vector to lanes 0-7, -1
+   clearing the lane */
+#define VL_PYRAMID_LANE(l) \
+  (char) (((l) < 0) ? -1 : 2*(l)), (char) (((l) < 0) ? -1 : 2*(l)+1)
+#define VL_PYRAMID_LANES(l0, l1, l2, l3, l4, l5, l6, l7) \
+  _mm_setr_epi8 (VL_PYRAMID_LANE (l0), VL_PYRAMID_LANE (l1), \
+		 VL_PYRAMID_LANE (l2), VL_PYRAMID_LANE (l3), \
+		 VL_PYRAMID_LANE (l4), VL_PYRAMID_LANE (l5), \
+		 VL_PYRAMID_LANE (l6), VL_PYRAMID_LANE (l7))
+
+/* RGB rows, 8 pixels at a time: the means of 48 consecutive values, of
+   which the 24 of the first pixels of the blocks are gathered into 3
+   vectors. The last loads read 3 values of the block of pixel i+8, which
+   must then be in the row. Returns the number of pixels done */
+VL_TARGET_SSSE3 static int
+_vlPyramidRowRgbSSSE3 (const vlPixel *r0, const vlPixel *r1, vlPixel *out,
+		       int width)
+{
+  int i;
+  __m128i t0, t1, t2, t3, t4, t5;
+
+  for (i=0; i+9<=width; i+=8, r0+=48, r1+=48, out+=24) {
+    t0 = _vlPyramidBinRgbSSE2 (r0, r1);		/* values 0-7 */
+    t1 = _vlPyramidBinRgbSSE2 (r0+8, r1+8);
+    t2 = _vlPyramidBinRgbSSE2 (r0+16, r1+16);
+    t3 = _vlPyramidBinRgbSSE2 (r0+24, r1+24);
+    t4 = _vlPyramidBinRgbSSE2 (r0+32, r1+32);
+    t5 = _vlPyramidBinRgbSSE2 (r0+40, r1+40);	/* values 40-47 */
+
+    /* values 0-2, 6-8, 12-14, 18-20, ... 42-44 */
+    _mm_storeu_si128 ((__m128i *) out,
+		      _mm_or_si128 (_mm_shuffle_epi8 (t0, VL_PYRAMID_LANES (0, 1, 2, 6, 7, -1, -1, -1)),
+				    _mm_shuffle_epi8 (t1, VL_PYRAMID_LANES (-1, -1, -1, -1, -1, 0, 4, 5))));
+    _mm_storeu_si128 ((__m128i *) (out+8),
+		      _mm_or_si128 (_mm_or_si128 (_mm_shuffle_epi8 (t1, VL_PYRAMID_LANES (6, -1, -1, -1, -1, -1, -1, -1)),
+						  _mm_shuffle_epi8 (t2, VL_PYRAMID_LANES (-1, 2, 3, 4, -1, -1, -1, -1))),
+				    _mm_shuffle_epi8 (t3, VL_PYRAMID_LANES (-1, -1, -1, -1, 0, 1, 2, 6))));
+    _mm_storeu_si128 ((__m128i *) (out+16),
+		      _mm_or_si128 (_mm_or_si128 (_mm_shuffle_epi8 (t3, VL_PYRAMID_LANES (7, -1, -1, -1, -1, -1, -1, -1)),
+						  _mm_shuffle_epi8 (t4, VL_PYRAMID_LANES (-1, 0, 4, 5, 6, -1, -1, -1))),
+				    _mm_shuffle_epi8 (t5, VL_PYRAMID_LANES (-1, -1, -1, -1, -1, 2, 3, 4))));
+  }
+
+  return (i);
+}
+
+
+VL_TARGET_AVX2 static int
+_vlPyramidRowAVX2 (const vlPixel *r0, const vlPixel *r1, vlPixel *out,
+		   int width)
+{
+  int i;
+  __m256i low = _mm256_set1_epi32 (0xFFFF);
+  __m256i two = _mm256_set1_epi32 (2);
+
+  for (i=0; i+16<=width; i+=16) {
+    __m256i a0 = _mm256_loadu_si256 ((const __m256i *) (r0+2*i));
+    __m256i a1 = _mm256_loadu_si256 ((const __m256i *) (r1+2*i));
+    __m256i b0 = _mm256_loadu_si256 ((const __m256i *) (r0+2*i+16));
+    __m256i b1 = _mm256_loadu_si256 ((const __m256i *) (r1+2*i+16));
+    __m256i a, b;
+
+    a = _mm256_add_epi32 (_mm256_add_epi32 (_mm256_and_si256 (a0, low), _mm256_srli_epi32 (a0, 16)),
+			  _mm256_add_epi32 (_mm256_and_si256 (a1, low), _mm256_srli_epi32 (a1, 16)));
+    b = _mm256_add_epi32 (_mm256_add_epi32 (_mm256_and_si256 (b0, low), _mm256_srli_epi32 (b0, 16)),
+			  _mm256_add_epi32 (_mm256_and_si256 (b1, low), _mm256_srli_epi32 (b1, 16)));
+    a = _mm256_srli_epi32 (_mm256_add_epi32 (a, two), 2);
+    b = _mm256_srli_epi32 (_mm256_add_epi32 (b, two), 2);
+
+    /* the pack works within 128 bit lanes: put the quads back in order */
+    _mm256_storeu_si256 ((__m256i *) (out+i),
+			 _mm256_permute4x64_epi64 (_mm256_packus_epi32 (a, b), 0xD8));
+  }
+
+  return (i);
+}
+#endif
+
+
+/* row of width pixels of n channels, each the rounded mean of a 2x2 block
+   of rows r0 and r1 (2*width pixels). simd is the vlCpu feature to use, 0
+   for the C code */
+static void
+_vlPyramidRow (const vlPixel *r0, const vlPixel *r1, vlPixel *out,
+	       int width, int n, int simd)
+{
+  int i = 0, c, k;
+
+#ifdef VL_X86
+  /* single channel (GRAY, BINARY) pictures: the pixels of a block are the
+     two halves of a 32 bit lane */
+  if (n == 1) {
+    if (simd & VL_CPU_AVX2) {
+      i = _vlPyramidRowAVX2 (r0, r1, out, width);
+    }
+    else if (simd & VL_CPU_SSE2) {
+      for (; i+8<=width; i+=8) {
+	_mm_storeu_si128 ((__m128i *) (out+i), _vlPyramidBinSSE2 (r0+2*i, r1+2*i));
+      }
+    }
+  }
+  else if ((n == 3) && (simd & VL_CPU_SSSE3)) {
+    i = _vlPyramidRowRgbSSSE3 (r0, r1, out, width);
+  }
+#endif
+
+  /* pixel i is the block of pixels 2i and 2i+1 */
+  for (; i<width; i++) {
+    k = 2*i*n;
+    for (c=0; c<n; c++) {
+      out[i*n+c] = (vlPixel) (((unsigned int) r0[k+c] + r0[k+n+c] +
+			       r1[k+c] + r1[k+n+c] + 2) >> 2);
+    }
+  }
+}
+
+
+/* make level an image of the given format and size, unless it is already */
+static int
+_vlPyramidLevelInit (vlImage *level, vlImageFormat format, int width,
+		     int height)
+{
+  if ((level->format == format) && (level->width == width) &&
+      (level->height == height)) {
+    return (0);
+  }
+  return (vlImageInit (level, format, width, height));
+}
+
+
+/******************************************************************************
+ *
+ * vlPyramidBuild --
+ *	make src level 0 of pyramid, and bin it into the other levels: each
+ *      pixel of level k is the rounded mean of a 2x2 block of level k-1,
+ *      channel by channel. All the levels are made in one pass over src,
+ *      a row of level k as soon as its two rows of level k-1 are done.
+ *      src is not copied, and must be kept as long as level 0 is used.
+ *
+ * RETURNS:
+ *   On success, 0 is returned. Otherwise, -1 (e.g. src is smaller than
+ *   2^levels pixels in a direction).
+ *
+ *****************************************************************************/
+int
+vlPyramidBuild (vlPyramid *pyramid, vlImage *src)
+{
+  int j, k, r, n, simd = 0;
+  int width, height;
+  vlImage *prev, *level;
+
+  /* verify parameters */
+  if ((!pyramid) || (!src)) {
+    VL_ERROR ("vlPyramidBuild: error: one of the parameters is NULL\n");
+    return (-1);		/* failure */
+  }
+
+  if (0 >= (n = vlPixelSize (src->format))) {
+    VL_ERROR ("vlPyramidBuild: error: unsupported image format\n");
+    return (-1);		/* failure */
+  }
+
+  if (((src->width >> (pyramid->levels-1)) <= 0) ||
+      ((src->height >> (pyramid->levels-1)) <= 0)) {
+    VL_ERROR ("vlPyramidBuild: error: src image is too small\n");
+    return (-1);		/* failure */
+  }
+
+  pyramid->level[0] = src;
+  width = src->width;
+  height = src->height;
+  for (k=1; k<pyramid->levels; k++) {
+    width /= 2;
+    height /= 2;
+    if (0 > _vlPyramidLevelInit (pyramid->level[k], src->format, width, height)) {
+      VL_ERROR ("vlPyramidBuild: error: could not initialize level\n");
+      return (-1);		/* failure */
+    }
+  }
+
+#ifdef VL_X86
+  simd = vlCpuFeatures () & (VL_CPU_AVX2 | VL_CPU_SSE2 | VL_CPU_SSSE3);
+#endif
+
+  level = pyramid->level[1];
+  for (j=0; j<level->height; j++) {
+    _vlPyramidRow (src->pixel + 2*j*src->width*n,
+		   src->pixel + (2*j+1)*src->width*n,
+		   level->pixel + j*level->width*n, level->width, n, simd);
+
+    /* every odd row r of level k-1 completes row r/2 of level k */
+    for (r=j, k=2; (k<pyramid->levels) && (r & 1); k++) {
+      r >>= 1;
+      prev = pyramid->level[k-1];
+      level = pyramid->level[k];
+      _vlPyramidRow (prev->pixel + 2*r*prev->width*n,
+		     prev->pixel + (2*r+1)*prev->width*n,
+		     level->pixel + r*level->width*n, level->width, n, simd);
+    }
+    level = pyramid->level[1];
+  }
+
+  return (0);			/* success */
+}
+
+
+/******************************************************************************
+ *
+ * vlPyramidWindow --
+ *	window of level 0 covering the window coarse of the given level,
+ *      grown by margin pixels (of level 0) on every side and clipped to
+ *      the picture.
+ *
+ * RETURNS:
+ *   On success, 0 is returned. Otherwise, -1.
+ *
+ *****************************************************************************/
+int
+vlPyramidWindow (vlPyramid *pyramid, int level, vlWindow *coarse,
+		 int margin, vlWindow *fine)
+{
+  int x1, x2, y1, y2;
+
+  /* verify parameters */
+  if ((!pyramid) || (!pyramid->level[0]) || (level < 0) ||
+      (level >= pyramid->levels) || (!coarse) || (!fine)) {
+    VL_ERROR ("vlPyramidWindow: error: illegal parameter\n");
+    return (-1);		/* failure */
+  }
+
+  x1 = (coarse->x << level) - margin;
+  y1 = (coarse->y << level) - margin;
+  x2 = ((coarse->x + coarse->width) << level) + margin;
+  y2 = ((coarse->y + coarse->height) << level) + margin;
+
+  x1 = VL_MAX(x1,0);
+  y1 = VL_MAX(y1,0);
+  x2 = VL_MIN(x2,pyramid->level[0]->width);
+  y2 = VL_MIN(y2,pyramid->level[0]->height);
+
+  fine->x = x1;
+  fine->y = y1;
+  fine->width = VL_MAX(x2-x1,0);
+  fine->height = VL_MAX(y2-y1,0);
+
+  return (0);			/* success */
+}
+
+
+/* object covering the pixels of object binned level times: every row of
+   coarse covers the span of the 2^level rows it bins */
+static vlObject *
+_vlPyramidObject (vlObject *object, int level)
+{
+  int i, j, r, f, x1, x2;
+  int width, height;
+  vlObject *coarse;
+
+  f = 1 << level;
+  width = (object->width + f-1) >> level;
+  height = (object->height + f-1) >> level;
+  if (NULL == (coarse = vlObjectCreate (0, 0, width, height))) {
+    return (NULL);
+  }
+
+  for (r=0; r<height; r++) {
+    x1 = object->width;
+    x2 = 0;
+    for (j=r*f; (j<(r+1)*f) && (j<object->height); j++) {
+      if (object->x_length[j] > 0) {
+	i = object->x_offset[j] + object->x_length[j];
+	x1 = VL_MIN(x1,object->x_offset[j]);
+	x2 = VL_MAX(x2,i);
+      }
+    }
+    if (x1 < x2) {
+      coarse->x_offset[r] = x1 >> level;
+      coarse->x_length[r] = ((x2 + f-1) >> level) - (x1 >> level);
+    }
+    else {
+      coarse->x_offset[r] = 0;
+      coarse->x_length[r] = 0;
+    }
+  }
+
+  return (coarse);
+}
+
+
+/* position of coarse within search of pic (a binned BINARY picture) where
+   the sum of the pixels under it is the largest, the first one if equal.
+   The pixels are the densities of set pixels in their blocks, where
+   vlMatchShape would only count the non zero ones, which most blocks of a
+   noisy picture are at level 3. Sums over the spans of the object come
+   from the running sums along the rows. */
+static int
+_vlPyramidMatch (vlImage *pic, vlObject *coarse, vlWindow *search)
+{
+  int i, j, k, row, col;
+  int width, rowSize;
+  unsigned int sum, maxSum;
+  unsigned int *rows, *r;
+  const vlPixel *pixel;
+
+  width = pic->width;
+  rowSize = width+1;
+  rows = (unsigned int *) malloc (rowSize * coarse->height * sizeof(unsigned int));
+  if (!rows) {
+    VL_ERROR ("vlMatchShapePyramid: malloc failed\n");
+    return (-1);		/* failure */
+  }
+
+  maxSum = 0;
+  coarse->x = search->x;
+  coarse->y = search->y;
+  for (row=search->y; row<search->y+search->height-coarse->height; row++) {
+    /* running sums of the rows under the object, kept from the row above */
+    for (j=(row == search->y) ? 0 : coarse->height-1; j<coarse->height; j++) {
+      r = rows + ((row+j) % coarse->height)*rowSize;
+      pixel = pic->pixel + (row+j)*width;
+      r[0] = 0;
+      for (i=0; i<width; i++) {
+	r[i+1] = r[i] + pixel[i];
+      }
+    }
+
+    for (col=search->x; col<search->x+search->width-coarse->width; col++) {
+      sum = 0;
+      for (k=0; k<coarse->height; k++) {
+	r = rows + ((row+k) % coarse->height)*rowSize + col + coarse->x_offset[k];
+	sum += r[coarse->x_length[k]] - r[0];
+      }
+      if (sum > maxSum) {
+	maxSum = sum;
+	coarse->x = col;
+	coarse->y = row;
+      }
+    }
+  }
+
+  free (rows);
+  return (0);			/* success */
+}
+
+
+/******************************************************************************
+ *
+ * vlMatchShapePyramid --
+ *	vlMatchShape of the BINARY picture of pyramid, coarse to fine: the
+ *      shape, binned as the picture, is searched over window at the given
+ *      level, which covers 4^level times fewer positions, then the best
+ *      match is refined at level 0 within 2^level pixels around it. At
+ *      the coarse level, positions are ranked by the density of set pixels
+ *      under the shape rather than by the count of non zero pixels.
+ *
+ * RETURNS:
+ *   As vlMatchShape: the percentage of the object matched at object->x,
+ *   object->y, or a negative value on error. With level 0 (or a window too
+ *   small for the shape at level), this is vlMatchShape at level 0.
+ *
+ *****************************************************************************/
+int
+vlMatchShapePyramid (vlPyramid *pyramid, int level, vlObject *object,
+		     vlWindow *window)
+{
+  int f, x, y, x2, y2, status;
+  vlImage *pic;
+  vlObject *coarse;
+  vlWindow search, fine;
+
+  /* verify parameters */
+  if ((!pyramid) || (!pyramid->level[0]) || (level < 0) ||
+      (level >= pyramid->levels) || (!object) || (!window)) {
+    VL_ERROR ("vlMatchShapePyramid: error: illegal parameter\n");
+    return (-1);		/* failure */
+  }
+
+  pic = pyramid->level[level];
+  if ((level == 0) || (pic->format != BINARY)) {
+    return (vlMatchShape (pyramid->level[0], object, window));
+  }
+
+  /* the coarse window covers window, clipped to the level */
+  f = 1 << level;
+  x = window->x >> level;
+  y = window->y >> level;
+  x2 = (window->x + window->width + f-1) >> level;
+  y2 = (window->y + window->height + f-1) >> level;
+  x2 = VL_MIN(x2,pic->width);
+  y2 = VL_MIN(y2,pic->height);
+  search.x = x;
+  search.y = y;
+  search.width = x2 - x;
+  search.height = y2 - y;
+
+  if (NULL == (coarse = _vlPyramidObject (object, level))) {
+    return (-1);		/* failure */
+  }
+
+  if ((search.width <= coarse->width) || (search.height <= coarse->height)) {
+    vlObjectDestroy (coarse);
+    return (vlMatchShape (pyramid->level[0], object, window));
+  }
+
+  status = _vlPyramidMatch (pic, coarse, &search);
+  x = coarse->x << level;
+  y = coarse->y << level;
+  vlObjectDestroy (coarse);
+  if (status < 0) {
+    return (status);		/* failure */
+  }
+
+  /* keep the match a position of window, then search f pixels around it */
+  x2 = window->x + window->width - object->width - 1;
+  y2 = window->y + window->height - object->height - 1;
+  x = VL_MIN(x,x2);
+  y = VL_MIN(y,y2);
+  x = VL_MAX(x,window->x);
+  y = VL_MAX(y,window->y);
+
+  fine.x = VL_MAX(x-f,window->x);
+  fine.y = VL_MAX(y-f,window->y);
+  x2 = VL_MIN(x+f,x2);
+  y2 = VL_MIN(y+f,y2);
+  fine.width = x2 - fine.x + 1 + object->width;
+  fine.height = y2 - fine.y + 1 + object->height;
+
+  return (vlMatchShape (pyramid->level[0], object, &fine));
+}
+
+
+/* mark in pyramid->mask the pixels of pic (level of pyramid) that belong
+   to a blob of at least minArea pixels once times 4^level, the blobs
+   being the 8-connected pixels below 255 (pic is a BINARY picture of 0
+   and 255 binned at most 3 times, so these are the blocks holding a 0).
+   The blobs reaching the last block column (row) when the width (height)
+   of level 0 is not a multiple of 2^level are marked whatever their area:
+   their level 0 blob may go on in the pixels past the last block, which
+   pic does not hold. labeler is used for the labeling of pic */
+static int
+_vlPyramidMask (vlPyramid *pyramid, int level, vlLabeler *labeler,
+		int minArea)
+{
+  int i, j, x, x1, n;
+  int lastCol, lastRow;
+  vlImage *pic = pyramid->level[level];
+  unsigned char *mask;
+  const vlPixel *row;
+  const blob *b;
+  vlRun *run;
+
+  if (pyramid->maskSize < pic->width*pic->height) {
+    if (NULL == (mask = (unsigned char *) realloc (pyramid->mask,
+						   pic->width*pic->height))) {
+      VL_ERROR ("vlFindLargestBlobsPyramid: realloc failed\n");
+      return (-1);		/* failure */
+    }
+    pyramid->mask = mask;
+    pyramid->maskSize = pic->width*pic->height;
+  }
+
+  n = vlLabelerStart (labeler, pic->width, pic->height);
+  for (j=0; (n >= 0) && (j<pic->height); j++) {
+    row = pic->pixel + j*pic->width;
+    x = 0;
+    while (x < pic->width) {
+      while ((x < pic->width) && (row[x] >= 255)) {
+	x++;
+      }
+      if (x == pic->width) {
+	break;
+      }
+      x1 = x;
+      while ((x < pic->width) && (row[x] < 255)) {
+	x++;
+      }
+      if (0 > vlLabelerAddRun (labeler, j, x1, x)) {
+	n = -1;
+	break;
+      }
+    }
+  }
+  if (n >= 0) {
+    n = vlLabelerFinish (labeler);
+  }
+  if (n < 0) {
+    return (-1);		/* failure */
+  }
+
+  /* a blob of level 0 within the blocks covers at least area/4^level
+     blocks, all of them in one blob of pic; one that also has pixels past
+     the last block may be split among several blobs of pic, all of them
+     reaching the last block column or row (-1 if there are none past it) */
+  lastCol = -1;
+  if ((pic->width << level) < pyramid->level[0]->width) {
+    lastCol = pic->width-1;
+  }
+  lastRow = -1;
+  if ((pic->height << level) < pyramid->level[0]->height) {
+    lastRow = pic->height-1;
+  }
+
+  memset (pyramid->mask, 0, pic->width*pic->height);
+  for (i=0, run=labeler->runs; i<labeler->numRuns; i++, run++) {
+    b = labeler->blobs + run->label;
+    if ((b->ymax == lastCol) || (b->xmax == lastRow) ||
+	(((double) b->area * (1 << 2*level)) >= minArea)) {
+      memset (pyramid->mask + run->y*pic->width + run->x1, 1, run->x2 - run->x1);
+    }
+  }
+
+  return (0);			/* success */
+}
+
+
+/******************************************************************************
+ *
+ * vlFindLargestBlobsPyramid --
+ *	vlFindLargestBlobs of the BINARY picture of pyramid, coarse to fine:
+ *      the blocks holding a foreground pixel are labeled at the given
+ *      level first, and only the ones of blobs large enough for minArea
+ *      pixels are labeled again at level 0. Isolated specks and small
+ *      blobs are then skipped at level 0, while every blob of minArea
+ *      pixels is found whole. The rows and columns past the last block,
+ *      when the size is not a multiple of 2^level, are labeled as they
+ *      are, along with every blob of blocks reaching them, so the result
+ *      is the one of vlFindLargestBlobs. It pays on sparse pictures:
+ *      when most blocks hold a foreground pixel, the coarse pass is extra
+ *      work. labeler may be NULL.
+ *
+ * RETURNS:
+ *   As vlFindLargestBlobs: the number of blobs in out, or -1 on failure.
+ *   With level 0, this is vlFindLargestBlobs of level 0.
+ *
+ *****************************************************************************/
+int
+vlFindLargestBlobsPyramid (vlLabeler *labeler, vlPyramid *pyramid, int level,
+			   int k, int minArea, blob *out)
+{
+  int j, x, x1, c, n;
+  int width, cols;
+  vlImage *pic;
+  const vlPixel *row;
+  const unsigned char *keep;
+  vlLabeler *temp = NULL;
+
+  /* verify parameters */
+  if ((!pyramid) || (!pyramid->level[0]) || (level < 0) ||
+      (level >= pyramid->levels) || (k <= 0) || (!out)) {
+    VL_ERROR ("vlFindLargestBlobsPyramid: error: illegal parameter\n");
+    return (-1);		/* failure */
+  }
+
+  pic = pyramid->level[0];
+  if ((level == 0) || (pic->format != BINARY)) {
+    return (vlFindLargestBlobs (labeler, pic, k, minArea, out));
+  }
+
+  if (!labeler) {
+    if (NULL == (labeler = temp = vlLabelerCreate ())) {
+      return (-1);		/* failure */
+    }
+  }
+
+  n = _vlPyramidMask (pyramid, level, labeler, minArea);
+  if (n >= 0) {
+    n = vlLabelerStartLargest (labeler, pic->width, pic->height, k, minArea,
+			       out);
+  }
+
+  /* runs of foreground pixels within the kept blocks; the pixels past the
+     last block of a row or column are all kept */
+  width = pic->width;
+  cols = pyramid->level[level]->width;
+  for (j=0; (n >= 0) && (j<pic->height); j++) {
+    row = pic->pixel + j*width;
+    keep = NULL;
+    if ((j >> level) < pyramid->level[level]->height) {
+      keep = pyramid->mask + (j >> level)*cols;
+    }
+
+    x = 0;
+    while (x < width) {
+      /* skip background, and whole blocks out of the mask */
+      while (x < width) {
+	c = x >> level;
+	if (keep && (c < cols) && (!keep[c])) {
+	  x = (c+1) << level;
+	}
+	else if (row[x] != 0) {
+	  x++;
+	}
+	else {
+	  break;
+	}
+      }
+      if (x >= width) {
+	break;
+      }
+
+      x1 = x;
+      while ((x < width) && (row[x] == 0) &&
+	     ((!keep) || ((x >> level) >= cols) || keep[x >> level])) {
+	x++;
+      }
+      if (0 > vlLabelerAddRun (labeler, j, x1, x)) {
+	n = -1;
+	break;
+      }
+    }
+  }
+  if (n >= 0) {
+    n = vlLabelerFinish (labeler);
+  }
+
+  labeler->stream = FALSE;
+  labeler->out = NULL;
+  if (temp) {
+    vlLabelerDestroy (temp);
+  }
+
+  return (n);
+}
@@ -0,0 +1,913 @@
+/*****************************************************************************
+ *
+ * FILE:     rle.cpp
+ *
+ * ABSTRACT: run-length encoded binary images. One ball or one floor line
+ *           takes a few spans per row; thresholding, erosion/dilation and
+ *           labeling walk the spans without ever building a dense mask.
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vislib.h"
+#include "vlRle.h"
+
+
+/* make room for n spans */
+static int
+_vlRleReserve (vlRleImage *image, int n)
+{
+  int max;
+  vlSpan *spans;
+
+  if (n <= image->maxSpans) {
+    return (0);
+  }
+
+  max = (VL_MAX (2*image->maxSpans, n));
+  if (NULL == (spans = (vlSpan *) realloc (image->spans,
+					   max * sizeof(vlSpan)))) {
+    VL_ERROR ("vlRle: malloc failed\n");
+    return (-1);		/* failure */
+  }
+  image->spans = spans;
+  image->maxSpans = max;
+
+  return (0);			/* success */
+}
+
+
+/* append [x1,x2) to the row starting at span first. Spans come sorted by
+   x1, a span touching the last one of the row is merged into it */
+static int
+_vlRleAppend (vlRleImage *image, int first, int x1, int x2)
+{
+  vlSpan *last;
+
+  if (x1 >= x2) {
+    return (0);
+  }
+
+  if (image->numSpans > first) {
+    last = image->spans + image->numSpans-1;
+    if (x1 <= last->x2) {
+      if (x2 > last->x2) last->x2 = x2;
+      return (0);
+    }
+  }
+
+  if (0 > _vlRleReserve (image, image->numSpans+1)) {
+    return (-1);		/* failure */
+  }
+  image->spans[image->numSpans].x1 = x1;
+  image->spans[image->numSpans].x2 = x2;
+  image->numSpans++;
+
+  return (0);			/* success */
+}
+
+
+/* pixel x of a scanned row is (not) set: open or close the current span */
+static int
+_vlRleScan (vlRleImage *image, int first, int *start, int x, int set)
+{
+  if (set) {
+    if (*start < 0) *start = x;
+    return (0);
+  }
+  if (*start >= 0) {
+    if (0 > _vlRleAppend (image, first, *start, x)) {
+      return (-1);		/* failure */
+    }
+    *start = -1;
+  }
+
+  return (0);
+}
+
+
+static void
+_vlRleSwap (vlRleImage *a, vlRleImage *b)
+{
+  vlRleImage temp;
+
+  temp = *a;
+  *a = *b;
+  *b = temp;
+}
+
+
+vlRleImage *
+vlRleCreate (int width, int height)
+{
+  vlRleImage *image;
+
+  if (NULL == (image = (vlRleImage *) calloc (1, sizeof(vlRleImage)))) {
+    VL_ERROR ("vlRleCreate: malloc failed\n");
+    return (NULL);
+  }
+
+  if (0 > vlRleInit (image, width, height)) {
+    vlRleDestroy (image);
+    return (NULL);
+  }
+
+  return (image);
+}
+
+
+void
+vlRleDestroy (vlRleImage *image)
+{
+  if (image) {
+    VL_FREE (image->rows);
+    VL_FREE (image->spans);
+    VL_FREE (image);
+  }
+}
+
+
+/* (re)initialize an existing RLE image, all pixels cleared. The buffers
+   are kept, and only grow */
+int
+vlRleInit (vlRleImage *image, int width, int height)
+{
+  int *rows;
+
+  if ((!image) || (width < 0) || (height < 0)) {
+    VL_ERROR ("vlRleInit: error: illegal parameter\n");
+    return (-1);		/* failure */
+  }
+
+  if (height+1 > image->maxRows) {
+    if (NULL == (rows = (int *) realloc (image->rows,
+					 (height+1) * sizeof(int)))) {
+      VL_ERROR ("vlRleInit: malloc failed\n");
+      return (-1);		/* failure */
+    }
+    image->rows = rows;
+    image->maxRows = height+1;
+  }
+
+  image->width = width;
+  image->height = height;
+  image->numSpans = 0;
+  memset (image->rows, 0, (height+1) * sizeof(int));
+
+  return (0);			/* success */
+}
+
+
+int
+vlRleCopy (vlRleImage *src, vlRleImage *dest)
+{
+  if ((!src) || (!dest)) {
+    VL_ERROR ("vlRleCopy: error: NULL image\n");
+    return (-1);		/* failure */
+  }
+  if (src == dest) {
+    return (0);
+  }
+
+  if ((0 > vlRleInit (dest, src->width, src->height)) ||
+      (0 > _vlRleReserve (dest, src->numSpans))) {
+    return (-1);		/* failure */
+  }
+  memcpy (dest->rows, src->rows, (src->height+1) * sizeof(int));
+  memcpy (dest->spans, src->spans, src->numSpans * sizeof(vlSpan));
+  dest->numSpans = src->numSpans;
+
+  return (0);			/* success */
+}
+
+
+/* ---------------------------------------------------------
+   conversions
+   --------------------------------------------------------- */
+
+/* given a BINARY picture, return the RLE one */
+int
+vlBinary2Rle (vlImage *src, vlRleImage *dest)
+{
+  int i, j, start;
+  vlPixel *input;
+
+  if ((!src) || (!dest)) {
+    VL_ERROR ("vlBinary2Rle: error: one of the parameters is NULL\n");
+    return (-1);		/* failure */
+  }
+
+  if (src->format != BINARY) {
+    VL_ERROR ("vlBinary2Rle: error: src image is not BINARY\n");
+    return (-1);		/* failure */
+  }
+
+  if (0 > vlRleInit (dest, src->width, src->height)) {
+    return (-1);		/* failure */
+  }
+
+  input = src->pixel;
+  for (j=0; j<src->height; j++) {
+    dest->rows[j] = dest->numSpans;
+    start = -1;
+    for (i=0; i<src->width; i++) {
+      if (0 > _vlRleScan (dest, dest->rows[j], &start, i, *input++ != 0)) {
+	return (-1);		/* failure */
+      }
+    }
+    if (0 > _vlRleScan (dest, dest->rows[j], &start, i, FALSE)) {
+      return (-1);		/* failure */
+    }
+  }
+  dest->rows[src->height] = dest->numSpans;
+
+  return (0);			/* success */
+}
+
+
+/* given a RLE picture, return the BINARY (0/255) one */
+int
+vlRle2Binary (vlRleImage *src, vlImage *dest)
+{
+  int j, k, x;
+  vlPixel *row;
+  vlSpan *span;
+
+  if ((!src) || (!dest)) {
+    VL_ERROR ("vlRle2Binary: error: one of the parameters is NULL\n");
+    return (-1);		/* failure */
+  }
+
+  if (0 > vlImageInit (dest, BINARY, src->width, src->height)) {
+    VL_ERROR ("vlRle2Binary: error: could not initialize dest image\n");
+    return (-1);		/* failure */
+  }
+
+  memset (dest->pixel, 0, VL_BINARY_SIZE (src->width, src->height));
+  for (j=0; j<src->height; j++) {
+    row = dest->pixel + j*src->width;
+    for (k=src->rows[j], span=src->spans+k; k<src->rows[j+1]; k++, span++) {
+      for (x=span->x1; x<span->x2; x++) {
+	row[x] = 255;
+      }
+    }
+  }
+
+  return (0);			/* success */
+}
+
+
+/* same thresholds as vlBinary: set where the pixel is OUT of the HSI box.
+   Rows are thresholded by vlBinaryRow, then scanned into spans */
+int
+vlBinaryRle (vlImage *src, vlHSI_carl_tol_t *para, vlRleImage *dest)
+{
+  int i, j, start;
+  int status = 0;
+  vlPixel *hsi, *bin;
+
+  if ((!src) || (!para) || (!dest)) {
+    VL_ERROR ("vlBinaryRle: error: one of the parameters is NULL\n");
+    return (-1);		/* failure */
+  }
+
+  if (src->format != RGB) {
+    VL_ERROR ("vlBinaryRle: src image is not RGB\n");
+    return (-1);		/* failure */
+  }
+
+  if (0 > vlRleInit (dest, src->width, src->height)) {
+    return (-1);		/* failure */
+  }
+
+  /* a HSI row and a BINARY row */
+  hsi = (vlPixel *) malloc (VL_HSI_SIZE (src->width, 1) +
+			    VL_BINARY_SIZE (src->width, 1));
+  if (!hsi) {
+    VL_ERROR ("vlBinaryRle: malloc failed\n");
+    return (-1);		/* failure */
+  }
+  bin = hsi + VL_HSI_PIXEL*src->width;
+
+  for (j=0; (status >= 0) && (j<src->height); j++) {
+    vlBinaryRow (src->pixel + VL_RGB_PIXEL*j*src->width, para, src->width,
+		 hsi, bin);
+    dest->rows[j] = dest->numSpans;
+    start = -1;
+    for (i=0; (status >= 0) && (i<src->width); i++) {
+      status = _vlRleScan (dest, dest->rows[j], &start, i, bin[i] != 0);
+    }
+    if (status >= 0) {
+      status = _vlRleScan (dest, dest->rows[j], &start, i, FALSE);
+    }
+  }
+  dest->rows[src->height] = dest->numSpans;
+
+  VL_FREE (hsi);
+
+  return (status);
+}
+
+
+/* same as vlRgbFilter: set where the pixel is within the object colors.
+   Pixels outside window are cleared */
+int
+vlRgbFilterRle (vlImage *src, vlObject *object, vlWindow *window,
+		vlRleImage *dest)
+{
+  int i, j, start;
+  int x1, x2, y1, y2;
+  vlPixel *input;
+
+  if ((!src) || (!object) || (!window) || (!dest)) {
+    VL_ERROR ("vlRgbFilterRle: error: one of the parameters is NULL\n");
+    return (-1);		/* failure */
+  }
+
+  if (src->format != RGB) {
+    VL_ERROR ("vlRgbFilterRle: error: src image is not RGB\n");
+    return (-1);		/* failure */
+  }
+
+  if (0 > vlRleInit (dest, src->width, src->height)) {
+    return (-1);		/* failure */
+  }
+
+  x1 = window->x;
+  x2 = x1 + (window->width);
+  y1 = window->y;
+  y2 = y1 + (window->height);
+
+  for (j=0; j<src->height; j++) {
+    dest->rows[j] = dest->numSpans;
+    if ((j < y1) || (j >= y2)) {
+      continue;
+    }
+    start = -1;
+    input = src->pixel + VL_RGB_PIXEL*(j*src->width + x1);
+    for (i=x1; i<x2; i++, input+=VL_RGB_PIXEL) {
+      if (0 > _vlRleScan (dest, dest->rows[j], &start, i,
+			  (input[0] >= object->r_min) &&
+			  (input[0] <= object->r_max) &&
+			  (input[1] >= object->g_min) &&
+			  (input[1] <= object->g_max) &&
+			  (input[2] >= object->b_min) &&
+			  (input[2] <= object->b_max))) {
+	return (-1);		/* failure */
+      }
+    }
+    if (0 > _vlRleScan (dest, dest->rows[j], &start, x2, FALSE)) {
+      return (-1);		/* failure */
+    }
+  }
+  dest->rows[src->height] = dest->numSpans;
+
+  return (0);			/* success */
+}
+
+
+/* same as vlNrgFilter: set where the pixel is within the object colors.
+   Pixels outside window are cleared */
+int
+vlNrgFilterRle (vlImage *src, vlObject *object, vlWindow *window,
+		vlRleImage *dest)
+{
+  int i, j, start;
+  int x1, x2, y1, y2;
+  vlPixel *input;
+
+  if ((!src) || (!object) || (!window) || (!dest)) {
+    VL_ERROR ("vlNrgFilterRle: error: one of the parameters is NULL\n");
+    return (-1);		/* failure */
+  }
+
+  if (src->format != NRG) {
+    VL_ERROR ("vlNrgFilterRle: error: src image is not NRG\n");
+    return (-1);		/* failure */
+  }
+
+  if (0 > vlRleInit (dest, src->width, src->height)) {
+    return (-1);		/* failure */
+  }
+
+  x1 = window->x;
+  x2 = x1 + (window->width);
+  y1 = window->y;
+  y2 = y1 + (window->height);
+
+  for (j=0; j<src->height; j++) {
+    dest->rows[j] = dest->numSpans;
+    if ((j < y1) || (j >= y2)) {
+      continue;
+    }
+    start = -1;
+    input = src->pixel + VL_NRG_PIXEL*(j*src->width + x1);
+    for (i=x1; i<x2; i++, input+=VL_NRG_PIXEL) {
+      if (0 > _vlRleScan (dest, dest->rows[j], &start, i,
+			  (input[0] >= object->nr_min) &&
+			  (input[0] <= object->nr_max) &&
+			  (input[1] >= object->ng_min) &&
+			  (input[1] <= object->ng_max))) {
+	return (-1);		/* failure */
+      }
+    }
+    if (0 > _vlRleScan (dest, dest->rows[j], &start, x2, FALSE)) {
+      return (-1);		/* failure */
+    }
+  }
+  dest->rows[src->height] = dest->numSpans;
+
+  return (0);			/* success */
+}
+
+
+/* same as vlHsiFilter: set where the pixel is within the object colors.
+   Pixels outside window are cleared */
+int
+vlHsiFilterRle (vlImage *src, vlObject *object, vlWindow *window,
+		vlRleImage *dest)
+{
+  int i, j, start;
+  int x1, x2, y1, y2;
+  vlPixel *input;
+
+  if ((!src) || (!object) || (!window) || (!dest)) {
+    VL_ERROR ("vlHsiFilterRle: error: one of the parameters is NULL\n");
+    return (-1);		/* failure */
+  }
+
+  if (src->format != HSI) {
+    VL_ERROR ("vlHsiFilterRle: error: src image is not HSI\n");
+    return (-1);		/* failure */
+  }
+
+  if (0 > vlRleInit (dest, src->width, src->height)) {
+    return (-1);		/* failure */
+  }
+
+  x1 = window->x;
+  x2 = x1 + (window->width);
+  y1 = window->y;
+  y2 = y1 + (window->height);
+
+  for (j=0; j<src->height; j++) {
+    dest->rows[j] = dest->numSpans;
+    if ((j < y1) || (j >= y2)) {
+      continue;
+    }
+    start = -1;
+    input = src->pixel + VL_HSI_PIXEL*(j*src->width + x1);
+    for (i=x1; i<x2; i++, input+=VL_HSI_PIXEL) {
+      if (0 > _vlRleScan (dest, dest->rows[j], &start, i,
+			  (input[0] >= object->h_min) &&
+			  (input[0] <= object->h_max) &&
+			  (input[1] >= object->s_min) &&
+			  (input[1] <= object->s_max) &&
+			  (input[2] >= object->i_min) &&
+			  (input[2] <= object->i_max))) {
+	return (-1);		/* failure */
+      }
+    }
+    if (0 > _vlRleScan (dest, dest->rows[j], &start, x2, FALSE)) {
+      return (-1);		/* failure */
+    }
+  }
+  dest->rows[src->height] = dest->numSpans;
+
+  return (0);			/* success */
+}
+
+
+/* -----------------------------------------------------------
+   MORPHOLOGY
+   ----------------------------------------------------------- */
+
+/* horizontal spread of the source pixels of row j: the set (dilate) or
+   clear (erode) pixels within [x1,x2), each widened to [x+s1,x+s2-1] */
+static int
+_vlRleSpreadRow (vlRleImage *src, int j, int x1, int x2, int s1, int s2,
+		 int dilate, vlRleImage *spread)
+{
+  int k, x, a, b;
+  int first = spread->numSpans;
+  vlSpan *span;
+
+  x = x1;
+  for (k=src->rows[j], span=src->spans+k; k<src->rows[j+1]; k++, span++) {
+    if (span->x2 <= x1) continue;
+    if (span->x1 >= x2) break;
+    if (dilate) {
+      a = (span->x1 > x1) ? span->x1 : x1;
+      b = (span->x2 < x2) ? span->x2 : x2;
+    }
+    else {
+      a = x;
+      b = (span->x1 < x2) ? span->x1 : x2;
+      x = span->x2;
+    }
+    if ((a < b) && (0 > _vlRleAppend (spread, first, a+s1, b+s2-1))) {
+      return (-1);		/* failure */
+    }
+  }
+  if ((!dilate) && (x < x2) &&
+      (0 > _vlRleAppend (spread, first, x+s1, x2+s2-1))) {
+    return (-1);		/* failure */
+  }
+
+  return (0);			/* success */
+}
+
+
+/* union of the n span lists [head[i],end[i]) of spread, into acc */
+static int
+_vlRleUnion (vlRleImage *spread, int *head, int *end, int n, vlRleImage *acc)
+{
+  int i, best;
+  vlSpan *span;
+
+  acc->numSpans = 0;
+  for (;;) {
+    best = -1;
+    for (i=0; i<n; i++) {
+      if ((head[i] < end[i]) &&
+	  ((best < 0) ||
+	   (spread->spans[head[i]].x1 < spread->spans[head[best]].x1))) {
+	best = i;
+      }
+    }
+    if (best < 0) {
+      return (0);
+    }
+    span = spread->spans + head[best]++;
+    if (0 > _vlRleAppend (acc, 0, span->x1, span->x2)) {
+      return (-1);		/* failure */
+    }
+  }
+}
+
+
+/* row j of out: row j of src with acc set (dilate) or cleared (erode) */
+static int
+_vlRleCombineRow (vlRleImage *src, int j, vlRleImage *acc, int dilate,
+		  vlRleImage *out)
+{
+  int k, i, l, x;
+  int first = out->numSpans;
+  vlSpan *span, *other;
+
+  k = src->rows[j];
+  i = 0;
+
+  /* merge both lists */
+  if (dilate) {
+    while ((k < src->rows[j+1]) || (i < acc->numSpans)) {
+      if ((i == acc->numSpans) ||
+	  ((k < src->rows[j+1]) && (src->spans[k].x1 < acc->spans[i].x1))) {
+	span = src->spans + k++;
+      }
+      else {
+	span = acc->spans + i++;
+      }
+      if (0 > _vlRleAppend (out, first, span->x1, span->x2)) {
+	return (-1);		/* failure */
+      }
+    }
+    return (0);
+  }
+
+  /* cut the acc spans out of every src span */
+  for (; k<src->rows[j+1]; k++) {
+    span = src->spans + k;
+    x = span->x1;
+    while ((i < acc->numSpans) && (acc->spans[i].x2 <= x)) i++;
+    for (l=i, other=acc->spans+i; (l < acc->numSpans) && (other->x1 < span->x2);
+	 l++, other++) {
+      if ((other->x1 > x) && (0 > _vlRleAppend (out, first, x, other->x1))) {
+	return (-1);		/* failure */
+      }
+      if (other->x2 > x) x = other->x2;
+    }
+    if ((x < span->x2) && (0 > _vlRleAppend (out, first, x, span->x2))) {
+      return (-1);		/* failure */
+    }
+  }
+
+  return (0);			/* success */
+}
+
+
+vlRleScratch *
+vlRleScratchCreate (void)
+{
+  vlRleScratch *scratch;
+
+  if (NULL == (scratch = (vlRleScratch *) calloc (1, sizeof(vlRleScratch)))) {
+    VL_ERROR ("vlRleScratchCreate: malloc failed\n");
+    return (NULL);
+  }
+
+  return (scratch);
+}
+
+
+/* free the buffers of scratch, not scratch itself */
+static void
+_vlRleScratchFree (vlRleScratch *scratch)
+{
+  VL_FREE (scratch->spread.rows);
+  VL_FREE (scratch->spread.spans);
+  VL_FREE (scratch->acc.rows);
+  VL_FREE (scratch->acc.spans);
+  VL_FREE (scratch->out.rows);
+  VL_FREE (scratch->out.spans);
+  VL_FREE (scratch->head);
+}
+
+
+void
+vlRleScratchDestroy (vlRleScratch *scratch)
+{
+  if (scratch) {
+    _vlRleScratchFree (scratch);
+    VL_FREE (scratch);
+  }
+}
+
+
+/* vlBinaryErode clears the size x size square [s1,s2) around every clear
+   pixel of the source area, vlBinaryDilate sets it around every set pixel.
+   As for the packed images, the square is separable: the source spans of
+   each row are widened, then row j gets the union of the widened rows
+   j-o, o in [s1,s2), which is set into or cut out of it. The images and
+   cursors are those of scratch, which only grow */
+static int
+_vlRleMorph (vlRleImage *src, int size, vlWindow *window,
+	     vlRleImage *dest, int dilate, vlRleScratch *scratch,
+	     const char *name)
+{
+  int j, o, n, r;
+  int x1, x2, y1, y2;
+  int s1, s2;
+  int width, height;
+  int status = 0;
+  int *head, *end;
+  vlRleImage *spread, *acc, *out;
+
+  /* verify parameters */
+  if ((!src) || (size <= 0) || (!window) || (!dest) || (!scratch)) {
+    VL_ERROR ("%s: error: illegal parameter\n", name);
+    return (-1);		/* failure */
+  }
+
+  /* same source area as vlBinaryErode/vlBinaryDilate */
+  width = src->width;
+  height = src->height;
+  s2 = size/2;
+  s1 = -(size-s2);
+  x1 = (window->x-s1 > -s1) ? window->x-s1 : -s1;
+  x2 = (window->x+window->width < width-s2) ? window->x+window->width : width-s2;
+  y1 = (window->y-s1 > -s1) ? window->y-s1 : -s1;
+  y2 = (window->y+window->height < height-s2) ? window->y+window->height : height-s2;
+  if ((x1 >= x2) || (y1 >= y2)) {
+    return (vlRleCopy (src, dest));	/* nothing to do */
+  }
+
+  spread = &scratch->spread;
+  acc = &scratch->acc;
+  out = &scratch->out;
+  if (size > scratch->size) {
+    VL_FREE (scratch->head);
+    scratch->size = 0;
+    if (NULL == (scratch->head = (int *) malloc (2 * size * sizeof(int)))) {
+      VL_ERROR ("%s: malloc failed\n", name);
+      return (-1);		/* failure */
+    }
+    scratch->size = size;
+  }
+  head = scratch->head;
+  end = head + size;
+  if ((0 > vlRleInit (spread, width, y2-y1)) ||
+      (0 > vlRleInit (acc, width, 1)) ||
+      (0 > vlRleInit (out, width, height))) {
+    return (-1);		/* failure */
+  }
+
+  /* horizontal spread of the source rows [y1,y2) */
+  for (j=y1; (status >= 0) && (j<y2); j++) {
+    spread->rows[j-y1] = spread->numSpans;
+    status = _vlRleSpreadRow (src, j, x1, x2, s1, s2, dilate, spread);
+  }
+  if (status >= 0) {
+    spread->rows[y2-y1] = spread->numSpans;
+  }
+
+  /* vertical spread and update of every row */
+  for (j=0; (status >= 0) && (j<height); j++) {
+    out->rows[j] = out->numSpans;
+    acc->numSpans = 0;
+    if ((j >= y1+s1) && (j < y2+s2-1)) {
+      n = 0;
+      for (o=s1; o<s2; o++) {
+	r = j-o-y1;
+	if ((r >= 0) && (r < y2-y1) && (spread->rows[r] < spread->rows[r+1])) {
+	  head[n] = spread->rows[r];
+	  end[n] = spread->rows[r+1];
+	  n++;
+	}
+      }
+      status = _vlRleUnion (spread, head, end, n, acc);
+    }
+    if (status >= 0) {
+      status = _vlRleCombineRow (src, j, acc, dilate, out);
+    }
+  }
+
+  /* src is not read any more, so dest may be src. The former buffers of
+     dest are kept in scratch for the next call */
+  if (status >= 0) {
+    out->rows[height] = out->numSpans;
+    _vlRleSwap (dest, out);
+  }
+
+  return (status);
+}
+
+
+/* erode (dilate) with scratch, or with a temporary one if NULL */
+static int
+_vlRleMorphOnce (vlRleImage *src, int size, vlWindow *window,
+		 vlRleImage *dest, int dilate, const char *name)
+{
+  vlRleScratch temp;
+  int status;
+
+  memset (&temp, 0, sizeof(vlRleScratch));
+  status = _vlRleMorph (src, size, window, dest, dilate, &temp, name);
+  _vlRleScratchFree (&temp);
+
+  return (status);
+}
+
+
+int
+vlRleErode (vlRleImage *src, int size, vlWindow *window, vlRleImage *dest)
+{
+  return (_vlRleMorphOnce (src, size, window, dest, FALSE, "vlRleErode"));
+}
+
+
+int
+vlRleDilate (vlRleImage *src, int size, vlWindow *window, vlRleImage *dest)
+{
+  return (_vlRleMorphOnce (src, size, window, dest, TRUE, "vlRleDilate"));
+}
+
+
+/* num erosions then num dilations (close: the other way round), in place.
+   Without scratch, a temporary one serves all the steps */
+static int
+_vlRleOpenClose (vlRleImage *src, int size, int num, vlWindow *window,
+		 vlRleScratch *scratch, int close, const char *name)
+{
+  vlRleScratch temp;
+  int i, status;
+
+  if (!scratch) {
+    memset (&temp, 0, sizeof(vlRleScratch));
+    scratch = &temp;
+  }
+
+  status = 0;
+  for (i=0; (i<2*num) && (status>=0); i++) {
+    status = _vlRleMorph (src, size, window, src, (i<num) == close, scratch,
+			  name);
+  }
+
+  if (scratch == &temp) {
+    _vlRleScratchFree (&temp);
+  }
+
+  return (status);
+}
+
+
+int
+vlRleOpen (vlRleImage *src, int size, int num, vlWindow *window)
+{
+  return (_vlRleOpenClose (src, size, num, window, NULL, FALSE,
+			   "vlRleOpen"));
+}
+
+
+int
+vlRleClose (vlRleImage *src, int size, int num, vlWindow *window)
+{
+  return (_vlRleOpenClose (src, size, num, window, NULL, TRUE,
+			   "vlRleClose"));
+}
+
+
+int
+vlRleOpenScratch (vlRleImage *src, int size, int num, vlWindow *window,
+		  vlRleScratch *scratch)
+{
+  return (_vlRleOpenClose (src, size, num, window, scratch, FALSE,
+			   "vlRleOpenScratch"));
+}
+
+
+int
+vlRleCloseScratch (vlRleImage *src, int size, int num, vlWindow *window,
+		   vlRleScratch *scratch)
+{
+  return (_vlRleOpenClose (src, size, num, window, scratch, TRUE,
+			   "vlRleCloseScratch"));
+}
+
+
+/* -----------------------------------------------------------
+   LABELING
+   ----------------------------------------------------------- */
+
+/* feed the gaps between the spans (the clear pixels) to the labeler */
+static int
+_vlRleScanRows (vlLabeler *labeler, vlRleImage *src)
+{
+  int j, k, x;
+  vlSpan *span;
+
+  for (j=0; j<src->height; j++) {
+    x = 0;
+    for (k=src->rows[j], span=src->spans+k; k<src->rows[j+1]; k++, span++) {
+      if ((span->x1 > x) && (0 > vlLabelerAddRun (labeler, j, x, span->x1))) {
+	return (-1);		/* failure */
+      }
+      x = span->x2;
+    }
+    if ((x < src->width) &&
+	(0 > vlLabelerAddRun (labeler, j, x, src->width))) {
+      return (-1);		/* failure */
+    }
+  }
+
+  return (0);			/* success */
+}
+
+
+/* blobs of clear pixels, left in labeler->blobs[1..n] (see vlLabelBlobs) */
+int
+vlRleLabelBlobs (vlLabeler *labeler, vlRleImage *src)
+{
+  if ((!labeler) || (!src)) {
+    VL_ERROR ("vlRleLabelBlobs: error: one of the parameters is NULL\n");
+    return (-1);		/* failure */
+  }
+
+  if ((0 > vlLabelerStart (labeler, src->width, src->height)) ||
+      (0 > _vlRleScanRows (labeler, src))) {
+    return (-1);		/* failure */
+  }
+
+  return (vlLabelerFinish (labeler));
+}
+
+
+/* k largest blobs of clear pixels (see vlFindLargestBlobs) */
+int
+vlRleLargestBlobs (vlLabeler *labeler, vlRleImage *src, int k, int minArea,
+		   blob *out)
+{
+  int n;
+  vlLabeler *temp = NULL;
+
+  if ((!src) || (k <= 0) || (!out)) {
+    VL_ERROR ("vlRleLargestBlobs: error: illegal parameter\n");
+    return (-1);		/* failure */
+  }
+
+  if (!labeler) {
+    if (NULL == (labeler = temp = vlLabelerCreate ())) {
+      return (-1);		/* failure */
+    }
+  }
+
+  n = vlLabelerStartLargest (labeler, src->width, src->height, k, minArea,
+			     out);
+  if (n >= 0) {
+    n = _vlRleScanRows (labeler, src);
+  }
+  if (n >= 0) {
+    n = vlLabelerFinish (labeler);
+  }
+
+  labeler->stream = FALSE;
+  labeler->out = NULL;
+  if (temp) {
+    vlLabelerDestroy (temp);
+  }
+
+  return (n);
+}
@@ -0,0 +1,371 @@
+/*****************************************************************************
+ *
+ * FILE:     segment.cpp
+ *
+ * ABSTRACT: one pass multi-class color segmentation (CMVision style class
+ *           masks). Every pixel is converted to HSI once and classified
+ *           against all the classes with three lookups.
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vislib.h"
+#include "vlSegment.h"
+
+
+vlSegmenter *
+vlSegmenterCreate (void)
+{
+  vlSegmenter *seg;
+  int size = (VL_PIXEL_MAXVAL+1) * sizeof(vlClassMask);
+
+  if (NULL == (seg = (vlSegmenter *) calloc (1, sizeof(vlSegmenter)))) {
+    VL_ERROR ("vlSegmenterCreate: malloc failed\n");
+    return (NULL);
+  }
+
+  seg->h = (vlClassMask *) calloc (1, size);
+  seg->s = (vlClassMask *) calloc (1, size);
+  seg->i = (vlClassMask *) calloc (1, size);
+  if ((!seg->h) || (!seg->s) || (!seg->i)) {
+    VL_ERROR ("vlSegmenterCreate: malloc failed\n");
+    vlSegmenterDestroy (seg);
+    return (NULL);
+  }
+
+  return (seg);
+}
+
+
+void
+vlSegmenterDestroy (vlSegmenter *seg)
+{
+  int c;
+
+  if (seg) {
+    for (c=0; c<VL_MAX_CLASSES; c++) {
+      vlLabelerDestroy (seg->labelers[c]);
+    }
+    VL_FREE (seg->h);
+    VL_FREE (seg->s);
+    VL_FREE (seg->i);
+    VL_FREE (seg->hsi);
+    VL_FREE (seg->mask);
+    VL_FREE (seg);
+  }
+}
+
+
+/* set bit of table[v] for v in [min,max], clipped to the pixel range */
+static void
+_vlSegmentRange (vlClassMask *table, int min, int max, vlClassMask bit)
+{
+  int v;
+
+  if (min < 0) min = 0;
+  if (max > VL_PIXEL_MAXVAL) max = VL_PIXEL_MAXVAL;
+  for (v=min; v<=max; v++) {
+    table[v] |= bit;
+  }
+}
+
+
+/******************************************************************************
+ *
+ * vlSegmenterAddClass --
+ *	add the HSI box of para (same bounds as vlBinary) as the next class
+ *
+ * RETURNS:
+ *   The class index, or -1 on failure.
+ *
+ *****************************************************************************/
+int
+vlSegmenterAddClass (vlSegmenter *seg, vlHSI_carl_tol_t *para)
+{
+  int c;
+  vlClassMask bit;
+
+  if ((!seg) || (!para)) {
+    VL_ERROR ("vlSegmenterAddClass: error: one of the parameters is NULL\n");
+    return (-1);		/* failure */
+  }
+
+  if (seg->numClasses == VL_MAX_CLASSES) {
+    VL_ERROR ("vlSegmenterAddClass: error: too many classes\n");
+    return (-1);		/* failure */
+  }
+
+  c = seg->numClasses;
+  if ((!seg->labelers[c]) &&
+      (NULL == (seg->labelers[c] = vlLabelerCreate ()))) {
+    return (-1);		/* failure */
+  }
+
+  bit = ((vlClassMask) 1) << c;
+  _vlSegmentRange (seg->h, para->h-HDEG_TO_HVAL(para->h_tol),
+		   para->h+HDEG_TO_HVAL(para->h_tol), bit);
+  _vlSegmentRange (seg->s, para->s-SPCT_TO_SVAL(para->s_tol),
+		   para->s+SPCT_TO_SVAL(para->s_tol), bit);
+  _vlSegmentRange (seg->i, para->i-IPCT_TO_IVAL(para->i_tol),
+		   para->i+IPCT_TO_IVAL(para->i_tol), bit);
+
+  seg->para[c] = *para;
+  seg->numClasses++;
+
+  return (c);
+}
+
+
+/* read a para.txt style file (see load_sample_hsi_carl_params) */
+int
+vlSegmenterLoadClass (vlSegmenter *seg, const char *file)
+{
+  FILE *fp;
+  vlHSI_carl_tol_t para;
+  int n;
+
+  if ((!seg) || (!file)) {
+    VL_ERROR ("vlSegmenterLoadClass: error: one of the parameters is NULL\n");
+    return (-1);		/* failure */
+  }
+
+  if (NULL == (fp = fopen (file, "r"))) {
+    perror ("vlSegmenterLoadClass: unable to open file");
+    return (-1);		/* failure */
+  }
+  n = fscanf (fp, "%hu %hu %hu %hu %hu %hu", &para.h, &para.s, &para.i,
+	      &para.h_tol, &para.s_tol, &para.i_tol);
+  fclose (fp);
+
+  if (n != 6) {
+    VL_ERROR ("vlSegmenterLoadClass: error: bad parameter file\n");
+    return (-1);		/* failure */
+  }
+
+  return (vlSegmenterAddClass (seg, &para));
+}
+
+
+/* remove all the classes */
+int
+vlSegmenterClear (vlSegmenter *seg)
+{
+  int size = (VL_PIXEL_MAXVAL+1) * sizeof(vlClassMask);
+
+  if (!seg) {
+    VL_ERROR ("vlSegmenterClear: error: NULL segmenter\n");
+    return (-1);		/* failure */
+  }
+
+  memset (seg->h, 0, size);
+  memset (seg->s, 0, size);
+  memset (seg->i, 0, size);
+  seg->numClasses = 0;
+
+  return (0);			/* success */
+}
+
+
+/* class masks of n consecutive RGB pixels, 0 where no class matches */
+void
+vlSegmentRow (vlSegmenter *seg, const vlPixel *src, int n, vlClassMask *mask)
+{
+  int x;
+  const vlPixel *input;
+
+  vlRgb2HsiRow (src, seg->hsi, n);
+
+  for (x=0, input=seg->hsi; x<n; x++, input+=VL_HSI_PIXEL) {
+    mask[x] = seg->h[input[0]] & seg->s[input[1]] & seg->i[input[2]];
+  }
+}
+
+
+/* make room for rows of width pixels */
+static int
+_vlSegmentAlloc (vlSegmenter *seg, int width)
+{
+  vlPixel *hsi;
+  vlClassMask *mask;
+
+  if (width <= seg->width) {
+    return (0);
+  }
+
+  hsi = (vlPixel *) realloc (seg->hsi, VL_HSI_SIZE (width, 1));
+  if (hsi) seg->hsi = hsi;
+  mask = (vlClassMask *) realloc (seg->mask, width * sizeof(vlClassMask));
+  if (mask) seg->mask = mask;
+  if ((!hsi) || (!mask)) {
+    VL_ERROR ("vlSegment: malloc failed\n");
+    return (-1);		/* failure */
+  }
+  seg->width = width;
+
+  return (0);			/* success */
+}
+
+
+/* send the runs of every class of row y to their labelers. A run of
+   class c ends where bit c of the mask changes, whatever the other bits */
+static int
+_vlSegmentScanRow (vlSegmenter *seg, int y, int n)
+{
+  int x, c;
+  vlClassMask m, prev, changed;
+
+  prev = 0;
+  for (x=0; x<=n; x++) {
+    m = (x < n) ? seg->mask[x] : 0;
+    if (m == prev) {
+      continue;
+    }
+    for (c=0, changed=m^prev; changed; c++, changed>>=1) {
+      if (!(changed & 1)) {
+	continue;
+      }
+      if ((m >> c) & 1) {
+	seg->start[c] = x;
+      }
+      else if (0 > vlLabelerAddRun (seg->labelers[c], y, seg->start[c], x)) {
+	return (-1);		/* failure */
+      }
+    }
+    prev = m;
+  }
+
+  return (0);			/* success */
+}
+
+
+/* classify and label all the rows of src, the labelers being started */
+static int
+_vlSegmentImage (vlSegmenter *seg, vlImage *src)
+{
+  int j;
+
+  for (j=0; j<src->height; j++) {
+    vlSegmentRow (seg, src->pixel + VL_RGB_PIXEL*j*src->width, src->width,
+		  seg->mask);
+    if (0 > _vlSegmentScanRow (seg, j, src->width)) {
+      return (-1);		/* failure */
+    }
+  }
+
+  return (0);			/* success */
+}
+
+
+static int
+_vlSegmentCheck (vlSegmenter *seg, vlImage *src, const char *name)
+{
+  if ((!seg) || (!src)) {
+    VL_ERROR ("%s: error: one of the parameters is NULL\n", name);
+    return (-1);		/* failure */
+  }
+
+  if (src->format != RGB) {
+    VL_ERROR ("%s: src image is not RGB\n", name);
+    return (-1);		/* failure */
+  }
+
+  return (_vlSegmentAlloc (seg, src->width));
+}
+
+
+/******************************************************************************
+ *
+ * vlSegmentBlobs --
+ *	label the 8-connected blobs of every class in one pass over src.
+ *      The blobs of class c are in seg->labelers[c]->blobs[1..n], as
+ *      vlLabelBlobs would give them for vlBinary with the class thresholds.
+ *
+ * RETURNS:
+ *   The total number of blobs, or -1 on failure.
+ *
+ *****************************************************************************/
+int
+vlSegmentBlobs (vlSegmenter *seg, vlImage *src)
+{
+  int c, n, total;
+
+  if (0 > _vlSegmentCheck (seg, src, "vlSegmentBlobs")) {
+    return (-1);		/* failure */
+  }
+
+  for (c=0; c<seg->numClasses; c++) {
+    if (0 > vlLabelerStart (seg->labelers[c], src->width, src->height)) {
+      return (-1);		/* failure */
+    }
+  }
+
+  if (0 > _vlSegmentImage (seg, src)) {
+    return (-1);		/* failure */
+  }
+
+  total = 0;
+  for (c=0; c<seg->numClasses; c++) {
+    if (0 > (n = vlLabelerFinish (seg->labelers[c]))) {
+      return (-1);		/* failure */
+    }
+    total += n;
+  }
+
+  return (total);
+}
+
+
+/******************************************************************************
+ *
+ * vlSegmentLargestBlobs --
+ *	find the k largest blobs of every class in one pass over src, without
+ *      keeping the runs (see vlFindLargestBlobs).
+ *
+ * OUTPUTS:
+ *   out	numClasses*k blobs, those of class c from out[c*k]
+ *   found	number of blobs of each class written into out
+ *
+ * RETURNS:
+ *   The total number of blobs written into out, or -1 on failure.
+ *
+ *****************************************************************************/
+int
+vlSegmentLargestBlobs (vlSegmenter *seg, vlImage *src, int k, int minArea,
+		       blob *out, int *found)
+{
+  int c, n, total;
+
+  if ((k <= 0) || (!out) || (!found)) {
+    VL_ERROR ("vlSegmentLargestBlobs: error: illegal parameter\n");
+    return (-1);		/* failure */
+  }
+
+  if (0 > _vlSegmentCheck (seg, src, "vlSegmentLargestBlobs")) {
+    return (-1);		/* failure */
+  }
+
+  n = 0;
+  for (c=0; (n >= 0) && (c<seg->numClasses); c++) {
+    n = vlLabelerStartLargest (seg->labelers[c], src->width, src->height, k,
+			       minArea, out + c*k);
+  }
+  if (n >= 0) {
+    n = _vlSegmentImage (seg, src);
+  }
+
+  total = 0;
+  for (c=0; c<seg->numClasses; c++) {
+    if (n >= 0) {
+      found[c] = vlLabelerFinish (seg->labelers[c]);
+      if (found[c] < 0) n = -1;
+      else total += found[c];
+    }
+    seg->labelers[c]->stream = FALSE;
+    seg->labelers[c]->out = NULL;
+  }
+
+  return ((n < 0) ? -1 : total);
+}
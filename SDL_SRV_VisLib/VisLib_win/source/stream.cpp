@@ -0,0 +1,370 @@
+/*****************************************************************************
+ *
+ * FILE:     stream.cpp
+ *
+ * ABSTRACT: row streaming threshold -> open -> close -> label pipeline
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vislib.h"
+#include "vlStream.h"
+
+
+/* free the per frame size buffers */
+static void
+_vlStreamFree (vlStream *stream)
+{
+  int k;
+
+  for (k=0; k<stream->numStages; k++) {
+    VL_FREE (stream->stages[k].ring);
+    VL_FREE (stream->stages[k].last);
+  }
+  VL_FREE (stream->stages);
+  VL_FREE (stream->hsi);
+  VL_FREE (stream->binary);
+  stream->numStages = 0;
+  stream->width = 0;
+}
+
+
+/* allocate the buffers for width and the stages for size/num */
+static int
+_vlStreamAlloc (vlStream *stream, int width, int size, int num)
+{
+  int k;
+  vlStreamMorph *stage;
+
+  stream->numStages = 4*num;
+  stream->stages = (vlStreamMorph *) calloc (VL_MAX (stream->numStages, 1),
+					     sizeof(vlStreamMorph));
+  stream->hsi = (vlPixel *) malloc (VL_HSI_SIZE (width, 1));
+  stream->binary = (vlPixel *) malloc (VL_BINARY_SIZE (width, 1));
+  if ((!stream->stages) || (!stream->hsi) || (!stream->binary)) {
+    VL_ERROR ("vlStreamStart: malloc failed\n");
+    return (-1);		/* failure */
+  }
+
+  for (k=0; k<stream->numStages; k++) {
+    stage = stream->stages + k;
+    stage->s2 = size/2;
+    stage->s1 = -(size-stage->s2);
+    stage->depth = 1-stage->s1;
+    stage->ring = (vlPixel *) malloc (VL_BINARY_SIZE (width, stage->depth));
+    stage->last = (int *) malloc ((VL_MAX (width, 1)) * sizeof(int));
+    if ((!stage->ring) || (!stage->last)) {
+      VL_ERROR ("vlStreamStart: malloc failed\n");
+      return (-1);		/* failure */
+    }
+  }
+
+  stream->width = width;
+  stream->size = size;
+  stream->num = num;
+
+  return (0);			/* success */
+}
+
+
+/* forward declaration */
+static int _vlStreamEmit (vlStream *stream, int k, int y);
+
+/* feed row y to stage k (the labeler after the last stage) */
+static int
+_vlStreamPush (vlStream *stream, int k, int y, const vlPixel *row)
+{
+  int i, seen, size;
+  int x1, x2;
+  int dilate;
+  int *last;
+  vlStreamMorph *stage;
+
+  if (k == stream->numStages) {
+    return (vlLabelerScanRow (stream->labeler, y, row));
+  }
+
+  stage = stream->stages + k;
+  memcpy (stage->ring + (y%stage->depth)*stream->width, row,
+	  VL_BINARY_SIZE (stream->width, 1));
+
+  /* source row: remember which columns it reaches (see vlBinaryErode),
+     last[i] is for column x1+s1+i */
+  if ((y >= stage->y1) && (y < stage->y2) && (stage->x1 < stage->x2)) {
+    size = stage->s2-stage->s1;
+    x1 = stage->x1;
+    x2 = stage->x2;
+    dilate = stage->dilate;
+    last = stage->last - x1;
+    seen = x1-size;
+    for (i=x1; i<x2; i++) {
+      if ((row[i] != 0) == dilate) seen = i;
+      if (seen > i-size) last[i] = y;
+    }
+    for (; i<x2+size-1; i++) {
+      if (seen > i-size) last[i] = y;
+    }
+  }
+
+  /* no source row after y can reach row y+s1 */
+  if (y+stage->s1 >= 0) {
+    return (_vlStreamEmit (stream, k, y+stage->s1));
+  }
+
+  return (0);
+}
+
+
+/* row y of stage k is final: apply it and pass it on */
+static int
+_vlStreamEmit (vlStream *stream, int k, int y)
+{
+  int i, cols, limit;
+  vlPixel value;
+  vlPixel *row, *out;
+  int *last;
+  vlStreamMorph *stage;
+
+  stage = stream->stages + k;
+  row = stage->ring + (y%stage->depth)*stream->width;
+
+  if ((y >= stage->y1+stage->s1) && (y < stage->y2+stage->s2-1) &&
+      (stage->x1 < stage->x2)) {
+    cols = stage->x2-stage->x1+stage->s2-stage->s1-1;
+    value = stage->dilate ? 255 : 0;
+    limit = y-stage->s2;
+    last = stage->last;
+    out = row + stage->x1+stage->s1;
+    for (i=0; i<cols; i++) {
+      if (last[i] > limit) out[i] = value;
+    }
+  }
+
+  return (_vlStreamPush (stream, k+1, y, row));
+}
+
+
+vlStream *
+vlStreamCreate (void)
+{
+  vlStream *stream;
+
+  if (NULL == (stream = (vlStream *) calloc (1, sizeof(vlStream)))) {
+    VL_ERROR ("vlStreamCreate: malloc failed\n");
+    return (NULL);
+  }
+
+  return (stream);
+}
+
+
+void
+vlStreamDestroy (vlStream *stream)
+{
+  if (stream) {
+    _vlStreamFree (stream);
+    VL_FREE (stream);
+  }
+}
+
+
+/******************************************************************************
+ *
+ * vlStreamStart --
+ *	prepare the stream for a new frame. Buffers are only reallocated if
+ *      width, size or num change.
+ *
+ * INPUTS:
+ *   stream	pipeline context
+ *   width	frame width
+ *   height	frame height
+ *   para	HSI thresholds, as for vlBinary
+ *   size	open/close structuring element size
+ *   num	number of erosions/dilations of open and close
+ *   labeler	started labeler the finished rows go to
+ *
+ * RETURNS:
+ *   On success, 0 is returned. Otherwise, -1.
+ *
+ *****************************************************************************/
+int
+vlStreamStart (vlStream *stream, int width, int height,
+	       vlHSI_carl_tol_t *para, int size, int num, vlLabeler *labeler)
+{
+  int i, k;
+  vlStreamMorph *stage;
+
+  if ((!stream) || (width <= 0) || (height <= 0) || (!para) ||
+      (size <= 0) || (num < 0) || (!labeler)) {
+    VL_ERROR ("vlStreamStart: error: illegal parameter\n");
+    return (-1);		/* failure */
+  }
+
+  if ((width != stream->width) || (size != stream->size) ||
+      (num != stream->num)) {
+    _vlStreamFree (stream);
+    if (0 > _vlStreamAlloc (stream, width, size, num)) {
+      _vlStreamFree (stream);
+      return (-1);		/* failure */
+    }
+  }
+
+  stream->para = *para;
+
+  /* open is num erosions then num dilations, close the reverse; each
+     one gets the source area of a whole frame window */
+  for (k=0; k<stream->numStages; k++) {
+    stage = stream->stages + k;
+    stage->dilate = (k >= num) && (k < 3*num);
+    stage->x1 = -stage->s1;
+    stage->x2 = width-stage->s2;
+    stage->y1 = -stage->s1;
+    stage->y2 = height-stage->s2;
+    for (i=0; i<width; i++) stage->last[i] = -size;
+  }
+
+  stream->height = height;
+  stream->labeler = labeler;
+  stream->row = 0;
+
+  return (0);			/* success */
+}
+
+
+/* threshold the next RGB row (width pixels) and push it down the stream */
+int
+vlStreamRow (vlStream *stream, const vlPixel *rgb)
+{
+  if ((!stream) || (!rgb) || (stream->row >= stream->height)) {
+    VL_ERROR ("vlStreamRow: error: illegal parameter\n");
+    return (-1);		/* failure */
+  }
+
+  vlBinaryRow (rgb, &stream->para, stream->width, stream->hsi,
+	       stream->binary);
+
+  return (_vlStreamPush (stream, 0, stream->row++, stream->binary));
+}
+
+
+/* flush the rows still held by the stages and finish the labeler */
+int
+vlStreamFinish (vlStream *stream)
+{
+  int k, y;
+
+  if ((!stream) || (stream->row != stream->height)) {
+    VL_ERROR ("vlStreamFinish: error: frame not complete\n");
+    return (-1);		/* failure */
+  }
+
+  for (k=0; k<stream->numStages; k++) {
+    for (y=VL_MAX (stream->height+stream->stages[k].s1, 0);
+	 y<stream->height; y++) {
+      if (0 > _vlStreamEmit (stream, k, y)) {
+	return (-1);		/* failure */
+      }
+    }
+  }
+
+  return (vlLabelerFinish (stream->labeler));
+}
+
+
+/* stream all the rows of src */
+static int
+_vlStreamImage (vlStream *stream, vlImage *src, vlHSI_carl_tol_t *para,
+		int size, int num, vlLabeler *labeler)
+{
+  int j;
+
+  if (0 > vlStreamStart (stream, src->width, src->height, para, size, num,
+			 labeler)) {
+    return (-1);		/* failure */
+  }
+
+  for (j=0; j<src->height; j++) {
+    if (0 > vlStreamRow (stream, src->pixel + VL_RGB_PIXEL*j*src->width)) {
+      return (-1);		/* failure */
+    }
+  }
+
+  return (vlStreamFinish (stream));
+}
+
+
+/******************************************************************************
+ *
+ * vlStreamLabelBlobs --
+ *	label the blobs of vlBinary(src), opened then closed num times by a
+ *      size x size square. The blobs are left in labeler->blobs.
+ *
+ * RETURNS:
+ *   The number of blobs, or -1 on failure.
+ *
+ *****************************************************************************/
+int
+vlStreamLabelBlobs (vlStream *stream, vlImage *src, vlHSI_carl_tol_t *para,
+		    int size, int num, vlLabeler *labeler)
+{
+  if ((!stream) || (!src) || (!labeler)) {
+    VL_ERROR ("vlStreamLabelBlobs: error: one of the parameters is NULL\n");
+    return (-1);		/* failure */
+  }
+
+  if (src->format != RGB) {
+    VL_ERROR ("vlStreamLabelBlobs: src image is not RGB\n");
+    return (-1);		/* failure */
+  }
+
+  if (0 > vlLabelerStart (labeler, src->width, src->height)) {
+    return (-1);		/* failure */
+  }
+
+  return (_vlStreamImage (stream, src, para, size, num, labeler));
+}
+
+
+/******************************************************************************
+ *
+ * vlStreamLargestBlobs --
+ *	same as vlStreamLabelBlobs, but only the k largest blobs of at least
+ *      minArea pixels are kept in out (see vlFindLargestBlobs).
+ *
+ * RETURNS:
+ *   The number of blobs written into out, or -1 on failure. The total
+ *   number of blobs is left in labeler->numBlobs.
+ *
+ *****************************************************************************/
+int
+vlStreamLargestBlobs (vlStream *stream, vlImage *src, vlHSI_carl_tol_t *para,
+		      int size, int num, vlLabeler *labeler, int k,
+		      int minArea, blob *out)
+{
+  int n;
+
+  if ((!stream) || (!src) || (!labeler)) {
+    VL_ERROR ("vlStreamLargestBlobs: error: one of the parameters is NULL\n");
+    return (-1);		/* failure */
+  }
+
+  if (src->format != RGB) {
+    VL_ERROR ("vlStreamLargestBlobs: src image is not RGB\n");
+    return (-1);		/* failure */
+  }
+
+  if (0 > vlLabelerStartLargest (labeler, src->width, src->height, k,
+				 minArea, out)) {
+    return (-1);		/* failure */
+  }
+
+  n = _vlStreamImage (stream, src, para, size, num, labeler);
+
+  labeler->stream = FALSE;
+  labeler->out = NULL;
+
+  return (n);
+}
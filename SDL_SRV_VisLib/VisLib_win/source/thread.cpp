@@ -0,0 +1,129 @@
+/*****************************************************************************
+ *
+ * FILE:     thread.cpp
+ *
+ * ABSTRACT: minimal fork/join helper for the parallel operators
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#include "vislib.h"
+#include "vlThread.h"
+
+/* what each thread runs */
+typedef struct {
+  vlThreadFunc fn;
+  void *arg;
+  int index;
+} _vlThreadJob;
+
+#ifdef _WIN32
+static unsigned __stdcall
+_vlThreadMain (void *data)
+#else
+static void *
+_vlThreadMain (void *data)
+#endif
+{
+  _vlThreadJob *job = (_vlThreadJob *) data;
+
+  job->fn (job->arg, job->index);
+
+  return (0);
+}
+
+
+/******************************************************************************
+ *
+ * vlThreadRun --
+ *	run fn(arg, i) for i in [0,n) in parallel and wait for all of them.
+ *      If a thread cannot be created, its share runs on the calling thread.
+ *
+ * RETURNS:
+ *   On success, 0 is returned. Otherwise, -1.
+ *
+ *****************************************************************************/
+int
+vlThreadRun (int n, vlThreadFunc fn, void *arg)
+{
+  int i;
+  int started[VL_MAX_THREADS];
+  _vlThreadJob jobs[VL_MAX_THREADS];
+#ifdef _WIN32
+  HANDLE threads[VL_MAX_THREADS];
+#else
+  pthread_t threads[VL_MAX_THREADS];
+#endif
+
+  if ((n <= 0) || (n > VL_MAX_THREADS) || (!fn)) {
+    VL_ERROR ("vlThreadRun: error: illegal parameter\n");
+    return (-1);		/* failure */
+  }
+
+  for (i=1; i<n; i++) {
+    jobs[i].fn = fn;
+    jobs[i].arg = arg;
+    jobs[i].index = i;
+#ifdef _WIN32
+    threads[i] = (HANDLE) _beginthreadex (NULL, 0, _vlThreadMain, jobs + i,
+					  0, NULL);
+    started[i] = (threads[i] != 0);
+#else
+    started[i] = (0 == pthread_create (threads + i, NULL, _vlThreadMain,
+				       jobs + i));
+#endif
+    if (!started[i]) {
+      fn (arg, i);
+    }
+  }
+
+  fn (arg, 0);
+
+  for (i=1; i<n; i++) {
+    if (started[i]) {
+#ifdef _WIN32
+      WaitForSingleObject (threads[i], INFINITE);
+      CloseHandle (threads[i]);
+#else
+      pthread_join (threads[i], NULL);
+#endif
+    }
+  }
+
+  return (0);			/* success */
+}
+
+
+int
+vlThreadCount (void)
+{
+  int n;
+
+#ifdef _WIN32
+  SYSTEM_INFO info;
+
+  GetSystemInfo (&info);
+  n = (int) info.dwNumberOfProcessors;
+#else
+  n = (int) sysconf (_SC_NPROCESSORS_ONLN);
+#endif
+
+  if (n < 1) {
+    n = 1;
+  }
+  if (n > VL_MAX_THREADS) {
+    n = VL_MAX_THREADS;
+  }
+
+  return (n);
+}
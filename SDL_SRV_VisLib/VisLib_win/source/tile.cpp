@@ -0,0 +1,341 @@
+/*****************************************************************************
+ *
+ * FILE:     tile.cpp
+ *
+ * ABSTRACT: multi-threaded execution of the window operators, by bands
+ *           of rows with their halo, stitched into one dest image.
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vislib.h"
+#include "vlThread.h"
+#include "vlTile.h"
+
+
+vlTiler *
+vlTilerCreate (int bands)
+{
+  int k;
+  vlTiler *tiler;
+
+  if (bands <= 0) {
+    bands = vlThreadCount ();
+  }
+  if (bands > VL_MAX_THREADS) {
+    bands = VL_MAX_THREADS;
+  }
+
+  if (NULL == (tiler = (vlTiler *) calloc (1, sizeof(vlTiler)))) {
+    VL_ERROR ("vlTilerCreate: malloc failed\n");
+    return (NULL);
+  }
+  tiler->numBands = bands;
+
+  for (k=0; k<bands; k++) {
+    if (NULL == (tiler->band[k] = vlImageCreate (NONE, 0, 0))) {
+      vlTilerDestroy (tiler);
+      return (NULL);
+    }
+  }
+
+  return (tiler);
+}
+
+
+void
+vlTilerDestroy (vlTiler *tiler)
+{
+  int k;
+
+  if (tiler) {
+    for (k=0; k<tiler->numBands; k++) {
+      vlImageDestroy (tiler->band[k]);
+    }
+    VL_FREE (tiler);
+  }
+}
+
+
+/* rows [*r1,*r2) of src seen by band index: its own rows and the halo */
+static void
+_vlTileRows (vlTiler *tiler, int index, int *r1, int *r2)
+{
+  int height = tiler->src->height;
+
+  *r1 = tiler->first[index] - tiler->halo;
+  *r2 = tiler->first[index+1] + tiler->halo;
+  if (*r1 < 0) {
+    *r1 = 0;
+  }
+  if (*r2 > height) {
+    *r2 = height;
+  }
+}
+
+
+/* run the operator on band index, into its own image */
+static void
+_vlTileBand (void *arg, int index)
+{
+  vlTiler *tiler = (vlTiler *) arg;
+  vlImage view;
+  vlWindow window;
+  int r1, r2, y1, y2;
+
+  _vlTileRows (tiler, index, &r1, &r2);
+
+  /* the rows are contiguous: the view shares the pixels of src */
+  view.format = tiler->src->format;
+  view.width = tiler->src->width;
+  view.height = r2 - r1;
+  view.pixel = tiler->src->pixel + r1*tiler->src->width*vlPixelSize (view.format);
+
+  /* the part of window within the view */
+  y1 = tiler->window->y;
+  y2 = y1 + tiler->window->height;
+  y1 = VL_MAX(y1,r1);
+  y2 = VL_MIN(y2,r2);
+  window.x = tiler->window->x;
+  window.width = tiler->window->width;
+  window.y = y1 - r1;
+  window.height = y2 - y1;
+
+  tiler->status[index] = tiler->fn (&view, &window, tiler->band[index],
+				    tiler->arg);
+}
+
+
+/******************************************************************************
+ *
+ * vlTileRun --
+ *	fn(src, window, dest, arg) on tiler->numBands threads: the rows of
+ *      window are cut in bands of equal height, fn runs on each band and
+ *      the halo rows around it, and the own rows of every band are copied
+ *      to dest. halo is the number of rows fn reads above and below a
+ *      pixel. The rows above and below window are not given to any band:
+ *      if copy is TRUE (fn copies src out of window), they are copied
+ *      from src, otherwise they are left as they are in dest. dest gets
+ *      the format fn gives; it may be src, except that windows of less
+ *      than two bands run fn itself on src and dest.
+ *
+ * RETURNS:
+ *   On success, 0 is returned. Otherwise, the error of fn on a band, or -1.
+ *
+ *****************************************************************************/
+int
+vlTileRun (vlTiler *tiler, vlTileFunc fn, void *arg, int halo, int copy,
+	   vlImage *src, vlWindow *window, vlImage *dest)
+{
+  int k, n, r1, r2, bands, size;
+  vlImage *band;
+
+  /* verify parameters */
+  if ((!tiler) || (!fn) || (halo < 0) || (!src) || (!window) || (!dest)) {
+    VL_ERROR ("vlTileRun: error: illegal parameter\n");
+    return (-1);		/* failure */
+  }
+
+  if (0 >= vlPixelSize (src->format)) {
+    VL_ERROR ("vlTileRun: error: unsupported image format\n");
+    return (-1);		/* failure */
+  }
+
+  /* cut in bands of equal height, at least VL_TILE_MIN_ROWS rows each */
+  bands = VL_MIN (tiler->numBands, window->height / VL_TILE_MIN_ROWS);
+  if ((bands <= 1) || (window->y < 0) ||
+      (window->y + window->height > src->height)) {
+    return (fn (src, window, dest, arg));
+  }
+
+  tiler->fn = fn;
+  tiler->arg = arg;
+  tiler->src = src;
+  tiler->window = window;
+  tiler->halo = halo;
+  for (k=0; k<=bands; k++) {
+    tiler->first[k] = window->y + (int) ((long) window->height * k / bands);
+  }
+
+  if (0 > vlThreadRun (bands, _vlTileBand, tiler)) {
+    return (-1);		/* failure */
+  }
+
+  for (k=0; k<bands; k++) {
+    if (tiler->status[k] < 0) {
+      return (tiler->status[k]);	/* failure */
+    }
+  }
+
+  /* every band must have given an image of its view */
+  n = vlPixelSize (tiler->band[0]->format);
+  for (k=0; k<bands; k++) {
+    _vlTileRows (tiler, k, &r1, &r2);
+    band = tiler->band[k];
+    if ((n <= 0) || (band->format != tiler->band[0]->format) ||
+	(band->width != src->width) || (band->height != r2-r1)) {
+      VL_ERROR ("vlTileRun: error: operator changed the size of a band\n");
+      return (-1);		/* failure */
+    }
+  }
+
+  if (((dest->format != tiler->band[0]->format) ||
+       (dest->width != src->width) || (dest->height != src->height)) &&
+      (0 > vlImageInit (dest, tiler->band[0]->format, src->width, src->height))) {
+    VL_ERROR ("vlTileRun: error: could not initialize dest image\n");
+    return (-1);		/* failure */
+  }
+
+  /* stitch the own rows of the bands */
+  for (k=0; k<bands; k++) {
+    _vlTileRows (tiler, k, &r1, &r2);
+    memcpy (dest->pixel + tiler->first[k]*dest->width*n,
+	    tiler->band[k]->pixel + (tiler->first[k]-r1)*dest->width*n,
+	    (tiler->first[k+1]-tiler->first[k])*dest->width*n*sizeof(vlPixel));
+  }
+
+  /* rows above and below window, as fn leaves them */
+  if (copy && (dest->pixel != src->pixel) && (dest->format == src->format)) {
+    size = dest->width*n;
+    memcpy (dest->pixel, src->pixel, window->y*size*sizeof(vlPixel));
+    r2 = window->y + window->height;
+    memcpy (dest->pixel + r2*size, src->pixel + r2*size,
+	    (src->height-r2)*size*sizeof(vlPixel));
+  }
+
+  return (0);			/* success */
+}
+
+
+/* the operators, the rows they read above and below a pixel, and whether
+   they copy src out of window */
+
+static int
+_vlTileConvolve (vlImage *src, vlWindow *window, vlImage *dest, void *arg)
+{
+  return (vlConvolve (src, (vlMask *) arg, window, dest));
+}
+
+int
+vlTileConvolve (vlTiler *tiler, vlImage *src, vlMask *mask, vlWindow *window,
+		vlImage *dest)
+{
+  if (!mask) {
+    VL_ERROR ("vlTileConvolve: error: illegal parameter\n");
+    return (-1);		/* failure */
+  }
+  return (vlTileRun (tiler, _vlTileConvolve, mask, mask->height, TRUE, src,
+		     window, dest));
+}
+
+
+static int
+_vlTileSmooth (vlImage *src, vlWindow *window, vlImage *dest, void *arg)
+{
+  return (vlSmooth (src, *(int *) arg, window, dest));
+}
+
+int
+vlTileSmooth (vlTiler *tiler, vlImage *src, int size, vlWindow *window,
+	      vlImage *dest)
+{
+  return (vlTileRun (tiler, _vlTileSmooth, &size, VL_MAX(size,0), TRUE, src,
+		     window, dest));
+}
+
+
+static int
+_vlTileSmoothMedian (vlImage *src, vlWindow *window, vlImage *dest,
+		     void *arg)
+{
+  return (vlSmoothMedian (src, *(int *) arg, window, dest));
+}
+
+int
+vlTileSmoothMedian (vlTiler *tiler, vlImage *src, int size, vlWindow *window,
+		    vlImage *dest)
+{
+  return (vlTileRun (tiler, _vlTileSmoothMedian, &size, VL_MAX(size,0), TRUE,
+		     src, window, dest));
+}
+
+
+/* the vertical pass of the morphology reads the rows of the horizontal
+   one, which only covers rows size/2 away from the edges of its picture:
+   twice the reach of the square */
+static int
+_vlTileRgbErode (vlImage *src, vlWindow *window, vlImage *dest, void *arg)
+{
+  return (vlRgbErode (src, *(int *) arg, window, dest));
+}
+
+int
+vlTileRgbErode (vlTiler *tiler, vlImage *src, int size, vlWindow *window,
+		vlImage *dest)
+{
+  return (vlTileRun (tiler, _vlTileRgbErode, &size, VL_MAX(2*size,0), TRUE,
+		     src, window, dest));
+}
+
+
+static int
+_vlTileRgbDilate (vlImage *src, vlWindow *window, vlImage *dest, void *arg)
+{
+  return (vlRgbDilate (src, *(int *) arg, window, dest));
+}
+
+int
+vlTileRgbDilate (vlTiler *tiler, vlImage *src, int size, vlWindow *window,
+		 vlImage *dest)
+{
+  return (vlTileRun (tiler, _vlTileRgbDilate, &size, VL_MAX(2*size,0), TRUE,
+		     src, window, dest));
+}
+
+
+static int
+_vlTileRgbFilter (vlImage *src, vlWindow *window, vlImage *dest, void *arg)
+{
+  return (vlRgbFilter (src, (vlObject *) arg, window, dest));
+}
+
+int
+vlTileRgbFilter (vlTiler *tiler, vlImage *src, vlObject *object,
+		 vlWindow *window, vlImage *dest)
+{
+  return (vlTileRun (tiler, _vlTileRgbFilter, object, 0, FALSE, src, window,
+		     dest));
+}
+
+
+static int
+_vlTileHsiFilter (vlImage *src, vlWindow *window, vlImage *dest, void *arg)
+{
+  return (vlHsiFilter (src, (vlObject *) arg, window, dest));
+}
+
+int
+vlTileHsiFilter (vlTiler *tiler, vlImage *src, vlObject *object,
+		 vlWindow *window, vlImage *dest)
+{
+  return (vlTileRun (tiler, _vlTileHsiFilter, object, 0, FALSE, src, window,
+		     dest));
+}
+
+
+static int
+_vlTileRgb2Hsi (vlImage *src, vlWindow *window, vlImage *dest, void *arg)
+{
+  (void) arg;
+  return (vlRgb2Hsi (src, window, dest));
+}
+
+int
+vlTileRgb2Hsi (vlTiler *tiler, vlImage *src, vlWindow *window, vlImage *dest)
+{
+  return (vlTileRun (tiler, _vlTileRgb2Hsi, NULL, 0, FALSE, src, window,
+		     dest));
+}
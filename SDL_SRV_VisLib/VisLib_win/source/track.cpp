@@ -0,0 +1,292 @@
+/*****************************************************************************
+ *
+ * FILE:     track.cpp
+ *
+ * ABSTRACT: predictive region of interest tracking
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vislib.h"
+#include "vlTrack.h"
+
+
+vlTracker *
+vlTrackerCreate (int maxMisses, int margin, int minArea)
+{
+  vlTracker *tracker;
+
+  if ((maxMisses < 0) || (margin < 0) || (minArea < 0)) {
+    VL_ERROR ("vlTrackerCreate: error: illegal parameter\n");
+    return (NULL);
+  }
+
+  if (NULL == (tracker = (vlTracker *) calloc (1, sizeof(vlTracker)))) {
+    VL_ERROR ("vlTrackerCreate: malloc failed\n");
+    return (NULL);
+  }
+
+  tracker->object = vlObjectCreate (0, 0, 1, 1);
+  tracker->scratch = vlMorphScratchCreate ();
+  tracker->labeler = vlLabelerCreate ();
+  if ((!tracker->object) || (!tracker->scratch) || (!tracker->labeler)) {
+    vlTrackerDestroy (tracker);
+    return (NULL);
+  }
+
+  tracker->maxMisses = maxMisses;
+  tracker->margin = margin;
+  tracker->minArea = minArea;
+  tracker->roi.format = BINARY;
+
+  return (tracker);
+}
+
+
+void
+vlTrackerDestroy (vlTracker *tracker)
+{
+  if (tracker) {
+    vlObjectDestroy (tracker->object);
+    vlMorphScratchDestroy (tracker->scratch);
+    vlLabelerDestroy (tracker->labeler);
+    VL_FREE (tracker->roi.pixel);
+    VL_FREE (tracker->hsi);
+    VL_FREE (tracker);
+  }
+}
+
+
+int
+vlTrackerReset (vlTracker *tracker)
+{
+  int i;
+
+  if (!tracker) {
+    VL_ERROR ("vlTrackerReset: error: NULL tracker\n");
+    return (-1);		/* failure */
+  }
+
+  tracker->object->defined = FALSE;
+  for (i=0; i<VL_OBJECT_NPOSITIONS; i++) {
+    tracker->object->last_x[i] = -1;
+    tracker->object->last_y[i] = -1;
+  }
+  tracker->misses = 0;
+
+  return (0);			/* success */
+}
+
+
+/* window around the predicted position, or the whole frame */
+static void
+_vlTrackWindow (vlTracker *tracker, int width, int height, int size, int num)
+{
+  int grow, drift;
+  int x1, x2, y1, y2;
+  vlObject *object = tracker->object;
+
+  /* the square support [s1,s2) is not centered: every erosion/dilation
+     pair moves the blobs by 1-s1-s2 pixels up and left, so the object
+     itself lies that much below and right of the last blob */
+  drift = 2*num*(1+(size-size/2)-size/2);
+
+  x1 = 0;
+  x2 = width;
+  y1 = 0;
+  y2 = height;
+
+  if ((object->defined) && (tracker->misses < tracker->maxMisses)) {
+    grow = tracker->margin*(1+tracker->misses);
+    x1 = VL_MAX (object->next_x - grow - abs (object->x_vel), 0);
+    x2 = VL_MIN (object->next_x + object->width + drift + grow +
+		 abs (object->x_vel), width);
+    y1 = VL_MAX (object->next_y - grow - abs (object->y_vel), 0);
+    y2 = VL_MIN (object->next_y + object->height + drift + grow +
+		 abs (object->y_vel), height);
+
+    /* prediction left the frame */
+    if ((x1 >= x2) || (y1 >= y2)) {
+      x1 = 0;
+      x2 = width;
+      y1 = 0;
+      y2 = height;
+    }
+  }
+
+  tracker->window.x = x1;
+  tracker->window.y = y1;
+  tracker->window.width = x2-x1;
+  tracker->window.height = y2-y1;
+}
+
+
+/* the window grown by halo pixels per side, clipped to the frame */
+static void
+_vlTrackRegion (vlTracker *tracker, int width, int height, int halo)
+{
+  vlWindow *window = &tracker->window;
+  int x1, x2, y1, y2;
+
+  x1 = VL_MAX (window->x - halo, 0);
+  y1 = VL_MAX (window->y - halo, 0);
+  x2 = VL_MIN (window->x + window->width + halo, width);
+  y2 = VL_MIN (window->y + window->height + halo, height);
+
+  tracker->region.x = x1;
+  tracker->region.y = y1;
+  tracker->region.width = x2-x1;
+  tracker->region.height = y2-y1;
+}
+
+
+/* make room for the region image and the HSI row */
+static int
+_vlTrackAlloc (vlTracker *tracker)
+{
+  int size;
+  vlPixel *pixel;
+
+  size = tracker->region.width*tracker->region.height;
+  if (size > tracker->roiSize) {
+    if (NULL == (pixel = (vlPixel *) realloc (tracker->roi.pixel,
+					       VL_BINARY_SIZE (size, 1)))) {
+      VL_ERROR ("vlTrack: malloc failed\n");
+      return (-1);		/* failure */
+    }
+    tracker->roi.pixel = pixel;
+    tracker->roiSize = size;
+  }
+
+  size = tracker->region.width;
+  if (size > tracker->hsiSize) {
+    if (NULL == (pixel = (vlPixel *) realloc (tracker->hsi,
+					       VL_HSI_SIZE (size, 1)))) {
+      VL_ERROR ("vlTrack: malloc failed\n");
+      return (-1);		/* failure */
+    }
+    tracker->hsi = pixel;
+    tracker->hsiSize = size;
+  }
+
+  tracker->roi.width = tracker->region.width;
+  tracker->roi.height = tracker->region.height;
+
+  return (0);			/* success */
+}
+
+
+/******************************************************************************
+ *
+ * vlTrack --
+ *	find the tracked object in the next frame. Only the window predicted
+ *      from the object motion is processed, unless the object is not
+ *      defined yet or was missed maxMisses times in a row: it is
+ *      thresholded and opened/closed with the halo the morphology reads
+ *      around it, then labeled alone.
+ *
+ * INPUTS:
+ *   tracker	tracking context
+ *   src	RGB frame
+ *   para	HSI thresholds, as for vlBinary
+ *   size	open/close structuring element size
+ *   num	number of erosions/dilations of open and close
+ *
+ * OUTPUTS:
+ *   found	largest blob, in frame coordinates (valid is -1 if missed)
+ *
+ * RETURNS:
+ *   1 if the object was found, 0 if not, -1 on failure.
+ *
+ *****************************************************************************/
+int
+vlTrack (vlTracker *tracker, vlImage *src, vlHSI_carl_tol_t *para,
+	 int size, int num, blob *found)
+{
+  int j, n;
+  blob b;
+  vlWindow full;
+  vlWindow *window, *region;
+  vlPixel *row;
+  vlObject *object;
+
+  if ((!tracker) || (!src) || (!para) || (!found)) {
+    VL_ERROR ("vlTrack: error: one of the parameters is NULL\n");
+    return (-1);		/* failure */
+  }
+
+  if (src->format != RGB) {
+    VL_ERROR ("vlTrack: src image is not RGB\n");
+    return (-1);		/* failure */
+  }
+
+  /* an erosion or dilation reads at most size pixels away, and open
+     and close make 2*num each: beyond that halo, the edges of the region
+     do not change the window */
+  _vlTrackWindow (tracker, src->width, src->height, size, num);
+  _vlTrackRegion (tracker, src->width, src->height, 4*size*num);
+  if (0 > _vlTrackAlloc (tracker)) {
+    return (-1);		/* failure */
+  }
+
+  window = &tracker->window;
+  region = &tracker->region;
+  for (j=0; j<region->height; j++) {
+    vlBinaryRow (src->pixel + VL_RGB_PIXEL*((region->y+j)*src->width +
+					    region->x),
+		 para, region->width, tracker->hsi,
+		 tracker->roi.pixel + j*region->width);
+  }
+
+  full.x = 0;
+  full.y = 0;
+  full.width = region->width;
+  full.height = region->height;
+  if ((0 > vlBinaryOpenScratch (&tracker->roi, size, num, &full,
+				tracker->scratch)) ||
+      (0 > vlBinaryCloseScratch (&tracker->roi, size, num, &full,
+				 tracker->scratch))) {
+    return (-1);		/* failure */
+  }
+
+  /* keep the rows of the window only, packed from the start of roi (a
+     row never moves forward) */
+  for (j=0; j<window->height; j++) {
+    row = tracker->roi.pixel + (window->y-region->y+j)*region->width +
+      window->x-region->x;
+    memmove (tracker->roi.pixel + j*window->width, row,
+	     window->width*sizeof(vlPixel));
+  }
+  tracker->roi.width = window->width;
+  tracker->roi.height = window->height;
+
+  n = vlFindLargestBlobs (tracker->labeler, &tracker->roi, 1,
+			  tracker->minArea, &b);
+  if (n < 0) {
+    return (-1);		/* failure */
+  }
+
+  if (n == 0) {
+    tracker->misses++;
+    found->valid = -1;
+    return (0);
+  }
+
+  /* back to frame coordinates (blob rows are y, columns x) */
+  vlBlobTranslate (&b, window->y, window->x, window->width, src->width);
+  *found = b;
+
+  object = tracker->object;
+  object->x = b.ymin;
+  object->y = b.xmin;
+  object->width = b.ymax-b.ymin+1;
+  object->height = b.xmax-b.xmin+1;
+  object->defined = TRUE;
+  vlObjectMotionUpdate (object);
+  tracker->misses = 0;
+
+  return (1);
+}
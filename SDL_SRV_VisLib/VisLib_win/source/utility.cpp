@@ -438,6 +438,10 @@ vlPixelSize (vlImageFormat format)
     return (VL_BINARY_PIXEL);
     break;
 
+  case YUV:
+    return (VL_YUV_PIXEL);
+    break;
+
   default:
     printf("vlPixelSize -> unknown image format\n");
     return (-1);
@@ -0,0 +1,294 @@
+/*****************************************************************************
+ *
+ * FILE:     yuv.cpp
+ *
+ * ABSTRACT: YCbCr images, as decoded from JPEG. Thresholding against the
+ *           color bins of the robot or a CbCr segmentation map, and the
+ *           JFIF conversions from/to RGB.
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vislib.h"
+#include "vlYuv.h"
+
+
+int
+vlYuvRangeSet (vlYuvRange *range, int y, int u, int v)
+{
+  if (!range) {
+    VL_ERROR ("vlYuvRangeSet: error: NULL range\n");
+    return (-1);		/* failure */
+  }
+
+  range->y_min = (vlPixel8) (y >> 8);
+  range->y_max = (vlPixel8) (y & 0xFF);
+  range->u_min = (vlPixel8) (u >> 8);
+  range->u_max = (vlPixel8) (u & 0xFF);
+  range->v_min = (vlPixel8) (v >> 8);
+  range->v_max = (vlPixel8) (v & 0xFF);
+
+  return (0);			/* success */
+}
+
+
+/* shift of the Cb and Cr bytes within a packed CbCr map index. embedcv
+   packs them through a union, Cb being the first byte in memory */
+static void
+_vlCbCrShifts (int *cbShift, int *crShift)
+{
+  union {
+    unsigned short cbcr;
+    unsigned char data[2];
+  } c;
+
+  c.data[0] = 1;
+  c.data[1] = 0;
+  *cbShift = (c.cbcr == 1) ? 0 : 8;
+  *crShift = 8 - *cbShift;
+}
+
+
+int
+vlCbCrMapRange (unsigned char *map, vlYuvRange *range, unsigned char value)
+{
+  int cb, cr, cbShift, crShift;
+
+  if ((!map) || (!range)) {
+    VL_ERROR ("vlCbCrMapRange: error: one of the parameters is NULL\n");
+    return (-1);		/* failure */
+  }
+
+  _vlCbCrShifts (&cbShift, &crShift);
+  for (cb=range->u_min; cb<=range->u_max; cb++) {
+    for (cr=range->v_min; cr<=range->v_max; cr++) {
+      map[(cb << cbShift) | (cr << crShift)] = value;
+    }
+  }
+
+  return (0);			/* success */
+}
+
+
+/* check src and initialize dest, for the thresholding ops */
+static int
+_vlYuvPrepare (vlImage8 *src, const void *table, vlImage8 *dest,
+	       const char *name)
+{
+  if ((!src) || (!table) || (!dest)) {
+    VL_ERROR ("%s: error: one of the parameters is NULL\n", name);
+    return (-1);		/* failure */
+  }
+
+  if (src->format != YUV) {
+    VL_ERROR ("%s: src image is not YUV\n", name);
+    return (-1);		/* failure */
+  }
+
+  if (0 > vlImage8Init (dest, BINARY, src->width, src->height)) {
+    VL_ERROR ("%s: error: could not initialize dest image\n", name);
+    return (-1);		/* failure */
+  }
+
+  return (0);			/* success */
+}
+
+
+/******************************************************************************
+ *
+ * vlBinaryYuv8 --
+ *	threshold a YUV picture against the inclusive bounds of range, as
+ *      the robot does with its color bins: 0 inside, 255 outside.
+ *
+ * RETURNS:
+ *   On success, 0 is returned. Otherwise, -1.
+ *
+ *****************************************************************************/
+int
+vlBinaryYuv8 (vlImage8 *src, vlYuvRange *range, vlImage8 *dest)
+{
+  int i, j;
+  unsigned int yMin, uMin, vMin, yLen, uLen, vLen;
+  const vlPixel8 *input;
+  vlPixel8 *output;
+
+  if (0 > _vlYuvPrepare (src, range, dest, "vlBinaryYuv8")) {
+    return (-1);		/* failure */
+  }
+
+  /* v in [min,max] is (unsigned) (v-min) <= max-min */
+  yMin = range->y_min;
+  uMin = range->u_min;
+  vMin = range->v_min;
+  yLen = range->y_max - yMin;
+  uLen = range->u_max - uMin;
+  vLen = range->v_max - vMin;
+  if ((range->y_min > range->y_max) || (range->u_min > range->u_max) ||
+      (range->v_min > range->v_max)) {
+    /* empty range, no value is 256 above y_min */
+    yMin = 256;
+    yLen = 0;
+  }
+  for (j=0; j<src->height; j++) {
+    input = VL_IMAGE8_ROW (src, j);
+    output = VL_IMAGE8_ROW (dest, j);
+    for (i=0; i<src->width; i++, input+=src->step, output+=dest->step) {
+      /* no branch per channel, the pixels are not predictable */
+      *output = (((input[0] - yMin) <= yLen) &
+		 ((input[1] - uMin) <= uLen) &
+		 ((input[2] - vMin) <= vLen)) ? 0 : 255;
+    }
+  }
+
+  return (0);			/* success */
+}
+
+
+/******************************************************************************
+ *
+ * vlBinaryCbCr8 --
+ *	threshold a YUV picture with a CbCr segmentation map (see
+ *      SegmentMapCbCr): 0 where the map entry of the pixel is not 0, 255
+ *      elsewhere.
+ *
+ * RETURNS:
+ *   On success, 0 is returned. Otherwise, -1.
+ *
+ *****************************************************************************/
+int
+vlBinaryCbCr8 (vlImage8 *src, const unsigned char *map, vlImage8 *dest)
+{
+  int i, j, cbShift, crShift;
+  const vlPixel8 *input;
+  vlPixel8 *output;
+
+  if (0 > _vlYuvPrepare (src, map, dest, "vlBinaryCbCr8")) {
+    return (-1);		/* failure */
+  }
+
+  _vlCbCrShifts (&cbShift, &crShift);
+  for (j=0; j<src->height; j++) {
+    input = VL_IMAGE8_ROW (src, j);
+    output = VL_IMAGE8_ROW (dest, j);
+    for (i=0; i<src->width; i++, input+=src->step, output+=dest->step) {
+      *output = map[(input[1] << cbShift) | (input[2] << crShift)] ? 0 : 255;
+    }
+  }
+
+  return (0);			/* success */
+}
+
+
+/* window based conversions: check the parameters and initialize dest */
+static int
+_vlYuvConvertPrepare (vlImage8 *src, vlImageFormat format, vlWindow *window,
+		      vlImage8 *dest, vlImageFormat destFormat,
+		      const char *name)
+{
+  if ((!src) || (!window) || (!dest)) {
+    VL_ERROR ("%s: error: one of the parameters is NULL\n", name);
+    return (-1);		/* failure */
+  }
+
+  if (src->format != format) {
+    VL_ERROR ("%s: src image has the wrong format\n", name);
+    return (-1);		/* failure */
+  }
+
+  if (0 > vlImage8Init (dest, destFormat, src->width, src->height)) {
+    VL_ERROR ("%s: error: could not initialize dest image\n", name);
+    return (-1);		/* failure */
+  }
+
+  return (0);			/* success */
+}
+
+
+/* given a RGB picture, return the YUV one */
+int
+vlRgb82Yuv8 (vlImage8 *src, vlWindow *window, vlImage8 *dest)
+{
+  int i, j, x1, x2, r, g, b, red, blue;
+  const vlPixel8 *input;
+  vlPixel8 *output;
+
+  if (0 > _vlYuvConvertPrepare (src, RGB, window, dest, YUV,
+				"vlRgb82Yuv8")) {
+    return (-1);		/* failure */
+  }
+
+  red = VL_IMAGE8_RED (src);
+  blue = VL_IMAGE8_BLUE (src);
+  x1 = window->x;
+  x2 = x1 + window->width;
+  for (j=window->y; j<window->y+window->height; j++) {
+    input = VL_IMAGE8_ROW (src, j) + x1*src->step;
+    output = VL_IMAGE8_ROW (dest, j) + x1*dest->step;
+    for (i=x1; i<x2; i++, input+=src->step, output+=dest->step) {
+      r = input[red];
+      g = input[1];
+      b = input[blue];
+
+      /* the weights of Cb and Cr sum to 0.5, so no clamping is needed */
+      output[0] = (vlPixel8) ((VL_YUV_FIX (0.29900) * r +
+			       VL_YUV_FIX (0.58700) * g +
+			       VL_YUV_FIX (0.11400) * b + VL_YUV_HALF)
+			      >> VL_YUV_SCALEBITS);
+      output[1] = (vlPixel8) ((- VL_YUV_FIX (0.16874) * r
+			       - VL_YUV_FIX (0.33126) * g
+			       + VL_YUV_FIX (0.50000) * b
+			       + VL_YUV_CBCR_OFFSET + VL_YUV_HALF - 1)
+			      >> VL_YUV_SCALEBITS);
+      output[2] = (vlPixel8) ((VL_YUV_FIX (0.50000) * r
+			       - VL_YUV_FIX (0.41869) * g
+			       - VL_YUV_FIX (0.08131) * b
+			       + VL_YUV_CBCR_OFFSET + VL_YUV_HALF - 1)
+			      >> VL_YUV_SCALEBITS);
+    }
+  }
+
+  return (0);			/* success */
+}
+
+
+/* given a YUV picture, return the RGB one (e.g. straight into the view of
+   a display surface). Same values as a JCS_RGB decode by libjpeg */
+int
+vlYuv82Rgb8 (vlImage8 *src, vlWindow *window, vlImage8 *dest)
+{
+  int i, j, x1, x2, y, cb, cr, v, red, blue;
+  const vlPixel8 *input;
+  vlPixel8 *output;
+
+  if (0 > _vlYuvConvertPrepare (src, YUV, window, dest, RGB,
+				"vlYuv82Rgb8")) {
+    return (-1);		/* failure */
+  }
+
+  red = VL_IMAGE8_RED (dest);
+  blue = VL_IMAGE8_BLUE (dest);
+  x1 = window->x;
+  x2 = x1 + window->width;
+  for (j=window->y; j<window->y+window->height; j++) {
+    input = VL_IMAGE8_ROW (src, j) + x1*src->step;
+    output = VL_IMAGE8_ROW (dest, j) + x1*dest->step;
+    for (i=x1; i<x2; i++, input+=src->step, output+=dest->step) {
+      y = input[0];
+      cb = input[1] - 128;
+      cr = input[2] - 128;
+
+      v = y + ((VL_YUV_FIX (1.40200) * cr + VL_YUV_HALF) >> VL_YUV_SCALEBITS);
+      output[red] = (vlPixel8) CLAMP (v, 0, 255);
+      v = y + ((- VL_YUV_FIX (0.34414) * cb - VL_YUV_FIX (0.71414) * cr
+		+ VL_YUV_HALF) >> VL_YUV_SCALEBITS);
+      output[1] = (vlPixel8) CLAMP (v, 0, 255);
+      v = y + ((VL_YUV_FIX (1.77200) * cb + VL_YUV_HALF) >> VL_YUV_SCALEBITS);
+      output[blue] = (vlPixel8) CLAMP (v, 0, 255);
+    }
+  }
+
+  return (0);			/* success */
+}
@@ -1,72 +1,449 @@
+/*****************************************************************************
+ *
+ * FILE:     yuv2rgb.cpp
+ *
+ * ABSTRACT: conversion of raw YUV frames (4:2:0 and 4:2:2, planar or
+ *           packed) to 8-bit RGB, with a SSSE3 kernel and the rows split
+ *           across threads.
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "global.h"
+#include "vislib.h"
+#include "vlCpu.h"
 #include "yuv2rgb.h"
 
-/* lookup tables */
-unsigned int  ng_yuv_gray[256];
-unsigned int  ng_yuv_red[256];
-unsigned int  ng_yuv_blue[256];
-unsigned int  ng_yuv_g1[256];
-unsigned int  ng_yuv_g2[256];
-unsigned int  ng_clip[256 + 2 * CLIP];
+#ifdef VL_X86
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#endif
 
 
-int width=WIDTH;
-int height=HEIGHT;
+/* describe a contiguous frame, see yuv2rgb.h */
+int
+vlYuvFrameSet (vlYuvFrame *frame, vlYuvLayout layout, int width, int height,
+	       const void *data)
+{
+  int cw;
 
+  if ((!frame) || (!data) || (width <= 0) || (height <= 0)) {
+    VL_ERROR ("vlYuvFrameSet: error: illegal parameter\n");
+    return (-1);		/* failure */
+  }
 
-void yuv2rgb_init(void)
+  frame->layout = layout;
+  frame->width = width;
+  frame->height = height;
+  frame->y = (const unsigned char *) data;
+  frame->yStride = width;
+  frame->u = frame->v = NULL;
+  frame->uStride = frame->vStride = 0;
+
+  /* chroma planes have (width+1)/2 columns */
+  cw = (width + 1) / 2;
+  switch (layout) {
+  case VL_YUV_I420:
+    frame->u = frame->y + width*height;
+    frame->v = frame->u + cw*((height + 1) / 2);
+    frame->uStride = frame->vStride = cw;
+    break;
+
+  case VL_YUV_422P:
+    frame->u = frame->y + width*height;
+    frame->v = frame->u + cw*height;
+    frame->uStride = frame->vStride = cw;
+    break;
+
+  case VL_YUV_YUYV:
+  case VL_YUV_UYVY:
+    if (width & 1) {
+      VL_ERROR ("vlYuvFrameSet: error: packed frames have an even width\n");
+      return (-1);		/* failure */
+    }
+    frame->yStride = 2*width;
+    break;
+
+  default:
+    VL_ERROR ("vlYuvFrameSet: error: unknown layout\n");
+    return (-1);		/* failure */
+  }
+
+  return (0);			/* success */
+}
+
+
+vlYuvConverter *
+vlYuvConverterCreate (int bands)
 {
-	int i;
-  
-	/* init Lookup tables */
-	for (i = 0; i < 256; i++) {
-		ng_yuv_gray[i] = i * LUN_MUL >> 8;
-		ng_yuv_red[i]  = (RED_ADD    + i * RED_MUL)    >> 8;
-		ng_yuv_blue[i] = (BLUE_ADD   + i * BLUE_MUL)   >> 8;
-		ng_yuv_g1[i]   = (GREEN1_ADD + i * GREEN1_MUL) >> 8;
-		ng_yuv_g2[i]   = (GREEN2_ADD + i * GREEN2_MUL) >> 8;
-  	}
-  	for (i = 0; i < CLIP; i++)
-    		ng_clip[i] = 0;
-  	for (; i < CLIP + 256; i++)
-    		ng_clip[i] = i - CLIP;
-  	for (; i < 2 * CLIP + 256; i++)
-    		ng_clip[i] = 255;
+  vlYuvConverter *conv;
+
+  if (bands <= 0) {
+    bands = vlThreadCount ();
+  }
+  if (bands > VL_MAX_THREADS) {
+    bands = VL_MAX_THREADS;
+  }
+
+  if (NULL == (conv = (vlYuvConverter *) malloc (sizeof(vlYuvConverter)))) {
+    VL_ERROR ("vlYuvConverterCreate: malloc failed\n");
+    return (NULL);
+  }
+  memset (conv, 0, sizeof(vlYuvConverter));
+  conv->numBands = bands;
+
+  return (conv);
 }
 
-void yuv2rgb (unsigned char* in_addr, vlPixel* out_addr)
+
+void
+vlYuvConverterDestroy (vlYuvConverter *conv)
+{
+  int k;
+
+  if (conv) {
+    for (k=0; k<VL_MAX_THREADS; k++) {
+      VL_FREE (conv->rows[k]);
+    }
+    VL_FREE (conv);
+  }
+}
+
+
+/* n pixels of a planar row, y[i] going with u[i/2] and v[i/2]. Same
+   arithmetic as vlYuv82Rgb8 */
+static void
+_vlYuvRowC (const unsigned char *y, const unsigned char *u,
+	    const unsigned char *v, vlPixel8 *out, int step, int red, int n)
+{
+  int i, cb, cr, val;
+
+  for (i=0; i<n; i++, out+=step) {
+    cb = u[i >> 1] - 128;
+    cr = v[i >> 1] - 128;
+
+    val = y[i] + ((VL_YUV_FIX (1.40200) * cr + VL_YUV_HALF)
+		  >> VL_YUV_SCALEBITS);
+    out[red] = (vlPixel8) CLAMP (val, 0, 255);
+    val = y[i] + ((- VL_YUV_FIX (0.34414) * cb - VL_YUV_FIX (0.71414) * cr
+		   + VL_YUV_HALF) >> VL_YUV_SCALEBITS);
+    out[1] = (vlPixel8) CLAMP (val, 0, 255);
+    val = y[i] + ((VL_YUV_FIX (1.77200) * cb + VL_YUV_HALF)
+		  >> VL_YUV_SCALEBITS);
+    out[2-red] = (vlPixel8) CLAMP (val, 0, 255);
+  }
+}
+
+
+#ifdef VL_X86
+/* (k*a + l*b + half) >> 16 of 8 pairs, exactly as the C code. The
+   constants of _vlYuvRowSSSE3 split every coefficient over a and b so
+   that both halves fit in 16 bits, e.g. 91881*cr = 32767*2cr + 26347*cr */
+VL_TARGET_SSSE3 static inline __m128i
+_vlYuvTerm (__m128i a, __m128i b, __m128i kl)
+{
+  const __m128i half = _mm_set1_epi32 (VL_YUV_HALF);
+  __m128i lo, hi;
+
+  lo = _mm_madd_epi16 (_mm_unpacklo_epi16 (a, b), kl);
+  hi = _mm_madd_epi16 (_mm_unpackhi_epi16 (a, b), kl);
+  lo = _mm_srai_epi32 (_mm_add_epi32 (lo, half), VL_YUV_SCALEBITS);
+  hi = _mm_srai_epi32 (_mm_add_epi32 (hi, half), VL_YUV_SCALEBITS);
+
+  return (_mm_packs_epi32 (lo, hi));
+}
+
+
+/* 16 values of a channel: the luma plus the term of its chroma pair,
+   clamped to 0-255 by the saturating pack */
+VL_TARGET_SSSE3 static inline __m128i
+_vlYuvChannel (__m128i ylo, __m128i yhi, __m128i t)
+{
+  return (_mm_packus_epi16 (_mm_add_epi16 (ylo, _mm_unpacklo_epi16 (t, t)),
+			    _mm_add_epi16 (yhi, _mm_unpackhi_epi16 (t, t))));
+}
+
+
+/* planar row to 3 or 4 byte pixels, 16 at a time. The last pixel is
+   always left to the C code: the 4 byte stores write (back) the byte
+   after the channels, which is past the end of the row for it.
+   Returns the number of pixels done */
+VL_TARGET_SSSE3 static int
+_vlYuvRowSSSE3 (const unsigned char *y, const unsigned char *u,
+		const unsigned char *v, vlPixel8 *out, int step, int red,
+		int n)
 {
-	unsigned char *y,*u,*v;
-	unsigned char *us,*vs;
-	vlPixel *dp, *d;
-	int i,j,gray;
-  
-  	dp = out_addr;
- 	y  = (unsigned char *)in_addr;
-	u  = y + width * height;
-	v  = u + width * height / 4;
-	for (i = 0; i < height; i++) {
-		d = dp;
-		us = u; vs = v;
-		for (j = 0; j < width; j+=2) {
-      		gray   = Gray(*y);
-      		*(d++) = Red(gray,*v);
-			*(d++) = Green(gray,*v,*u);
-			*(d++) = Blue(gray,*u);
-
-			y++;
-			gray   = Gray(*y);
-			*(d++) = Red(gray,*v);
-			*(d++) = Green(gray,*v,*u);
-			*(d++) = Blue(gray,*u);
-
-			y++; u++; v++;
-		}
-		if (0 == (i % 2)) {
-			u = us; v = vs;
-		}
-		dp += (width*3);
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128i c128 = _mm_set1_epi16 (128);
+  const __m128i kR = _mm_setr_epi16 (32767, 26347, 32767, 26347,
+				     32767, 26347, 32767, 26347);
+  const __m128i kG = _mm_setr_epi16 (-22554, -23401, -22554, -23401,
+				     -22554, -23401, -22554, -23401);
+  const __m128i kB = _mm_setr_epi16 (29032, 2, 29032, 2, 29032, 2, 29032, 2);
+  const __m128i keep = _mm_set1_epi32 ((int) 0xFF000000);
+  /* byte k of the 48 of 16 pixels is channel k%3 of pixel k/3 */
+  const __m128i m00 = _mm_setr_epi8 (0, -128, -128, 1, -128, -128, 2, -128,
+				     -128, 3, -128, -128, 4, -128, -128, 5);
+  const __m128i m01 = _mm_setr_epi8 (-128, 0, -128, -128, 1, -128, -128, 2,
+				     -128, -128, 3, -128, -128, 4, -128, -128);
+  const __m128i m02 = _mm_setr_epi8 (-128, -128, 0, -128, -128, 1, -128, -128,
+				     2, -128, -128, 3, -128, -128, 4, -128);
+  const __m128i m10 = _mm_setr_epi8 (-128, -128, 6, -128, -128, 7, -128, -128,
+				     8, -128, -128, 9, -128, -128, 10, -128);
+  const __m128i m11 = _mm_setr_epi8 (5, -128, -128, 6, -128, -128, 7, -128,
+				     -128, 8, -128, -128, 9, -128, -128, 10);
+  const __m128i m12 = _mm_setr_epi8 (-128, 5, -128, -128, 6, -128, -128, 7,
+				     -128, -128, 8, -128, -128, 9, -128, -128);
+  const __m128i m20 = _mm_setr_epi8 (-128, 11, -128, -128, 12, -128, -128, 13,
+				     -128, -128, 14, -128, -128, 15, -128, -128);
+  const __m128i m21 = _mm_setr_epi8 (-128, -128, 11, -128, -128, 12, -128,
+				     -128, 13, -128, -128, 14, -128, -128, 15,
+				     -128);
+  const __m128i m22 = _mm_setr_epi8 (10, -128, -128, 11, -128, -128, 12,
+				     -128, -128, 13, -128, -128, 14, -128,
+				     -128, 15);
+  __m128i yv, ylo, yhi, cb, cr, r, g, b, c0, c2, lo, hi, p;
+  __m128i *dst;
+  int i, k;
+
+  for (i=0; i+16<n; i+=16) {
+    yv = _mm_loadu_si128 ((const __m128i *) (y + i));
+    ylo = _mm_unpacklo_epi8 (yv, zero);
+    yhi = _mm_unpackhi_epi8 (yv, zero);
+    cb = _mm_loadl_epi64 ((const __m128i *) (u + (i >> 1)));
+    cr = _mm_loadl_epi64 ((const __m128i *) (v + (i >> 1)));
+    cb = _mm_sub_epi16 (_mm_unpacklo_epi8 (cb, zero), c128);
+    cr = _mm_sub_epi16 (_mm_unpacklo_epi8 (cr, zero), c128);
+
+    r = _vlYuvChannel (ylo, yhi, _vlYuvTerm (_mm_add_epi16 (cr, cr), cr, kR));
+    g = _vlYuvChannel (ylo, yhi, _vlYuvTerm (cb, _mm_add_epi16 (cr, cr), kG));
+    b = _vlYuvChannel (ylo, yhi,
+		       _vlYuvTerm (_mm_slli_epi16 (cb, 2), cb, kB));
+
+    /* channels in memory order */
+    c0 = red ? b : r;
+    c2 = red ? r : b;
+
+    dst = (__m128i *) (out + i*step);
+    if (step == 3) {
+      _mm_storeu_si128 (dst, _mm_or_si128 (_mm_or_si128 (
+			  _mm_shuffle_epi8 (c0, m00),
+			  _mm_shuffle_epi8 (g, m01)),
+			  _mm_shuffle_epi8 (c2, m02)));
+      _mm_storeu_si128 (dst + 1, _mm_or_si128 (_mm_or_si128 (
+			  _mm_shuffle_epi8 (c0, m10),
+			  _mm_shuffle_epi8 (g, m11)),
+			  _mm_shuffle_epi8 (c2, m12)));
+      _mm_storeu_si128 (dst + 2, _mm_or_si128 (_mm_or_si128 (
+			  _mm_shuffle_epi8 (c0, m20),
+			  _mm_shuffle_epi8 (g, m21)),
+			  _mm_shuffle_epi8 (c2, m22)));
+    }
+    else {
+      /* 4 byte pixels, the fourth byte is kept */
+      lo = _mm_unpacklo_epi8 (c0, g);
+      hi = _mm_unpackhi_epi8 (c0, g);
+      for (k=0; k<4; k++) {
+	switch (k) {
+	case 0:
+	  p = _mm_unpacklo_epi16 (lo, _mm_unpacklo_epi8 (c2, zero));
+	  break;
+	case 1:
+	  p = _mm_unpackhi_epi16 (lo, _mm_unpacklo_epi8 (c2, zero));
+	  break;
+	case 2:
+	  p = _mm_unpacklo_epi16 (hi, _mm_unpackhi_epi8 (c2, zero));
+	  break;
+	default:
+	  p = _mm_unpackhi_epi16 (hi, _mm_unpackhi_epi8 (c2, zero));
+	  break;
 	}
+	p = _mm_or_si128 (p, _mm_and_si128 (_mm_loadu_si128 (dst + k), keep));
+	_mm_storeu_si128 (dst + k, p);
+      }
+    }
+  }
+
+  return (i);
+}
+#endif /* VL_X86 */
+
+
+/* planar row pointers of row j, packed rows being split into buf */
+static void
+_vlYuvFrameRow (vlYuvFrame *frame, int j, unsigned char *buf,
+		const unsigned char **y, const unsigned char **u,
+		const unsigned char **v)
+{
+  const unsigned char *row;
+  unsigned char *yo, *uo, *vo;
+  int i, n, cy;
+
+  switch (frame->layout) {
+  case VL_YUV_I420:
+    *y = frame->y + j*frame->yStride;
+    *u = frame->u + (j >> 1)*frame->uStride;
+    *v = frame->v + (j >> 1)*frame->vStride;
+    break;
+
+  case VL_YUV_422P:
+    *y = frame->y + j*frame->yStride;
+    *u = frame->u + j*frame->uStride;
+    *v = frame->v + j*frame->vStride;
+    break;
+
+  default:
+    /* YUYV has Y0 U Y1 V, UYVY U Y0 V Y1 */
+    row = frame->y + j*frame->yStride;
+    n = frame->width / 2;
+    cy = (frame->layout == VL_YUV_YUYV) ? 0 : 1;
+    yo = buf;
+    uo = buf + frame->width;
+    vo = uo + n;
+    for (i=0; i<n; i++, row+=4) {
+      yo[2*i] = row[cy];
+      yo[2*i+1] = row[cy+2];
+      uo[i] = row[1-cy];
+      vo[i] = row[3-cy];
+    }
+    *y = yo;
+    *u = uo;
+    *v = vo;
+    break;
+  }
+}
+
+
+/* convert the rows of band index */
+static void
+_vlYuvBand (void *arg, int index)
+{
+  vlYuvConverter *conv = (vlYuvConverter *) arg;
+  vlYuvFrame *frame = conv->frame;
+  vlImage8 *dest = conv->dest;
+  const unsigned char *y, *u, *v;
+  vlPixel8 *out;
+  int j, done, red;
+
+  red = VL_IMAGE8_RED (dest);
+  for (j=conv->first[index]; j<conv->first[index+1]; j++) {
+    _vlYuvFrameRow (frame, j, conv->rows[index], &y, &u, &v);
+    out = VL_IMAGE8_ROW (dest, j);
 
+    done = 0;
+#ifdef VL_X86
+    if (conv->simd) {
+      done = _vlYuvRowSSSE3 (y, u, v, out, dest->step, red, frame->width);
+    }
+#endif
+    /* done is even, so the chroma of the rest starts at done/2 */
+    _vlYuvRowC (y + done, u + done/2, v + done/2, out + done*dest->step,
+		dest->step, red, frame->width - done);
+  }
 }
 
+
+/******************************************************************************
+ *
+ * vlYuvConvert --
+ *	convert a raw YUV frame to RGB. dest is initialized as RGB of the
+ *      frame size, so a view of that size (e.g. a SDL surface) is written
+ *      in place, in its channel order. The bands of rows are converted in
+ *      parallel.
+ *
+ * RETURNS:
+ *   On success, 0 is returned. Otherwise, -1.
+ *
+ *****************************************************************************/
+int
+vlYuvConvert (vlYuvConverter *conv, vlYuvFrame *frame, vlImage8 *dest)
+{
+  int k, bands;
+  unsigned char *row;
+
+  if ((!conv) || (!frame) || (!dest)) {
+    VL_ERROR ("vlYuvConvert: error: one of the parameters is NULL\n");
+    return (-1);		/* failure */
+  }
+
+  if ((frame->width <= 0) || (frame->height <= 0) || (!frame->y) ||
+      (((frame->layout == VL_YUV_I420) || (frame->layout == VL_YUV_422P)) &&
+       ((!frame->u) || (!frame->v))) ||
+      (((frame->layout == VL_YUV_YUYV) || (frame->layout == VL_YUV_UYVY)) &&
+       (frame->width & 1))) {
+    VL_ERROR ("vlYuvConvert: error: illegal frame\n");
+    return (-1);		/* failure */
+  }
+
+  if (0 > vlImage8Init (dest, RGB, frame->width, frame->height)) {
+    VL_ERROR ("vlYuvConvert: error: could not initialize dest image\n");
+    return (-1);		/* failure */
+  }
+
+  /* cut in bands of equal height, at least one row each */
+  bands = VL_MIN (conv->numBands, frame->height);
+  if (bands < 1) {
+    bands = 1;
+  }
+  for (k=0; k<=bands; k++) {
+    conv->first[k] = (int) ((long) frame->height * k / bands);
+  }
+
+  /* packed rows are split into the row buffer of their band */
+  if (((frame->layout == VL_YUV_YUYV) || (frame->layout == VL_YUV_UYVY)) &&
+      (conv->width < frame->width)) {
+    for (k=0; k<conv->numBands; k++) {
+      row = (unsigned char *) realloc (conv->rows[k], 2*frame->width);
+      if (!row) {
+	VL_ERROR ("vlYuvConvert: malloc failed\n");
+	return (-1);		/* failure */
+      }
+      conv->rows[k] = row;
+    }
+    conv->width = frame->width;
+  }
+
+  conv->frame = frame;
+  conv->dest = dest;
+  conv->simd = (vlCpuFeatures () & VL_CPU_SSSE3) &&
+	       ((dest->step == 3) || (dest->step == 4));
+
+  if (bands == 1) {
+    _vlYuvBand (conv, 0);
+  }
+  else if (0 > vlThreadRun (bands, _vlYuvBand, conv)) {
+    return (-1);		/* failure */
+  }
+
+  conv->frame = NULL;
+  conv->dest = NULL;
+
+  return (0);			/* success */
+}
+
+
+/* nothing to set up, the converters have no global state */
+void yuv2rgb_init(void)
+{
+}
+
+
+/* WIDTH x HEIGHT I420 frame at in_addr into the RGB vlPixels at out_addr */
+void yuv2rgb (unsigned char* in_addr, vlPixel* out_addr)
+{
+	vlYuvFrame frame;
+	const unsigned char *y, *u, *v;
+	vlPixel8 row[VL_RGB_PIXEL*WIDTH];
+	int i, j;
+
+	vlYuvFrameSet(&frame, VL_YUV_I420, WIDTH, HEIGHT, in_addr);
+	for (j = 0; j < HEIGHT; j++) {
+		_vlYuvFrameRow(&frame, j, NULL, &y, &u, &v);
+		_vlYuvRowC(y, u, v, row, VL_RGB_PIXEL, 0, WIDTH);
+		for (i = 0; i < VL_RGB_PIXEL*WIDTH; i++)
+			*(out_addr++) = row[i];
+	}
+}
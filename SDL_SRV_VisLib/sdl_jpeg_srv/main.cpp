@@ -16,12 +16,19 @@
 //̬⵼
 #pragma comment(lib,"..\\..\\SDL_SRV_VisLib\\VisLib_win\\lib\\VisLib_win.lib") 
 
-static int	vision_working(Surveyor &robot, PicFrame &frame, blob *obj)
+//color bin of the robot the YCbCr pipeline thresholds against (see
+//VirtSurveyor::getBin), -1 for the HSI pipeline and para.txt
+#define YUV_BIN		-1
+
+static int	vision_working(Surveyor &robot, PicFrame &frame, vlYuvRange *range, blob *obj)
 {
 	int ret;
 	robot.takePhoto();
 
-	ret=frame.processing(robot.getPhoto(), robot.getPhotoSize(), obj);
+	if(range)
+		ret=frame.processingYuv(robot.getPhoto(), robot.getPhotoSize(), range, obj);
+	else
+		ret=frame.processing(robot.getPhoto(), robot.getPhotoSize(), obj);
 	return ret;
 }
 
@@ -71,6 +78,8 @@ int _tmain(int argc, _TCHAR* argv[])
 	PID pid;
 
 	blob obj;
+	YUVRange bin;
+	vlYuvRange yuv_range, *range = NULL;
 
 	if(pid.init()<0)
 	{
@@ -91,6 +100,21 @@ int _tmain(int argc, _TCHAR* argv[])
 	printf("SVR-1 version %s\n", buf);
 	robot.setVideoMode(1);
 
+	//the robot's own bin, so host and robot see the same color
+	if(YUV_BIN >= 0)
+	{
+		if(!robot.getBin(YUV_BIN, bin))
+		{
+			printf("color bin %d cannot be read.\n", YUV_BIN);
+			return -1;
+		}
+		bin.getY(yuv_range.y_min, yuv_range.y_max);
+		bin.getU(yuv_range.u_min, yuv_range.u_max);
+		bin.getV(yuv_range.v_min, yuv_range.v_max);
+		printf("%s\n", bin.say());
+		range = &yuv_range;
+	}
+
 
 	//
 	//robot.drive(60,60,1000);
@@ -100,7 +124,7 @@ int _tmain(int argc, _TCHAR* argv[])
 	while(1)
 	{
 		//vision
-		if(vision_working(robot, frame, &obj)<0)
+		if(vision_working(robot, frame, range, &obj)<0)
 		{
 			robot.drive(0,0,0);
 			printf("system is exiting now.\n");
@@ -2,6 +2,14 @@
 #include "picframe.h"
 #include "vislib.h"
 
+//libjpeg of the sdl_robot_jpeg project, for the YCbCr pipeline
+#include <stdio.h>
+#include <setjmp.h>
+extern "C" {
+#include "../../sdl_robot_jpeg/sdl_test/jpeglib.h"
+}
+#pragma comment(lib,"..\\..\\sdl_robot_jpeg\\sdl_test\\libjpeg.lib")
+
 
 PicFrame::PicFrame()
 {
@@ -23,8 +31,8 @@ PicFrame::PicFrame()
 	}
 
 	image=image_dup=NULL;
-
-	pixels= (unsigned char*)malloc(width*height*3);//rgb dataflow
+	ycc=NULL;
+	yccSize=0;
 }
 
 SDL_Surface *PicFrame::getImage()
@@ -38,11 +46,12 @@ PicFrame::~PicFrame()
 		SDL_FreeSurface(image);
 	if(image_dup)
 		SDL_FreeSurface(image_dup);
-	if(pixels)
-		free(pixels);
+	if(ycc)
+		delete[] ycc;
 }
 
-int PicFrame::processing(void *mem, int size, blob *obj)
+//returns -1 when the window is closed or escape is pressed
+int PicFrame::pollEvents()
 {
 	SDL_Event	event;
 
@@ -60,17 +69,12 @@ int PicFrame::processing(void *mem, int size, blob *obj)
 			break;
 		}
 	}
+	return 0;
+}
 
-	SDL_Surface *temp;
-
-	//read the image from jpeg dataflow
-	temp = IMG_LoadJPG_RW(SDL_RWFromMem(mem, size));
-
-	if(image)
-		SDL_FreeSurface(image);
-	image = SDL_DisplayFormat(temp);
-	SDL_FreeSurface(temp);
-
+//show the frame at (0,0) and the result at (0,240)
+void PicFrame::show()
+{
 	SDL_Rect src, dest;
  
 	src.x = 0;
@@ -78,60 +82,52 @@ int PicFrame::processing(void *mem, int size, blob *obj)
 	src.w = image->w;
 	src.h = image->h;
 
-	//at (0,0) show the original image
 	dest.x = 0;
 	dest.y = 0;
 	dest.w = image->w;
 	dest.h = image->h;
 	SDL_BlitSurface(image, &src, screen, &dest);
 
-	//duplicate the origial image surface
-	if(image_dup)
+	dest.x = 0;
+	dest.y = height;
+	SDL_BlitSurface(image_dup, &src, screen, &dest);	
+	SDL_Flip(screen);
+}
+
+//surface the result is drawn into, only made again if the frame size
+//changes: the processing writes all of its pixels in place
+void PicFrame::makeImageDup()
+{
+	if(image_dup && (image_dup->w!=image->w || image_dup->h!=image->h))
+	{
 		SDL_FreeSurface(image_dup);
-	image_dup=SDL_ConvertSurface(image, screen->format, 0);
+		image_dup=NULL;
+	}
+	if(!image_dup)
+		image_dup=SDL_ConvertSurface(image, screen->format, 0);
+}
 
-	//process
-	visLibProcess(image, image_dup, obj);
+int PicFrame::processing(void *mem, int size, blob *obj)
+{
+	if(pollEvents()<0)
+		return -1;
 
-	//process the duplicated image
-	unsigned char *p = pixels;
-	unsigned char *ptrData=(unsigned char*)image_dup->pixels;
-	unsigned char *ptrDataEnd=(unsigned char*)image_dup->pixels+width*height*bpp;
+	SDL_Surface *temp;
 
-	//pixels is RGB dataflow
-	while(ptrData < ptrDataEnd)
-	{
-		*(p) = *(ptrData+2); 
-		*(p+1) = *(ptrData+1); 
-		*(p+2)  = *(ptrData);
-		
-		ptrData+=bpp;
-		p+=3;
-	}
+	//read the image from jpeg dataflow
+	temp = IMG_LoadJPG_RW(SDL_RWFromMem(mem, size));
 
-	//update the duplicatecd with pixels after processed
-	p = pixels;
-	ptrData=(unsigned char*)image_dup->pixels;
-	ptrDataEnd=(unsigned char*)image_dup->pixels+width*height*bpp;
+	if(image)
+		SDL_FreeSurface(image);
+	image = SDL_DisplayFormat(temp);
+	SDL_FreeSurface(temp);
 
-	//pixels is RGB dataflow
-	while(ptrData < ptrDataEnd)
-	{
-		*(ptrData+2)=*p;
-		*(ptrData+1)=*(p+1);
-		*(ptrData)=*(p+2);
-		
-		ptrData+=bpp;
-		p+=3;
-	}
+	makeImageDup();
 
-	//at (0,240) show the duplicated image
-	dest.x = 0;
-	dest.y = height;
-	dest.w = image->w;
-	dest.h = image->h;
-	SDL_BlitSurface(image_dup, &src, screen, &dest);	
-	SDL_Flip(screen);
+	//process
+	visLibProcess(image, image_dup, obj);
+
+	show();
 
 	
 	/*
@@ -160,3 +156,107 @@ int PicFrame::processing(void *mem, int size, blob *obj)
 	*/	
 	return 0;
 }
+
+
+//libjpeg error manager returning to decodeYuv instead of the exit() of
+//the default one, so that a corrupt frame is only dropped
+struct PicFrameJpegError
+{
+	struct jpeg_error_mgr pub;
+	jmp_buf jump;
+};
+
+static void picFrameJpegErrorExit(j_common_ptr cinfo)
+{
+	PicFrameJpegError *err=(PicFrameJpegError*)cinfo->err;
+
+	(*cinfo->err->output_message)(cinfo);
+	longjmp(err->jump, 1);
+}
+
+
+//decode the JPEG in mem as YCbCr into ycc (Y, Cb, Cr bytes, rows packed),
+//without the conversion to RGB. Returns -1 if it is not a color JPEG or
+//libjpeg fails on it
+int PicFrame::decodeYuv(void *mem, int size, int *w, int *h)
+{
+	struct jpeg_decompress_struct cinfo;
+	PicFrameJpegError jerr;
+	JSAMPROW row_pointer[1];
+
+	cinfo.err = jpeg_std_error(&jerr.pub);
+	jerr.pub.error_exit = picFrameJpegErrorExit;
+	if(setjmp(jerr.jump))
+	{
+		jpeg_destroy_decompress(&cinfo);
+		return -1;
+	}
+	jpeg_create_decompress(&cinfo);
+
+	jpeg_mem_src(&cinfo, (unsigned char*)mem, size);
+	jpeg_read_header(&cinfo, TRUE);
+	if(cinfo.num_components!=3)
+	{
+		jpeg_destroy_decompress(&cinfo);
+		return -1;
+	}
+	cinfo.out_color_space = JCS_YCbCr;
+	jpeg_start_decompress(&cinfo);
+
+	//the buffer is only reallocated when the frame gets bigger
+	*w=cinfo.output_width;
+	*h=cinfo.output_height;
+	if(yccSize < 3*(*w)*(*h))
+	{
+		if(ycc)
+			delete[] ycc;
+		yccSize=3*(*w)*(*h);
+		ycc=new unsigned char[yccSize];
+	}
+
+	while (cinfo.output_scanline < cinfo.output_height)
+	{
+	   row_pointer[0] = &ycc[cinfo.output_scanline*3*(*w)];
+	   jpeg_read_scanlines(&cinfo,row_pointer, 1);
+	}
+
+	jpeg_finish_decompress(&cinfo);
+	jpeg_destroy_decompress(&cinfo);
+	return 0;
+}
+
+//YCbCr pipeline: the frame is thresholded against the color bin range
+//as decoded, only the display gets RGB
+int PicFrame::processingYuv(void *mem, int size, vlYuvRange *range, blob *obj)
+{
+	int w, h;
+
+	if(pollEvents()<0)
+		return -1;
+
+	if(decodeYuv(mem, size, &w, &h)<0)
+	{
+		obj->valid=-1;
+		return 0;
+	}
+
+	//surface of the display format the frame is converted into
+	if(image && (image->w!=w || image->h!=h))
+	{
+		SDL_FreeSurface(image);
+		image=NULL;
+	}
+	if(!image)
+		image=SDL_CreateRGBSurface(SDL_SWSURFACE, w, h,
+				screen->format->BitsPerPixel, screen->format->Rmask,
+				screen->format->Gmask, screen->format->Bmask,
+				screen->format->Amask);
+
+	makeImageDup();
+
+	//process
+	visLibProcessYuv(ycc, w, h, range, image, image_dup, obj);
+
+	show();
+	return 0;
+}
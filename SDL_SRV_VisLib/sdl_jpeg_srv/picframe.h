@@ -14,12 +14,19 @@ class	PicFrame
 
 	SDL_Surface *image_dup;
 
-	unsigned char* pixels;
+	//decoded YCbCr frame of the YCbCr pipeline
+	unsigned char *ycc;
+	int yccSize;
 
 	int bpp;
 	int width;
 	int height;
 
+	int	pollEvents();
+	void	show();
+	void	makeImageDup();
+	int	decodeYuv(void *, int, int *, int *);
+
   public:
 	PicFrame();
 	~PicFrame();
@@ -27,5 +34,6 @@ class	PicFrame
 	SDL_Surface *getImage();
 
 	int	processing(void *, int, blob*);
+	int	processingYuv(void *, int, vlYuvRange *, blob*);
 };
 #endif
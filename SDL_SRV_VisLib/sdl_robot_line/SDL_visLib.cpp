@@ -6,43 +6,39 @@
 #include "vlUtility.h"
 #include "pid.h"
 
-static void SDLSurface2vlImage(SDL_Surface *sdl_image, vlImage *vl_image)
-{	
-	vlPixel *p = (vlPixel *)vl_image->pixel;
-	unsigned char *ptrData=(unsigned char*)sdl_image->pixels;
-	unsigned char *ptrDataEnd=(unsigned char*)sdl_image->pixels+sdl_image->h*sdl_image->w*3;
-
-	//pixels is RGB dataflow
-	while(ptrData < ptrDataEnd)
+//make vl_image a view over the pixels of a locked surface: VisLib reads
+//and writes the surface memory in place, whatever its pitch and its byte
+//order, instead of copying the frame in and out
+static int SDLSurfaceWrap(SDL_Surface *sdl_image, vlImage8 *vl_image)
+{
+	SDL_PixelFormat *fmt=sdl_image->format;
+	int bpp=fmt->BytesPerPixel;
+	int r, g, b;
+
+	if(bpp!=3 && bpp!=4)
+		return -1;
+
+	//byte offset of each channel within a pixel
+	r=fmt->Rshift/8;
+	g=fmt->Gshift/8;
+	b=fmt->Bshift/8;
+	if(SDL_BYTEORDER==SDL_BIG_ENDIAN)
 	{
-		*p++ = *(ptrData+2); 
-		*p++ = *(ptrData+1); 
-		*p++  = *(ptrData);
-		
-		ptrData+=3;
+		r=bpp-1-r;
+		g=bpp-1-g;
+		b=bpp-1-b;
 	}
-}
 
+	//VisLib wants the green byte between the red and blue ones
+	if(g<1 || !((r==g-1 && b==g+1) || (b==g-1 && r==g+1)))
+		return -1;
 
-static void vlImage2SDLSurface(vlImage *vl_image, SDL_Surface *sdl_image)
-{
-	
-	//update the duplicatecd with pixels after processed
-	vlPixel *p = vl_image->pixel;
-	unsigned char *ptrData=(unsigned char*)sdl_image->pixels;
-	unsigned char *ptrDataEnd=(unsigned char*)sdl_image->pixels+sdl_image->h*sdl_image->w*3;
-
-	//pixels is RGB dataflow
-	while(ptrData < ptrDataEnd)
-	{
-		*(ptrData+2)=(unsigned char)*p++;
-		*(ptrData+1)=(unsigned char)*p++;
-		*(ptrData)=(unsigned char)*p++;
-		
-		ptrData+=3;
-	}	
+	return vlImage8Wrap(vl_image, RGB, sdl_image->w, sdl_image->h,
+			    (unsigned char*)sdl_image->pixels+g-1, sdl_image->pitch, bpp,
+			    (r<b) ? VL_ORDER_RGB : VL_ORDER_BGR);
 }
 
+
 static void filterProcess(vlImage *vl_src)
 {
   vlImage *pic1=vl_src;
@@ -84,59 +80,71 @@ static void gridProcess(vlImage *pic,int gridType)
 }
 
 
-static int vlDealBinPic(vlImage *src,vlHSI_carl_tol_t *para,vlImage *dest)
+static int vlDealBinPic(vlImage8 *src,vlHSI_carl_tol_t *para,vlImage8 *dest)
 {
    
+   static vlMorphScratch *scratch=NULL;
+   static vlColorTable *table=NULL;
    vlWindow *window= vlWindowCreate (0, 0, src->width, src->height);
    
+   if (!scratch)
+      scratch = vlMorphScratchCreate ();
+
+   //the color table is only rebuilt when para changes
+   if (!table)
+      table = vlColorTableCreate (8);
+
    //vlRgb2Binary_tol(src,para,window,dest); 
-   vlBinary(src,para, dest);
-   vlBinaryOpen(dest,3,2,window);
-   vlBinaryClose(dest,3,2,window);
+   if (table && (0 == vlColorTableSet (table, para)))
+      vlBinaryTable8(src, table, dest);
+   else
+      vlBinary8(src,para, dest);
+   vlBinary8Open(dest,3,2,window,scratch);
+   vlBinary8Close(dest,3,2,window,scratch);
    
    vlWindowDestroy(window);
    return (0);
 }
 
 
-static void findMaxBlob(vlImage *img, blob *obj)
-{	
-	int id;
-	int totalblobs=0;
-	blob blobs[BLOB_MAX_NUM];
-	
-	vlHSI_carl_tol_t *para=(vlHSI_carl_tol_t *)malloc(sizeof(vlHSI_carl_tol_t));
+//same as vlDealBinPic, for a YCbCr frame and a color bin of the robot
+static int vlDealBinPicYuv(vlImage8 *src,vlYuvRange *range,vlImage8 *dest)
+{
+   static vlMorphScratch *scratch=NULL;
+   vlWindow *window= vlWindowCreate (0, 0, src->width, src->height);
 
-	vlImage *dest=vlImageCreate(GRAY, img->width, img->height);
+   if (!scratch)
+      scratch = vlMorphScratchCreate ();
 
-	//HSI threshold parameters
-	load_sample_hsi_carl_params(para);
+   vlBinaryYuv8(src, range, dest);
+   vlBinary8Open(dest,3,2,window,scratch);
+   vlBinary8Close(dest,3,2,window,scratch);
 
-	memset(blobs, 0, sizeof(blob)*BLOB_MAX_NUM);
-	
-	vlImageSave(img, "original.ppm");
+   vlWindowDestroy(window);
+   return (0);
+}
 
-	vlDealBinPic(img,para,dest);
 
-	vlImageSave(dest, "binary.ppm");
-	
-	/* find all blobs */
-	totalblobs=vlFindAllBlobs(dest,  blobs);
-	printf ("There are %d blobs.\n", totalblobs);
+//find the largest blob of the binary image dest and draw dest into display
+static void labelMaxBlob(vlImage8 *dest, vlImage8 *display, blob *obj)
+{
+	int found;
+	blob maxblob;
+	static vlLabeler *labeler=NULL;
 
-	//the result image are copyed into img from dest
-	vlImageSave(dest, "blobs.ppm");
+	vlWindow *window=vlWindowCreate(0, 0, dest->width, dest->height);
 
-	vlPixel *ptrData=img->pixel;
-	vlPixel *ptrDataEnd=img->pixel+img->height*img->width*3;
-	vlPixel *ptrDest=dest->pixel;
-	while(ptrData < ptrDataEnd)
-	{
-		*ptrData++ = *ptrDest;
-		*ptrData++ = *ptrDest;
-		*ptrData++ = *ptrDest++;
-	}
-	if(!totalblobs)
+	//the labeler keeps its buffers from frame to frame
+	if(!labeler)
+		labeler=vlLabelerCreate();
+
+	/* find the largest blob, dest keeps the binary image */
+	found=vlFindLargestBlobs8(labeler, dest, 1, 0, &maxblob);
+	printf ("There are %d blobs.\n", labeler->numBlobs);
+
+	//the binary image is written straight into the display surface
+	vlBinary82Rgb8(dest, window, display);
+	if(found<=0)
 	{ 
 		/*not exist any blob*/
 		VL_ERROR("vlFindBlobs: not exist any blob \n");
@@ -144,50 +152,136 @@ static void findMaxBlob(vlImage *img, blob *obj)
 	}
 	else
 	{
-		/*get the max area blob*/
-		id=vlGetMaxAreaBlob(totalblobs, blobs);
+		//centroid, bbox and orientation come with the labeling
+		printf ("Blob valid %d area %d TL %d %d Xbaric %d Ybaric %d\n",
+	                maxblob.valid,
+	                maxblob.area,
+	                maxblob.topleft/dest->width,
+	                maxblob.topleft%dest->width,
+	                maxblob.xcentroid,
+	                maxblob.ycentroid);//y is horztial, x is vertical
 
-		centroid(dest, id, blobs);
-		printf ("Blob # %d valid %d area %d TL %d %d Xbaric %d Ybaric %d\n",id,
-	                blobs[id].valid,
-	                blobs[id].area,
-	                blobs[id].topleft/dest->width,
-	                blobs[id].topleft%dest->width,
-	                blobs[id].xcentroid,
-	                blobs[id].ycentroid);//y is horztial, x is vertical
 
+		*obj=maxblob;
 
-		obj->valid= blobs[id].valid;
-		obj->area=blobs[id].area;
-		obj->topleft=blobs[id].topleft;
-		obj->xcentroid=blobs[id].xcentroid;
-		obj->ycentroid=blobs[id].ycentroid;
 
-
-		//vlMarkCentroid(img, blobs, id);
-		/*get all blobs information*/
-		//vlDumpAllBlobs(totalblobs, blobs, dest);
+		//vlMarkCentroid(img, &maxblob, 0);
 	}
+	vlWindowDestroy(window);
+}
+
+
+static void findMaxBlob(vlImage8 *img, vlImage8 *display, blob *obj)
+{	
+	static vlImage8 *dest=NULL;
+	
+	vlHSI_carl_tol_t *para=(vlHSI_carl_tol_t *)malloc(sizeof(vlHSI_carl_tol_t));
+
+	//HSI threshold parameters
+	load_sample_hsi_carl_params(para);
+
+	//the binary image keeps its buffer from frame to frame
+	if(!dest)
+		dest=vlImage8Create(BINARY, img->width, img->height);
+	
+	vlImage8Save(img, "original.ppm");
+
+	vlDealBinPic(img,para,dest);
+
+	vlImage8Save(dest, "binary.ppm");
+
+	labelMaxBlob(dest, display, obj);
 	free(para);
-	vlImageDestroy(dest);
 }
 
 
+//sdl_src is processed where it is and the result drawn into sdl_dest,
+//which must have the size of sdl_src
 void visLibProcess(SDL_Surface *sdl_src, SDL_Surface *sdl_dest, blob *obj)
 {
-	vlImage *vl_src;
+	static vlImage8 *vl_src=NULL, *vl_dest=NULL;
 
-	vl_src=vlImageCreate(RGB, sdl_src->w,sdl_src->h);
-	SDLSurface2vlImage(sdl_src, vl_src);
+	if(!vl_src)
+		vl_src=vlImage8Create(NONE, 0, 0);
+	if(!vl_dest)
+		vl_dest=vlImage8Create(NONE, 0, 0);
 
-//	filterProcess(vl_src);
-//	gridProcess(vl_src, FINE);
+	if(SDL_MUSTLOCK(sdl_src))
+		SDL_LockSurface(sdl_src);
+	if(SDL_MUSTLOCK(sdl_dest))
+		SDL_LockSurface(sdl_dest);
 
+	if(0 == SDLSurfaceWrap(sdl_src, vl_src) &&
+	   0 == SDLSurfaceWrap(sdl_dest, vl_dest))
+	{
+//		filterProcess(vl_src);
+//		gridProcess(vl_src, FINE);
 
-	findMaxBlob(vl_src,obj);	
+		findMaxBlob(vl_src, vl_dest, obj);
+	}
+	else
+	{
+		VL_ERROR("visLibProcess: unsupported surface format\n");
+		obj->valid=-1;
+	}
 
-	vlImage2SDLSurface(vl_src, sdl_dest);
-	vlImageDestroy(vl_src);
+	if(SDL_MUSTLOCK(sdl_dest))
+		SDL_UnlockSurface(sdl_dest);
+	if(SDL_MUSTLOCK(sdl_src))
+		SDL_UnlockSurface(sdl_src);
 }
 
 
+//YCbCr pipeline: ycc is a decoded frame (Y, Cb, Cr bytes, rows packed),
+//thresholded as it is against range. It is only converted to RGB for the
+//display, into sdl_src; the result is drawn into sdl_dest. Both surfaces
+//must have the size of the frame
+void visLibProcessYuv(unsigned char *ycc, int width, int height,
+		      vlYuvRange *range, SDL_Surface *sdl_src,
+		      SDL_Surface *sdl_dest, blob *obj)
+{
+	static vlImage8 *vl_ycc=NULL, *vl_src=NULL, *vl_dest=NULL, *bin=NULL;
+	vlWindow *window;
+
+	if(!vl_ycc)
+		vl_ycc=vlImage8Create(NONE, 0, 0);
+	if(!vl_src)
+		vl_src=vlImage8Create(NONE, 0, 0);
+	if(!vl_dest)
+		vl_dest=vlImage8Create(NONE, 0, 0);
+	if(!bin)
+		bin=vlImage8Create(BINARY, width, height);
+
+	if(0 > vlImage8Wrap(vl_ycc, YUV, width, height, ycc, 3*width, 3,
+			    VL_ORDER_RGB))
+	{
+		obj->valid=-1;
+		return;
+	}
+
+	if(SDL_MUSTLOCK(sdl_src))
+		SDL_LockSurface(sdl_src);
+	if(SDL_MUSTLOCK(sdl_dest))
+		SDL_LockSurface(sdl_dest);
+
+	if(0 == SDLSurfaceWrap(sdl_src, vl_src) &&
+	   0 == SDLSurfaceWrap(sdl_dest, vl_dest))
+	{
+		window=vlWindowCreate(0, 0, width, height);
+		vlYuv82Rgb8(vl_ycc, window, vl_src);
+		vlWindowDestroy(window);
+
+		vlDealBinPicYuv(vl_ycc, range, bin);
+		labelMaxBlob(bin, vl_dest, obj);
+	}
+	else
+	{
+		VL_ERROR("visLibProcessYuv: unsupported surface format\n");
+		obj->valid=-1;
+	}
+
+	if(SDL_MUSTLOCK(sdl_dest))
+		SDL_UnlockSurface(sdl_dest);
+	if(SDL_MUSTLOCK(sdl_src))
+		SDL_UnlockSurface(sdl_src);
+}
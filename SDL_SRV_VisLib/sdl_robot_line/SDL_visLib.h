@@ -13,6 +13,9 @@
 
 
 void visLibProcess(SDL_Surface *sdl_src, SDL_Surface *sdl_dest, blob *obj);
+void visLibProcessYuv(unsigned char *ycc, int width, int height,
+		      vlYuvRange *range, SDL_Surface *sdl_src,
+		      SDL_Surface *sdl_dest, blob *obj);
 
 
 #endif
\ No newline at end of file
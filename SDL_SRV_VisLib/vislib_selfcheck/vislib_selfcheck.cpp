@@ -0,0 +1,526 @@
+/*****************************************************************************
+ *
+ * FILE:     vislib_selfcheck.cpp
+ *
+ * ABSTRACT: check that the SIMD kernels of VisLib give exactly the output
+ *           of the plain C code. Every operator runs with all the
+ *           instruction sets of the processor, without AVX2, and with
+ *           none of them (vlCpuDisable), and the three results must be
+ *           equal. The kernels that replaced an arithmetic (the NRG
+ *           reciprocals, the median networks and histograms, the pyramid
+ *           means) are also checked against that arithmetic.
+ *
+ *           Prints one line per kernel; the exit code is the number of
+ *           failed checks.
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vislib.h"
+#include "vlCpu.h"
+
+#ifdef _MSC_VER
+#pragma comment(lib,"..\\..\\SDL_SRV_VisLib\\VisLib_win\\lib\\VisLib_win.lib")
+#endif
+
+
+/* instruction sets of the runs: all, no AVX2, none (the C code) */
+#define SC_RUNS 3
+static const int scDisable[SC_RUNS] = {
+  0,
+  VL_CPU_AVX2,
+  VL_CPU_SSE2 | VL_CPU_SSSE3 | VL_CPU_AVX2
+};
+static const char *scRunName[SC_RUNS] = { "all", "no AVX2", "C" };
+
+static int scFailures = 0;
+
+
+/* report a check */
+static void
+scReport (const char *name, const char *failure)
+{
+  if (failure) {
+    printf ("%-28s FAILED (%s)\n", name, failure);
+    scFailures++;
+  }
+  else {
+    printf ("%-28s ok\n", name);
+  }
+}
+
+
+/* random values in [0,max], with the extreme values on the first row */
+static void
+scFill (vlImage *image, int max)
+{
+  int i, n;
+
+  n = image->width*image->height*vlPixelSize (image->format);
+  for (i=0; i<n; i++) {
+    image->pixel[i] = (vlPixel) (((unsigned int) rand () << 8 ^ rand ()) %
+				 ((unsigned int) max + 1));
+  }
+  for (i=0; (i<n) && (i<image->width); i++) {
+    image->pixel[i] = (vlPixel) ((i & 1) ? max : 0);
+  }
+}
+
+
+static int
+scSame (vlImage *a, vlImage *b)
+{
+  return ((a->format == b->format) && (a->width == b->width) &&
+	  (a->height == b->height) &&
+	  (0 == memcmp (a->pixel, b->pixel, a->width*a->height*
+			vlPixelSize (a->format)*sizeof(vlPixel))));
+}
+
+
+/* an operator of src into dest, with arg */
+typedef int (*scOperator) (vlImage *src, vlImage *dest, void *arg);
+
+/* run op with every set of instructions, and compare with the C code */
+static void
+scCompareRuns (const char *name, scOperator op, vlImage *src, void *arg)
+{
+  vlImage *dest[SC_RUNS];
+  const char *failure = NULL;
+  int k;
+
+  for (k=0; k<SC_RUNS; k++) {
+    dest[k] = vlImageCreate (NONE, 0, 0);
+    vlCpuDisable (scDisable[k]);
+    if (0 > op (src, dest[k], arg)) {
+      failure = "operator failed";
+    }
+  }
+  vlCpuDisable (0);
+
+  for (k=0; (k<SC_RUNS-1) && (!failure); k++) {
+    if (!scSame (dest[k], dest[SC_RUNS-1])) {
+      failure = scRunName[k];
+    }
+  }
+  scReport (name, failure);
+
+  for (k=0; k<SC_RUNS; k++) {
+    vlImageDestroy (dest[k]);
+  }
+}
+
+
+/* ---------------------------------------------------------
+   RGB to HSI
+   --------------------------------------------------------- */
+
+static int
+scRgb2Hsi (vlImage *src, vlImage *dest, void *arg)
+{
+  vlWindow window = { 0, 0, src->width, src->height };
+
+  (void) arg;
+  return (vlRgb2Hsi (src, &window, dest));
+}
+
+static void
+scCheckHsi (void)
+{
+  vlImage *rgb = vlImageCreate (RGB, 643, 97);
+  int i;
+
+  scFill (rgb, 255);
+
+  /* grays, and the hues of the 6 sectors */
+  for (i=0; i<rgb->width; i++) {
+    rgb->pixel[3*(rgb->width+i)] = (vlPixel) (i & 255);
+    rgb->pixel[3*(rgb->width+i)+1] = (vlPixel) (i & 255);
+    rgb->pixel[3*(rgb->width+i)+2] = (vlPixel) ((i % 6 == 0) ? 255 : i & 255);
+  }
+  scCompareRuns ("rgb2hsi", scRgb2Hsi, rgb, NULL);
+
+  vlImageDestroy (rgb);
+}
+
+
+/* ---------------------------------------------------------
+   RGB to NRG
+   --------------------------------------------------------- */
+
+/* every 8-bit RGB triple against the division vlRgb2Nrg replaced */
+static void
+scCheckNrg (void)
+{
+  static vlPixel in[3*256], out[2*256];
+  const char *failure = NULL;
+  int r, g, b, sum;
+  vlPixel nr, ng;
+
+  for (r=0; (r<256) && (!failure); r++) {
+    for (g=0; (g<256) && (!failure); g++) {
+      for (b=0; b<256; b++) {
+	in[3*b] = (vlPixel) r;
+	in[3*b+1] = (vlPixel) g;
+	in[3*b+2] = (vlPixel) b;
+      }
+      vlRgb2NrgRow (in, out, 256);
+
+      for (b=0; b<256; b++) {
+	sum = r+g+b;
+	nr = (vlPixel) ((sum > 0) ? 255.0f * r / sum + 0.5f : 0);
+	ng = (vlPixel) ((sum > 0) ? 255.0f * g / sum + 0.5f : 0);
+	if ((out[2*b] != nr) || (out[2*b+1] != ng)) {
+	  failure = "differs from 255*c/(r+g+b)";
+	  break;
+	}
+      }
+    }
+  }
+  scReport ("rgb2nrg", failure);
+}
+
+
+/* ---------------------------------------------------------
+   YUV to RGB
+   --------------------------------------------------------- */
+
+typedef struct {
+  vlYuvFrame *frame;
+  int step;			/* 3 or 4 byte pixels */
+} scYuvArg;
+
+static int
+scYuvConvert (vlImage *src, vlImage *dest, void *arg)
+{
+  scYuvArg *yuv = (scYuvArg *) arg;
+  vlYuvConverter *conv;
+  vlImage8 *rgb;
+  unsigned char *buffer;
+  int i, j, status = -1;
+
+  (void) src;
+  buffer = (unsigned char *) calloc (yuv->frame->height,
+				     yuv->step*yuv->frame->width);
+  rgb = vlImage8Create (NONE, 0, 0);
+  conv = vlYuvConverterCreate (0);
+  if (buffer && rgb && conv &&
+      (0 <= vlImage8Wrap (rgb, RGB, yuv->frame->width, yuv->frame->height,
+			  buffer, yuv->step*yuv->frame->width, yuv->step,
+			  (yuv->step == 4) ? VL_ORDER_BGR : VL_ORDER_RGB)) &&
+      (0 <= vlImageInit (dest, RGB, yuv->frame->width, yuv->frame->height))) {
+    status = vlYuvConvert (conv, yuv->frame, rgb);
+
+    /* the whole buffer, padding byte of 4 byte pixels included */
+    for (j=0; j<rgb->height; j++) {
+      for (i=0; i<rgb->width*3; i++) {
+	dest->pixel[j*rgb->width*3+i] =
+	  buffer[j*rgb->stride + (i/3)*yuv->step + i%3] +
+	  ((yuv->step == 4) ? 256*buffer[j*rgb->stride + (i/3)*4 + 3] : 0);
+      }
+    }
+  }
+
+  vlYuvConverterDestroy (conv);
+  vlImage8Destroy (rgb);
+  VL_FREE (buffer);
+  return (status);
+}
+
+static void
+scCheckYuv (void)
+{
+  static const vlYuvLayout layouts[4] = {
+    VL_YUV_I420, VL_YUV_422P, VL_YUV_YUYV, VL_YUV_UYVY
+  };
+  static const char *names[4] = { "i420", "422p", "yuyv", "uyvy" };
+  static const int sizes[2][2] = { { 320, 240 }, { 70, 34 } };
+  unsigned char *data;
+  vlYuvFrame frame;
+  scYuvArg arg;
+  char name[64];
+  int i, l, s, size;
+
+  for (s=0; s<2; s++) {
+    size = 2*sizes[s][0]*sizes[s][1];
+    data = (unsigned char *) malloc (size);
+    for (i=0; i<size; i++) {
+      data[i] = (unsigned char) ((i < 64) ? ((i & 1) ? 255 : 0) : rand ());
+    }
+
+    for (l=0; l<4; l++) {
+      vlYuvFrameSet (&frame, layouts[l], sizes[s][0], sizes[s][1], data);
+      arg.frame = &frame;
+      for (arg.step=3; arg.step<=4; arg.step++) {
+	sprintf (name, "yuv2rgb %s %dx%d %d bytes", names[l], sizes[s][0],
+		 sizes[s][1], arg.step);
+	scCompareRuns (name, scYuvConvert, NULL, &arg);
+      }
+    }
+    free (data);
+  }
+}
+
+
+/* ---------------------------------------------------------
+   convolution
+   --------------------------------------------------------- */
+
+typedef struct {
+  vlMask *mask;
+  vlWindow *window;
+} scConvArg;
+
+static int
+scConvolve (vlImage *src, vlImage *dest, void *arg)
+{
+  scConvArg *conv = (scConvArg *) arg;
+
+  return (vlConvolve (src, conv->mask, conv->window, dest));
+}
+
+static void
+scCheckConvolve (void)
+{
+  /* a separable binomial and a non separable laplacian */
+  static const float binomial[5] = { 1, 4, 6, 4, 1 };
+  float k5[25];
+  float k3[9] = { 0, 1, 0, 1, -4, 1, 0, 1, 0 };
+  vlMask m5 = { 5, 5, k5 }, m3 = { 3, 3, k3 };
+  vlWindow full = { 0, 0, 333, 129 }, part = { 7, 3, 300, 111 };
+  vlImage *src[2];
+  scConvArg arg;
+  char name[64];
+  int i, f;
+
+  for (i=0; i<25; i++) {
+    k5[i] = binomial[i/5]*binomial[i%5]/256.0f;
+  }
+  src[0] = vlImageCreate (RGB, 333, 129);
+  src[1] = vlImageCreate (GRAY, 333, 129);
+  scFill (src[0], 255);
+  scFill (src[1], 255);
+
+  for (f=0; f<2; f++) {
+    arg.mask = &m5;
+    arg.window = &full;
+    sprintf (name, "convolve %s 5x5 separable", f ? "gray" : "rgb");
+    scCompareRuns (name, scConvolve, src[f], &arg);
+    arg.window = &part;
+    sprintf (name, "convolve %s 5x5 window", f ? "gray" : "rgb");
+    scCompareRuns (name, scConvolve, src[f], &arg);
+    arg.mask = &m3;
+    sprintf (name, "convolve %s 3x3", f ? "gray" : "rgb");
+    scCompareRuns (name, scConvolve, src[f], &arg);
+    vlImageDestroy (src[f]);
+  }
+}
+
+
+/* ---------------------------------------------------------
+   median
+   --------------------------------------------------------- */
+
+static int
+scCompareValues (const void *a, const void *b)
+{
+  return ((int) *(const vlPixel *) a - (int) *(const vlPixel *) b);
+}
+
+/* vlSmoothMedian against the sort it replaced: the middle value of the
+   size x size square [s1,s2) of every pixel whose square is within the
+   image and the window, src elsewhere */
+static const char *
+scMedianReference (vlImage *src, int size, vlWindow *window, vlImage *dest)
+{
+  vlPixel values[15*15];
+  int i, j, c, u, v, n, s1, s2, x1, x2, y1, y2;
+  vlPixel expected;
+
+  n = vlPixelSize (src->format);
+  s2 = size/2;
+  s1 = -(size-s2);
+  x1 = VL_MAX(window->x-s1,-s1);
+  x2 = VL_MIN(window->x+window->width,src->width-s2);
+  y1 = VL_MAX(window->y-s1,-s1);
+  y2 = VL_MIN(window->y+window->height,src->height-s2);
+
+  for (j=0; j<src->height; j++) {
+    for (i=0; i<src->width; i++) {
+      for (c=0; c<n; c++) {
+	expected = src->pixel[(j*src->width+i)*n+c];
+	if ((i >= x1) && (i < x2) && (j >= y1) && (j < y2)) {
+	  for (v=s1; v<s2; v++) {
+	    for (u=s1; u<s2; u++) {
+	      values[(v-s1)*size+u-s1] =
+		src->pixel[((j+v)*src->width+i+u)*n+c];
+	    }
+	  }
+	  qsort (values, size*size, sizeof(vlPixel), scCompareValues);
+	  expected = values[size*size/2];
+	}
+	if (dest->pixel[(j*src->width+i)*n+c] != expected) {
+	  return ("differs from the sorted square");
+	}
+      }
+    }
+  }
+
+  return (NULL);
+}
+
+static void
+scCheckMedian (void)
+{
+  /* networks (3, 5), histograms (8-bit values) and selection */
+  static const int sizes[4] = { 3, 5, 7, 9 };
+  vlWindow window = { 5, 4, 150, 60 };
+  vlImage *src, *dest;
+  char name[64];
+  int f, s, max;
+
+  dest = vlImageCreate (NONE, 0, 0);
+  for (f=0; f<2; f++) {
+    for (max=255; max<=65535; max+=65280) {
+      src = vlImageCreate (f ? GRAY : RGB, 160, 70);
+      scFill (src, max);
+      for (s=0; s<4; s++) {
+	sprintf (name, "median %s %dx%d %s", f ? "gray" : "rgb", sizes[s],
+		 sizes[s], (max == 255) ? "8-bit" : "16-bit");
+	if (0 > vlSmoothMedian (src, sizes[s], &window, dest)) {
+	  scReport (name, "operator failed");
+	}
+	else {
+	  scReport (name, scMedianReference (src, sizes[s], &window, dest));
+	}
+      }
+      vlImageDestroy (src);
+    }
+  }
+  vlImageDestroy (dest);
+}
+
+
+/* ---------------------------------------------------------
+   pyramid
+   --------------------------------------------------------- */
+
+/* the levels of the pyramid, one after the other, into dest */
+static int
+scPyramid (vlImage *src, vlImage *dest, void *arg)
+{
+  vlPyramid *pyramid = (vlPyramid *) arg;
+  int k, n, size, total;
+
+  if (0 > vlPyramidBuild (pyramid, src)) {
+    return (-1);
+  }
+
+  n = vlPixelSize (src->format);
+  total = 0;
+  for (k=1; k<pyramid->levels; k++) {
+    total += pyramid->level[k]->width*pyramid->level[k]->height;
+  }
+  if (0 > vlImageInit (dest, src->format, total, 1)) {
+    return (-1);
+  }
+
+  total = 0;
+  for (k=1; k<pyramid->levels; k++) {
+    size = pyramid->level[k]->width*pyramid->level[k]->height*n;
+    memcpy (dest->pixel + total, pyramid->level[k]->pixel,
+	    size*sizeof(vlPixel));
+    total += size;
+  }
+
+  return (0);
+}
+
+/* every pixel of a level, the rounded mean of its block of the level
+   above */
+static const char *
+scPyramidReference (vlPyramid *pyramid)
+{
+  vlImage *a, *b;
+  int i, j, c, k, n;
+  unsigned int sum;
+
+  n = vlPixelSize (pyramid->level[0]->format);
+  for (k=1; k<pyramid->levels; k++) {
+    a = pyramid->level[k-1];
+    b = pyramid->level[k];
+    for (j=0; j<b->height; j++) {
+      for (i=0; i<b->width; i++) {
+	for (c=0; c<n; c++) {
+	  sum = (a->pixel[((2*j)*a->width+2*i)*n+c] +
+		 a->pixel[((2*j)*a->width+2*i+1)*n+c] +
+		 a->pixel[((2*j+1)*a->width+2*i)*n+c] +
+		 a->pixel[((2*j+1)*a->width+2*i+1)*n+c]);
+	  if (b->pixel[(j*b->width+i)*n+c] != (vlPixel) ((sum+2) >> 2)) {
+	    return ("differs from the block means");
+	  }
+	}
+      }
+    }
+  }
+
+  return (NULL);
+}
+
+static void
+scCheckPyramid (void)
+{
+  static const vlImageFormat formats[3] = { GRAY, RGB, BINARY };
+  static const char *names[3] = { "gray", "rgb", "binary" };
+  static const int sizes[3][2] = { { 640, 480 }, { 333, 129 }, { 74, 18 } };
+  vlPyramid *pyramid = vlPyramidCreate (0);
+  vlImage *src;
+  char name[64];
+  int f, s;
+
+  for (f=0; f<3; f++) {
+    for (s=0; s<3; s++) {
+      src = vlImageCreate (formats[f], sizes[s][0], sizes[s][1]);
+      scFill (src, (formats[f] == BINARY) ? 255 : 65535);
+      sprintf (name, "pyramid %s %dx%d", names[f], sizes[s][0], sizes[s][1]);
+      scCompareRuns (name, scPyramid, src, pyramid);
+
+      sprintf (name, "pyramid %s %dx%d means", names[f], sizes[s][0],
+	       sizes[s][1]);
+      if (0 > vlPyramidBuild (pyramid, src)) {
+	scReport (name, "operator failed");
+      }
+      else {
+	scReport (name, scPyramidReference (pyramid));
+      }
+      vlImageDestroy (src);
+    }
+  }
+  vlPyramidDestroy (pyramid);
+}
+
+
+int
+main (int argc, char **argv)
+{
+  (void) argc;
+  (void) argv;
+
+  srand (1);
+  printf ("instruction sets: %s%s%s\n",
+	  (vlCpuFeatures () & VL_CPU_SSE2) ? "SSE2 " : "",
+	  (vlCpuFeatures () & VL_CPU_SSSE3) ? "SSSE3 " : "",
+	  (vlCpuFeatures () & VL_CPU_AVX2) ? "AVX2" : "");
+
+  scCheckHsi ();
+  scCheckNrg ();
+  scCheckYuv ();
+  scCheckConvolve ();
+  scCheckMedian ();
+  scCheckPyramid ();
+
+  printf ("%d failed\n", scFailures);
+  return (scFailures);
+}